@@ -0,0 +1,280 @@
+#pragma once
+
+/// @file corpus.h
+/// @brief Deterministic generator for large synthetic .REG files.
+///
+/// The same options produce byte-identical output on every platform and compiler: the
+/// generator uses its own PRNG and integer arithmetic only (no <random> distributions).
+
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <pnq/regis3/importer.h>
+
+namespace pnq
+{
+    namespace bench
+    {
+        /// Relative frequency of each value type.
+        struct ValueMix
+        {
+            unsigned string{50};
+            unsigned dword{20};
+            unsigned qword{5};
+            unsigned binary{15};
+            unsigned expand_string{5};
+            unsigned multi_string{5};
+
+            unsigned total() const
+            {
+                return string + dword + qword + binary + expand_string + multi_string;
+            }
+        };
+
+        /// Shape of the generated registry tree.
+        struct CorpusOptions
+        {
+            /// Levels of keys below the root key
+            unsigned depth{4};
+
+            /// Subkeys per key
+            unsigned fanout{6};
+
+            /// Values per key (one of them may be the default value)
+            unsigned values_per_key{8};
+
+            /// REGEDIT4 instead of "Windows Registry Editor Version 5.00"
+            bool regedit4{false};
+
+            std::uint64_t seed{1};
+            ValueMix mix{};
+        };
+
+        /// Generated .REG text plus what went into it.
+        struct Corpus
+        {
+            /// .REG file content (UTF-8, CRLF line endings)
+            std::string text;
+
+            /// Full path of every key, in file order
+            std::vector<std::string> key_paths;
+
+            size_t value_count{0};
+        };
+
+        /// splitmix64 - small, fast and identical everywhere.
+        class Random final
+        {
+        public:
+            explicit Random(std::uint64_t seed)
+                : m_state{seed}
+            {
+            }
+
+            std::uint64_t next()
+            {
+                std::uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                return z ^ (z >> 31);
+            }
+
+            /// Uniform-enough number in [0, bound)
+            std::uint32_t below(std::uint32_t bound)
+            {
+                return static_cast<std::uint32_t>(next() % bound);
+            }
+
+        private:
+            std::uint64_t m_state;
+        };
+
+        namespace detail
+        {
+            class Generator final
+            {
+            public:
+                Generator(const CorpusOptions& options, Corpus& corpus)
+                    : m_options{options},
+                      m_corpus{corpus},
+                      m_random{options.seed}
+                {
+                }
+
+                void run()
+                {
+                    auto& text = m_corpus.text;
+                    text.append(m_options.regedit4 ? regis3::HEADER_FORMAT4 : regis3::HEADER_FORMAT5);
+                    text.append("\r\n\r\n");
+                    generate_key("HKEY_CURRENT_USER\\Software\\pnq_bench", 0);
+                }
+
+            private:
+                void generate_key(const std::string& path, unsigned level)
+                {
+                    auto& text = m_corpus.text;
+                    m_corpus.key_paths.push_back(path);
+                    std::format_to(std::back_inserter(text), "[{}]\r\n", path);
+
+                    for (unsigned i = 0; i < m_options.values_per_key; ++i)
+                        generate_value(i);
+                    text.append("\r\n");
+
+                    if (level == m_options.depth)
+                        return;
+
+                    for (unsigned i = 0; i < m_options.fanout; ++i)
+                        generate_key(std::format("{}\\{}{}", path, word(), i), level + 1);
+                }
+
+                void generate_value(unsigned index)
+                {
+                    auto& text = m_corpus.text;
+                    ++m_corpus.value_count;
+
+                    // About one key in ten gets a default value
+                    if (index == 0 && m_random.below(10) == 0)
+                        text.append("@=");
+                    else
+                        std::format_to(std::back_inserter(text), "\"{}{}\"=", word(), index);
+
+                    const auto& mix = m_options.mix;
+                    auto pick = m_random.below(mix.total() ? mix.total() : 1);
+                    if (pick < mix.string)
+                    {
+                        text.append("\"");
+                        append_escaped(sentence());
+                        text.append("\"\r\n");
+                        return;
+                    }
+                    pick -= mix.string;
+
+                    if (pick < mix.dword)
+                    {
+                        std::format_to(std::back_inserter(text), "dword:{:08x}\r\n", static_cast<std::uint32_t>(m_random.next()));
+                        return;
+                    }
+                    pick -= mix.dword;
+
+                    std::vector<std::uint8_t> data;
+                    if (pick < mix.qword)
+                    {
+                        const auto value = m_random.next();
+                        for (int i = 0; i < 8; ++i)
+                            data.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+                        append_hex("hex(b):", data);
+                        return;
+                    }
+                    pick -= mix.qword;
+
+                    if (pick < mix.binary)
+                    {
+                        const auto size = 4 + m_random.below(60);
+                        for (std::uint32_t i = 0; i < size; ++i)
+                            data.push_back(static_cast<std::uint8_t>(m_random.next()));
+                        append_hex("hex:", data);
+                        return;
+                    }
+                    pick -= mix.binary;
+
+                    if (pick < mix.expand_string)
+                    {
+                        // Separate statements: the order of word() calls must not depend on the compiler
+                        const auto folder = word();
+                        const auto file = word();
+                        append_string_bytes(data, std::format("%SystemRoot%\\{}\\{}", folder, file));
+                        append_hex("hex(2):", data);
+                        return;
+                    }
+
+                    const auto count = 1 + m_random.below(4);
+                    for (std::uint32_t i = 0; i < count; ++i)
+                        append_string_bytes(data, sentence());
+                    append_string_bytes(data, {});
+                    append_hex("hex(7):", data);
+                }
+
+                /// Hex data wrapped like regedit does: 25 bytes per line, continued with '\'.
+                void append_hex(std::string_view prefix, const std::vector<std::uint8_t>& data)
+                {
+                    auto& text = m_corpus.text;
+                    text.append(prefix);
+                    for (size_t i = 0; i < data.size(); ++i)
+                    {
+                        std::format_to(std::back_inserter(text), "{:02x}", data[i]);
+                        if (i + 1 == data.size())
+                            break;
+                        text.append(",");
+                        if (i % 25 == 24)
+                            text.append("\\\r\n  ");
+                    }
+                    text.append("\r\n");
+                }
+
+                /// Append a string the way the target format stores it (UTF-16LE or ANSI, with terminator).
+                void append_string_bytes(std::vector<std::uint8_t>& data, std::string_view text) const
+                {
+                    for (const char c : text)
+                    {
+                        data.push_back(static_cast<std::uint8_t>(c));
+                        if (!m_options.regedit4)
+                            data.push_back(0);
+                    }
+                    data.push_back(0);
+                    if (!m_options.regedit4)
+                        data.push_back(0);
+                }
+
+                void append_escaped(std::string_view value)
+                {
+                    for (const char c : value)
+                    {
+                        if (c == '"' || c == '\\')
+                            m_corpus.text.push_back('\\');
+                        m_corpus.text.push_back(c);
+                    }
+                }
+
+                std::string word()
+                {
+                    static constexpr std::string_view words[] = {
+                        "Alpha", "Bravo", "Charlie", "Delta", "Echo", "Foxtrot", "Golf", "Hotel",
+                        "India", "Juliett", "Kilo", "Lima", "Mike", "November", "Oscar", "Papa",
+                    };
+                    return std::string{words[m_random.below(static_cast<std::uint32_t>(std::size(words)))]};
+                }
+
+                std::string sentence()
+                {
+                    std::string result;
+                    const auto count = 1 + m_random.below(8);
+                    for (std::uint32_t i = 0; i < count; ++i)
+                    {
+                        if (i)
+                            result.push_back(m_random.below(8) == 0 ? '\\' : ' ');
+                        result.append(word());
+                    }
+                    if (m_random.below(16) == 0)
+                        result.append(" \"quoted\"");
+                    return result;
+                }
+
+                const CorpusOptions& m_options;
+                Corpus& m_corpus;
+                Random m_random;
+            };
+        }
+
+        /// Generate a synthetic .REG file.
+        inline Corpus generate_corpus(const CorpusOptions& options)
+        {
+            Corpus corpus;
+            detail::Generator{options, corpus}.run();
+            return corpus;
+        }
+    } // namespace bench
+} // namespace pnq
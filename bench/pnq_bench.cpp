@@ -0,0 +1,665 @@
+/// @file pnq_bench.cpp
+/// @brief Performance benchmarks for pnq, with JSON output that can be compared between commits.
+///
+/// Usage: pnq_bench [options]
+///
+///   --json <file>          write results as JSON
+///   --compare <file>       compare medians against the JSON of an earlier run
+///   --filter <text>        only run benchmarks whose name contains text
+///   --min-time <ms>        measuring time per benchmark (default 500)
+///   --depth <n>            key levels below the corpus root (default 4)
+///   --fanout <n>           subkeys per key (default 6)
+///   --values <n>           values per key (default 8)
+///   --mix <s,d,q,b,e,m>    value type weights: string, dword, qword, binary, expand, multi
+///   --regedit4             generate REGEDIT4 instead of Windows Registry Editor 5.00
+///   --seed <n>             corpus seed (default 1)
+///   --generate <file>      write the corpus to file (UTF-8) and exit
+///   --trace <file>         write a Chrome trace of the run (needs PNQ_ENABLE_PROFILING)
+///
+/// Built with PNQ_TRACK_ALLOCATIONS, every benchmark also reports allocations and peak live
+/// bytes of one extra iteration.
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <mutex>
+#include <semaphore>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <pnq/pnq.h>
+#include <pnq/memory_tracking_hooks.h>
+#include <pnq/regis3.h>
+
+#include "corpus.h"
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    struct Result
+    {
+        std::string name;
+        std::uint64_t iterations;
+        double min_ns;
+        double median_ns;
+        double mean_ns;
+
+        /// Input bytes processed per iteration (0 if not meaningful)
+        std::uint64_t bytes;
+
+        /// Allocations and peak live bytes of one iteration (PNQ_TRACK_ALLOCATIONS only)
+        std::uint64_t allocations;
+        std::uint64_t peak_bytes;
+    };
+
+    /// Benchmark bodies return something derived from their work, which ends up here.
+    volatile size_t g_sink = 0;
+
+    class Runner final
+    {
+    public:
+        Runner(std::string_view filter, std::chrono::milliseconds min_time)
+            : m_filter{filter},
+              m_min_time{min_time}
+        {
+        }
+
+        template <typename F>
+        void run(std::string name, std::uint64_t bytes, F&& body)
+        {
+            if (!m_filter.empty() && name.find(m_filter) == std::string::npos)
+                return;
+
+            const auto time_batch = [&](std::uint64_t count) {
+                const auto start = clock::now();
+                for (std::uint64_t i = 0; i < count; ++i)
+                    g_sink = body();
+                return clock::now() - start;
+            };
+
+            // Batch fast bodies so that clock resolution and overhead don't matter
+            time_batch(1);
+            std::uint64_t batch = 1;
+            while (time_batch(batch) < std::chrono::microseconds{200} && batch < (1ull << 30))
+                batch *= 2;
+
+            std::vector<double> samples;
+            const auto deadline = clock::now() + m_min_time;
+            while (samples.size() < 5 || (clock::now() < deadline && samples.size() < 100000))
+            {
+                const auto elapsed = std::chrono::duration<double, std::nano>(time_batch(batch)).count();
+                samples.push_back(elapsed / static_cast<double>(batch));
+            }
+            std::sort(samples.begin(), samples.end());
+
+            double sum = 0;
+            for (const auto sample : samples)
+                sum += sample;
+
+            Result result{
+                std::move(name),
+                batch * samples.size(),
+                samples.front(),
+                samples[samples.size() / 2],
+                sum / static_cast<double>(samples.size()),
+                bytes,
+                0,
+                0,
+            };
+
+#ifdef PNQ_TRACK_ALLOCATIONS
+            {
+                const pnq::memory::AllocationScope scope;
+                g_sink = body();
+                const auto stats = scope.stats();
+                result.allocations = stats.allocations;
+                result.peak_bytes = stats.peak_live_bytes;
+            }
+#endif
+
+            std::cout << std::format("{:<40} {:>14} {:>14}", result.name, format_time(result.median_ns), format_time(result.min_ns));
+            if (bytes)
+                std::cout << std::format(" {:>10.1f} MB/s", static_cast<double>(bytes) / result.median_ns * 1e3);
+#ifdef PNQ_TRACK_ALLOCATIONS
+            std::cout << std::format(" {:>10} allocs {:>12} peak", result.allocations, result.peak_bytes);
+#endif
+            std::cout << '\n';
+            m_results.push_back(std::move(result));
+        }
+
+        const std::vector<Result>& results() const { return m_results; }
+
+        static std::string format_time(double ns)
+        {
+            if (ns >= 1e6)
+                return std::format("{:.3f} ms", ns / 1e6);
+            if (ns >= 1e3)
+                return std::format("{:.3f} us", ns / 1e3);
+            return std::format("{:.1f} ns", ns);
+        }
+
+    private:
+        std::string m_filter;
+        std::chrono::milliseconds m_min_time;
+        std::vector<Result> m_results;
+    };
+
+    std::string compiler_name()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        return std::format("MSVC {}", _MSC_VER);
+#elif defined(__clang__)
+        return std::format("clang {}.{}.{}", __clang_major__, __clang_minor__, __clang_patchlevel__);
+#elif defined(__GNUC__)
+        return std::format("gcc {}.{}.{}", __GNUC__, __GNUC_MINOR__, __GNUC_PATCHLEVEL__);
+#else
+        return "unknown";
+#endif
+    }
+
+    /// Escape text for a JSON string literal (names only contain printable ASCII).
+    std::string json_escape(std::string_view text)
+    {
+        std::string result;
+        for (const char c : text)
+        {
+            if (c == '"' || c == '\\')
+                result.push_back('\\');
+            result.push_back(c);
+        }
+        return result;
+    }
+
+    /// Write results with one benchmark per line, so the file also diffs well.
+    bool write_json(std::string_view filename, const pnq::bench::CorpusOptions& options, const pnq::bench::Corpus& corpus,
+        const std::vector<Result>& results)
+    {
+        std::string output;
+        std::format_to(std::back_inserter(output),
+            "{{\n"
+            "  \"pnq_version\": \"{}.{}.{}\",\n"
+            "  \"compiler\": \"{}\",\n"
+#ifdef NDEBUG
+            "  \"build\": \"release\",\n"
+#else
+            "  \"build\": \"debug\",\n"
+#endif
+            "  \"corpus\": {{\"depth\": {}, \"fanout\": {}, \"values_per_key\": {}, \"format\": \"{}\", \"seed\": {}, "
+            "\"bytes\": {}, \"keys\": {}, \"values\": {}}},\n"
+            "  \"benchmarks\": [\n",
+            pnq::version_major, pnq::version_minor, pnq::version_patch, json_escape(compiler_name()),
+            options.depth, options.fanout, options.values_per_key, options.regedit4 ? "REGEDIT4" : "REGEDIT5", options.seed,
+            corpus.text.size(), corpus.key_paths.size(), corpus.value_count);
+
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const auto& result = results[i];
+            std::format_to(std::back_inserter(output),
+                "    {{\"name\": \"{}\", \"iterations\": {}, \"min_ns\": {:.1f}, \"median_ns\": {:.1f}, \"mean_ns\": {:.1f}, \"bytes\": {}",
+                json_escape(result.name), result.iterations, result.min_ns, result.median_ns, result.mean_ns, result.bytes);
+#ifdef PNQ_TRACK_ALLOCATIONS
+            std::format_to(std::back_inserter(output), ", \"allocations\": {}, \"peak_bytes\": {}", result.allocations, result.peak_bytes);
+#endif
+            output.append(i + 1 < results.size() ? "},\n" : "}\n");
+        }
+        output.append("  ]\n}\n");
+        return pnq::text_file::write_utf8(filename, output, false, false);
+    }
+
+    /// Print median changes against a file written by write_json().
+    bool compare(std::string_view filename, const std::vector<Result>& results)
+    {
+        if (!pnq::file::exists(filename))
+        {
+            PNQ_LOG_ERROR("Baseline '{}' does not exist", filename);
+            return false;
+        }
+
+        // Only needs to read what write_json() writes: one benchmark object per line
+        std::unordered_map<std::string, double> baseline;
+        for (const auto& line : pnq::string::split(pnq::text_file::read_auto(filename), "\n"))
+        {
+            constexpr std::string_view name_key = "\"name\": \"";
+            constexpr std::string_view median_key = "\"median_ns\": ";
+            const auto name_start = line.find(name_key);
+            const auto median_start = line.find(median_key);
+            if (name_start == std::string::npos || median_start == std::string::npos)
+                continue;
+
+            const auto name_begin = name_start + name_key.size();
+            const auto name = line.substr(name_begin, line.find('"', name_begin) - name_begin);
+            double median = 0;
+            const auto* first = line.data() + median_start + median_key.size();
+            if (std::from_chars(first, line.data() + line.size(), median).ec == std::errc{})
+                baseline[name] = median;
+        }
+
+        std::cout << std::format("\n{:<40} {:>14} {:>14} {:>9}\n", "compared to " + std::string{filename}, "before", "after", "change");
+        for (const auto& result : results)
+        {
+            const auto it = baseline.find(result.name);
+            if (it == baseline.end() || it->second <= 0)
+                continue;
+            const auto change = (result.median_ns - it->second) / it->second * 100.0;
+            std::cout << std::format("{:<40} {:>14} {:>14} {:>+8.1f}%\n",
+                result.name, Runner::format_time(it->second), Runner::format_time(result.median_ns), change);
+        }
+        return true;
+    }
+
+    template <typename T>
+    bool parse_number(std::string_view text, T& value)
+    {
+        const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc{} && ptr == text.data() + text.size();
+    }
+
+    bool parse_mix(std::string_view text, pnq::bench::ValueMix& mix)
+    {
+        const auto parts = pnq::string::split(text, ",");
+        return parts.size() == 6 &&
+            parse_number(parts[0], mix.string) && parse_number(parts[1], mix.dword) &&
+            parse_number(parts[2], mix.qword) && parse_number(parts[3], mix.binary) &&
+            parse_number(parts[4], mix.expand_string) && parse_number(parts[5], mix.multi_string) &&
+            mix.total() > 0;
+    }
+
+    /// Threads taking turns on one lock, with a tiny critical section.
+    template <typename Mutex>
+    size_t contended_lock(Mutex& mutex, unsigned thread_count)
+    {
+        size_t counter = 0;
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < thread_count; ++t)
+        {
+            threads.emplace_back([&] {
+                for (int i = 0; i < 10000; ++i)
+                {
+                    std::lock_guard lock{mutex};
+                    ++counter;
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        return counter;
+    }
+
+    /// Threads reading under a shared lock, with one write in 16.
+    template <typename SharedMutex>
+    size_t read_mostly(SharedMutex& mutex, unsigned thread_count)
+    {
+        size_t value = 0;
+        std::atomic<size_t> seen{0};
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < thread_count; ++t)
+        {
+            threads.emplace_back([&] {
+                size_t local = 0;
+                for (int i = 0; i < 10000; ++i)
+                {
+                    if (i % 16 == 0)
+                    {
+                        std::unique_lock lock{mutex};
+                        ++value;
+                    }
+                    else
+                    {
+                        std::shared_lock lock{mutex};
+                        local += value;
+                    }
+                }
+                seen += local;
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        return seen.load();
+    }
+
+    /// Round trips between two threads through a pair of semaphores.
+    template <typename Semaphore>
+    size_t ping_pong()
+    {
+        Semaphore ping{0}, pong{0};
+        std::thread partner{[&] {
+            for (int i = 0; i < 2000; ++i)
+            {
+                ping.acquire();
+                pong.release();
+            }
+        }};
+        for (int i = 0; i < 2000; ++i)
+        {
+            ping.release();
+            pong.acquire();
+        }
+        partner.join();
+        return 2000;
+    }
+
+    /// Items through a queue from producer threads to consumer threads.
+    template <typename Queue>
+    size_t transfer(unsigned producers, unsigned consumers, std::uint64_t items_per_producer)
+    {
+        Queue queue{1024};
+        std::atomic<std::uint64_t> sum{0};
+        std::vector<std::thread> consumer_threads;
+        for (unsigned c = 0; c < consumers; ++c)
+        {
+            consumer_threads.emplace_back([&] {
+                std::uint64_t item, local = 0;
+                while (queue.pop(item))
+                    local += item;
+                sum += local;
+            });
+        }
+
+        std::vector<std::thread> producer_threads;
+        for (unsigned p = 0; p < producers; ++p)
+        {
+            producer_threads.emplace_back([&] {
+                for (std::uint64_t i = 0; i < items_per_producer; ++i)
+                    queue.push(i);
+            });
+        }
+        for (auto& thread : producer_threads)
+            thread.join();
+        queue.close();
+        for (auto& thread : consumer_threads)
+            thread.join();
+        return static_cast<size_t>(sum.load());
+    }
+
+    int usage()
+    {
+        std::cerr << "usage: pnq_bench [--json <file>] [--compare <file>] [--filter <text>] [--min-time <ms>]\n"
+                     "                 [--depth <n>] [--fanout <n>] [--values <n>] [--mix <s,d,q,b,e,m>]\n"
+                     "                 [--regedit4] [--seed <n>] [--generate <file>] [--trace <file>]\n";
+        return 2;
+    }
+
+    void run_benchmarks(Runner& runner, const pnq::bench::CorpusOptions& options, const pnq::bench::Corpus& corpus)
+    {
+        using namespace pnq::regis3;
+        using pnq::ref_ptr;
+
+        const auto& text = corpus.text;
+        const auto header = options.regedit4 ? HEADER_FORMAT4 : HEADER_FORMAT5;
+
+        // --- regis3 ---
+
+        const auto parse = [&] {
+            regfile_parser parser{header, import_options::none};
+            if (!parser.parse_text(text))
+                return ref_ptr<key_entry>{};
+            return parser.result();
+        };
+        const auto root = parse();
+        if (!root)
+        {
+            PNQ_LOG_ERROR("Generated corpus does not parse");
+            return;
+        }
+
+        runner.run("regis3::parse", text.size(), [&] {
+            return parse()->keys().size();
+        });
+
+        runner.run("regis3::export", 0, [&] {
+            regfile_format5_exporter exporter;
+            exporter.perform_export(root.get());
+            return exporter.result().size();
+        });
+
+        runner.run("regis3::key_entry::clone", 0, [&] {
+            ref_ptr<key_entry> copy{root->clone(nullptr), pnq::adopt_ref};
+            return copy->keys().size();
+        });
+
+        runner.run("regis3::find_or_create_key (create)", 0, [&] {
+            ref_ptr<key_entry> tree{PNQ_NEW key_entry(), pnq::adopt_ref};
+            for (const auto& path : corpus.key_paths)
+                tree->find_or_create_key(path);
+            return tree->keys().size();
+        });
+
+        runner.run("regis3::find_or_create_key (lookup)", 0, [&] {
+            size_t found = 0;
+            for (const auto& path : corpus.key_paths)
+                found += root->find_or_create_key(path) != nullptr;
+            return found;
+        });
+
+        // --- text_file ---
+
+        const auto filename = pnq::string::encode_as_utf8((std::filesystem::temp_directory_path() / L"pnq_bench_corpus.reg").wstring());
+        const bool written = options.regedit4
+            ? pnq::text_file::write_ansi(filename, text, false)
+            : pnq::text_file::write_utf16(filename, pnq::string::encode_as_utf16(text));
+        if (written)
+        {
+            runner.run("text_file::read_auto", text.size(), [&] {
+                return pnq::text_file::read_auto(filename).size();
+            });
+            pnq::file::remove(filename);
+        }
+
+        // --- string utilities ---
+
+        runner.run("string::encode_as_utf16", text.size(), [&] {
+            return pnq::string::encode_as_utf16(text).size();
+        });
+
+        const auto wide = pnq::string::encode_as_utf16(text);
+        runner.run("string::encode_as_utf8", text.size(), [&] {
+            return pnq::string::encode_as_utf8(wide).size();
+        });
+
+        runner.run("string::split", text.size(), [&] {
+            return pnq::string::split(text, "\r\n").size();
+        });
+
+        runner.run("string::lowercase", text.size(), [&] {
+            return pnq::string::lowercase(text).size();
+        });
+
+        std::vector<std::string> uppercase_paths;
+        for (const auto& path : corpus.key_paths)
+            uppercase_paths.push_back(pnq::string::uppercase(path));
+        runner.run("string::equals_nocase", 0, [&] {
+            size_t equal = 0;
+            for (size_t i = 0; i < corpus.key_paths.size(); ++i)
+                equal += pnq::string::equals_nocase(corpus.key_paths[i], uppercase_paths[i]);
+            return equal;
+        });
+
+        const pnq::string::Expander expander{{{"BENCH_ROOT", "C:\\pnq\\bench"}}, false};
+        std::vector<std::string> patterns;
+        for (const auto& path : corpus.key_paths)
+            patterns.push_back("%BENCH_ROOT%\\" + path);
+        runner.run("string::Expander::expand", 0, [&] {
+            size_t size = 0;
+            for (const auto& pattern : patterns)
+                size += expander.expand(pattern).size();
+            return size;
+        });
+
+        // --- sqlite ---
+
+#if __has_include(<sqlite3.h>)
+        pnq::sqlite::Database db;
+        if (db.open(":memory:") && db.execute("CREATE TABLE bench(path TEXT, name TEXT, value INTEGER);"))
+        {
+            runner.run("sqlite::Statement insert", 0, [&] {
+                pnq::sqlite::Transaction transaction{db};
+                db.execute("DELETE FROM bench;");
+
+                pnq::sqlite::Statement statement{db, "INSERT INTO bench VALUES(?, ?, ?);"};
+                std::int64_t row = 0;
+                for (const auto& path : corpus.key_paths)
+                {
+                    statement.bind(std::string_view{path});
+                    statement.bind(std::string_view{"name"});
+                    statement.bind(row++);
+                    statement.execute();
+                    statement.reset();
+                }
+                transaction.commit();
+                return static_cast<size_t>(row);
+            });
+
+            runner.run("sqlite::Statement select", 0, [&] {
+                pnq::sqlite::Statement statement{db, "SELECT path, value FROM bench;"};
+                size_t size = 0;
+                if (statement.execute() && !statement.is_empty())
+                {
+                    do
+                    {
+                        size += statement.get_text(0).size();
+                    } while (statement.next());
+                }
+                return size;
+            });
+        }
+#endif
+
+        // --- sync, against the std equivalents ---
+
+        const unsigned thread_count = std::clamp(std::thread::hardware_concurrency(), 2u, 4u);
+        pnq::sync::Mutex mutex;
+        runner.run(std::format("sync::Mutex ({} threads)", thread_count), 0, [&] {
+            return contended_lock(mutex, thread_count);
+        });
+        std::mutex std_mutex;
+        runner.run(std::format("std::mutex ({} threads)", thread_count), 0, [&] {
+            return contended_lock(std_mutex, thread_count);
+        });
+
+        pnq::sync::SharedMutex shared_mutex;
+        runner.run(std::format("sync::SharedMutex ({} threads)", thread_count), 0, [&] {
+            return read_mostly(shared_mutex, thread_count);
+        });
+        std::shared_mutex std_shared_mutex;
+        runner.run(std::format("std::shared_mutex ({} threads)", thread_count), 0, [&] {
+            return read_mostly(std_shared_mutex, thread_count);
+        });
+
+        runner.run("sync::Semaphore ping-pong", 0, [] {
+            return ping_pong<pnq::sync::Semaphore>();
+        });
+        runner.run("std::counting_semaphore ping-pong", 0, [] {
+            return ping_pong<std::counting_semaphore<>>();
+        });
+
+        // --- bounded queues ---
+
+        runner.run("SpscQueue (100k items)", 0, [] {
+            return transfer<pnq::SpscQueue<std::uint64_t>>(1, 1, 100000);
+        });
+        runner.run("MpmcQueue (2x2 threads, 100k items)", 0, [] {
+            return transfer<pnq::MpmcQueue<std::uint64_t>>(2, 2, 50000);
+        });
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    pnq::bench::CorpusOptions options;
+    std::string json_filename, compare_filename, filter, generate_filename, trace_filename;
+    unsigned min_time_ms = 500;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg{argv[i]};
+        const auto next = [&](auto& value) {
+            if (i + 1 >= argc)
+                return false;
+            const std::string_view text{argv[++i]};
+            if constexpr (std::is_same_v<std::remove_reference_t<decltype(value)>, std::string>)
+            {
+                value = text;
+                return true;
+            }
+            else
+            {
+                return parse_number(text, value);
+            }
+        };
+
+        bool ok = true;
+        if (arg == "--json")
+            ok = next(json_filename);
+        else if (arg == "--compare")
+            ok = next(compare_filename);
+        else if (arg == "--filter")
+            ok = next(filter);
+        else if (arg == "--min-time")
+            ok = next(min_time_ms);
+        else if (arg == "--depth")
+            ok = next(options.depth);
+        else if (arg == "--fanout")
+            ok = next(options.fanout);
+        else if (arg == "--values")
+            ok = next(options.values_per_key);
+        else if (arg == "--seed")
+            ok = next(options.seed);
+        else if (arg == "--regedit4")
+            options.regedit4 = true;
+        else if (arg == "--mix")
+            ok = i + 1 < argc && parse_mix(argv[++i], options.mix);
+        else if (arg == "--generate")
+            ok = next(generate_filename);
+        else if (arg == "--trace")
+            ok = next(trace_filename);
+        else
+            ok = false;
+
+        if (!ok)
+            return usage();
+    }
+
+    pnq::logging::initialize_logging("pnq_bench", true);
+    pnq::logging::set_level(pnq::logging::level::warn);
+
+    const auto corpus = pnq::bench::generate_corpus(options);
+    if (!generate_filename.empty())
+        return pnq::text_file::write_utf8(generate_filename, corpus.text, false, false) ? 0 : 1;
+
+    std::cout << std::format("corpus: {} keys, {} values, {} ({})\n\n",
+        corpus.key_paths.size(), corpus.value_count, pnq::string::format_file_size(corpus.text.size()),
+        options.regedit4 ? "REGEDIT4" : "REGEDIT5");
+    std::cout << std::format("{:<40} {:>14} {:>14}\n", "benchmark", "median", "min");
+
+    if (!trace_filename.empty())
+        pnq::profile::start();
+
+    Runner runner{filter, std::chrono::milliseconds{min_time_ms}};
+    run_benchmarks(runner, options, corpus);
+
+    int result = 0;
+    if (!trace_filename.empty())
+    {
+        pnq::profile::stop();
+#ifndef PNQ_ENABLE_PROFILING
+        PNQ_LOG_WARN("Built without PNQ_ENABLE_PROFILING, '{}' will not contain any zones", trace_filename);
+#endif
+        if (!pnq::profile::write_chrome_trace(trace_filename))
+            result = 1;
+    }
+    // Compare first, so that --compare and --json can name the same file
+    if (!compare_filename.empty() && !compare(compare_filename, runner.results()))
+        result = 1;
+    if (!json_filename.empty() && !write_json(json_filename, options, corpus, runner.results()))
+        result = 1;
+    return result;
+}
@@ -0,0 +1,508 @@
+#pragma once
+
+/// @file pnq/async_io.h
+/// @brief Batched asynchronous positional reads and writes on BinaryFile objects.
+///
+/// On Linux with PNQ_USE_IO_URING defined (set by CMake when liburing is found),
+/// requests go through an io_uring submission queue if the kernel supports
+/// IORING_FEAT_EXT_ARG (5.11 and later). Everywhere else a small set of worker threads
+/// executes them with BinaryFile::read_at/write_at.
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <pnq/platform.h>
+#include <pnq/binary_file.h>
+#include <pnq/memory_view.h>
+#include <pnq/logging.h>
+
+#if defined(PNQ_USE_IO_URING) && defined(PNQ_PLATFORM_LINUX)
+#include <liburing.h>
+#define PNQ_ASYNC_IO_URING 1
+#endif
+
+namespace pnq
+{
+    /// Queue of asynchronous file reads and writes.
+    ///
+    /// read()/write() only queue a request; submit() hands everything queued so far to the
+    /// kernel (or the workers) in one batch. Completion callbacks run on an internal thread,
+    /// so they must be thread-safe and should be short. A callback may queue and submit more
+    /// requests, but there submit() does not wait for room: what does not fit stays queued for
+    /// the next submit(). A callback must not call wait_all(), which would wait for itself.
+    /// Buffers and files must stay alive until the request completes.
+    class AsyncIO final
+    {
+    public:
+        /// Outcome of one request.
+        struct Result
+        {
+            /// true if the request completed without error
+            bool success{false};
+
+            /// Bytes transferred; only a read that reaches the end of the file is short.
+            /// Both backends continue short transfers until the request is done.
+            size_t bytes{0};
+        };
+
+        using Completion = std::function<void(const Result &)>;
+
+        /// @param queue_depth number of requests kept in flight at once
+        explicit AsyncIO(unsigned queue_depth = 64)
+            : m_queue_depth{queue_depth ? queue_depth : 1}
+        {
+#ifdef PNQ_ASYNC_IO_URING
+            const int rc = io_uring_queue_init(m_queue_depth, &m_ring, 0);
+            if (rc < 0)
+            {
+                errno = -rc;
+                PNQ_LOG_ERRNO("io_uring_queue_init({}) failed, using worker threads", m_queue_depth);
+            }
+            else if (!(m_ring.features & IORING_FEAT_EXT_ARG))
+            {
+                // Without it, waiting with a timeout takes a submission entry behind the back of submit()
+                PNQ_LOG_WARN("io_uring lacks IORING_FEAT_EXT_ARG, using worker threads");
+                io_uring_queue_exit(&m_ring);
+            }
+            else
+            {
+                m_use_ring = true;
+                m_reaper = std::thread{[this] { reap(); }};
+                return;
+            }
+#endif
+            const auto workers = std::min(std::max(std::thread::hardware_concurrency(), 2u), m_queue_depth);
+            for (unsigned i = 0; i < workers; ++i)
+                m_workers.emplace_back([this] { work(); });
+        }
+
+        /// Submits anything still queued and waits for all requests to complete.
+        ~AsyncIO()
+        {
+            submit();
+            wait_all();
+
+            {
+                std::lock_guard lock{m_mutex};
+                m_stopping = true;
+            }
+#ifdef PNQ_ASYNC_IO_URING
+            if (m_use_ring)
+            {
+                // Wake the reaper with a request that carries no operation; if there is no room
+                // for it the reaper still notices m_stopping within its wait timeout
+                {
+                    std::lock_guard lock{m_mutex};
+                    if (auto *sqe = get_sqe())
+                    {
+                        io_uring_prep_nop(sqe);
+                        io_uring_sqe_set_data(sqe, nullptr);
+                        io_uring_submit(&m_ring);
+                    }
+                }
+                m_reaper.join();
+                io_uring_queue_exit(&m_ring);
+                return;
+            }
+#endif
+            m_work_available.notify_all();
+            for (auto &worker : m_workers)
+                worker.join();
+        }
+
+        AsyncIO(const AsyncIO &) = delete;
+        AsyncIO &operator=(const AsyncIO &) = delete;
+        AsyncIO(AsyncIO &&) = delete;
+        AsyncIO &operator=(AsyncIO &&) = delete;
+
+        /// Queue a read of size bytes at offset into buffer.
+        void read(const BinaryFile &file, uint64_t offset, std::uint8_t *buffer, size_t size, Completion completion)
+        {
+            enqueue(new Operation{&file, false, offset, buffer, nullptr, size, std::move(completion)});
+        }
+
+        /// Queue a write of data at offset.
+        void write(const BinaryFile &file, uint64_t offset, const memory_view &data, Completion completion)
+        {
+            enqueue(new Operation{&file, true, offset, nullptr, data.data(), data.size(), std::move(completion)});
+        }
+
+        /// Queue a read; the future becomes ready when it completes (after submit()).
+        std::future<Result> read(const BinaryFile &file, uint64_t offset, std::uint8_t *buffer, size_t size)
+        {
+            auto promise = std::make_shared<std::promise<Result>>();
+            auto future = promise->get_future();
+            read(file, offset, buffer, size, [promise](const Result &result) { promise->set_value(result); });
+            return future;
+        }
+
+        /// Queue a write; the future becomes ready when it completes (after submit()).
+        std::future<Result> write(const BinaryFile &file, uint64_t offset, const memory_view &data)
+        {
+            auto promise = std::make_shared<std::promise<Result>>();
+            auto future = promise->get_future();
+            write(file, offset, data, [promise](const Result &result) { promise->set_value(result); });
+            return future;
+        }
+
+        /// Hand all queued requests to the kernel (or the workers) in one batch.
+        /// Blocks only while more than twice the queue depth is in flight, except in a
+        /// completion callback. After the io_uring completion thread failed, every queued
+        /// request fails right away.
+        /// @return number of requests submitted
+        size_t submit()
+        {
+            std::unique_lock lock{m_mutex};
+            size_t submitted = 0;
+            const bool in_callback = t_completing == this;
+#ifdef PNQ_ASYNC_IO_URING
+            std::vector<Operation *> failed;
+            if (m_broken)
+            {
+                failed.assign(m_pending.begin(), m_pending.end());
+                m_pending.clear();
+            }
+#endif
+
+            while (!m_pending.empty())
+            {
+                // Bound in-flight requests so the completion queue cannot overflow. A callback
+                // runs on the thread that frees the slots, so it must not wait for one.
+                if (in_callback && m_in_flight >= 2 * size_t{m_queue_depth})
+                    break;
+                m_completed.wait(lock, [this] { return m_in_flight < 2 * size_t{m_queue_depth}; });
+
+                const auto batch = std::min(m_pending.size(), 2 * size_t{m_queue_depth} - m_in_flight);
+#ifdef PNQ_ASYNC_IO_URING
+                if (m_use_ring)
+                {
+                    std::vector<io_uring_sqe *> sqes;
+                    std::vector<Operation *> ops;
+                    while (sqes.size() < batch)
+                    {
+                        // Only flush before the first entry: a failed submit must find the whole batch unsubmitted
+                        auto *sqe = sqes.empty() ? get_sqe() : io_uring_get_sqe(&m_ring);
+                        if (!sqe)
+                            break;
+
+                        auto *op = m_pending.front();
+                        m_pending.pop_front();
+                        prepare(sqe, op);
+                        sqes.push_back(sqe);
+                        ops.push_back(op);
+                    }
+
+                    if (ops.empty())
+                    {
+                        PNQ_LOG_ERROR("no free io_uring submission entries");
+                        for (size_t i = 0; i < batch; ++i)
+                        {
+                            failed.push_back(m_pending.front());
+                            m_pending.pop_front();
+                        }
+                        break;
+                    }
+                    if (!submit_locked(sqes))
+                    {
+                        // Nothing reached the kernel: fail the batch instead of leaving it in flight
+                        failed.insert(failed.end(), ops.begin(), ops.end());
+                        break;
+                    }
+                    m_submitted.insert(ops.begin(), ops.end());
+                    m_in_flight += ops.size();
+                    submitted += ops.size();
+                    continue;
+                }
+#endif
+                for (size_t i = 0; i < batch; ++i)
+                {
+                    m_work.push_back(m_pending.front());
+                    m_pending.pop_front();
+                }
+                m_in_flight += batch;
+                submitted += batch;
+                m_work_available.notify_all();
+            }
+#ifdef PNQ_ASYNC_IO_URING
+            if (!failed.empty())
+            {
+                // Requests queued after the failed batch stay pending for the next submit()
+                m_in_flight += failed.size();
+                lock.unlock();
+                for (auto *op : failed)
+                    complete(op, Result{});
+            }
+#endif
+            return submitted;
+        }
+
+        /// Block until every submitted request has completed (and its callback has returned).
+        /// Must not be called from a completion callback.
+        void wait_all()
+        {
+            std::unique_lock lock{m_mutex};
+            m_completed.wait(lock, [this] { return m_in_flight == 0; });
+        }
+
+        /// Number of requests queued but not yet submitted.
+        size_t pending() const
+        {
+            std::lock_guard lock{m_mutex};
+            return m_pending.size();
+        }
+
+        /// Check whether requests go through io_uring (false: worker threads).
+        bool uses_io_uring() const
+        {
+            return m_use_ring;
+        }
+
+    private:
+        struct Operation
+        {
+            const BinaryFile *file;
+            bool is_write;
+            uint64_t offset;
+            std::uint8_t *target;
+            const std::uint8_t *source;
+            size_t size;
+            Completion completion;
+
+            /// Bytes transferred so far (io_uring continues short transfers)
+            size_t done{0};
+        };
+
+        void enqueue(Operation *op)
+        {
+            std::lock_guard lock{m_mutex};
+            m_pending.push_back(op);
+        }
+
+        void complete(Operation *op, const Result &result)
+        {
+            if (op->completion)
+            {
+                const auto *outer = t_completing;
+                t_completing = this;
+                op->completion(result);
+                t_completing = outer;
+            }
+
+            {
+                std::lock_guard lock{m_mutex};
+#ifdef PNQ_ASYNC_IO_URING
+                m_submitted.erase(op);
+#endif
+                --m_in_flight;
+            }
+            delete op;
+            m_completed.notify_all();
+        }
+
+        /// Worker thread for the portable backend.
+        void work()
+        {
+            for (;;)
+            {
+                Operation *op;
+                {
+                    std::unique_lock lock{m_mutex};
+                    m_work_available.wait(lock, [this] { return m_stopping || !m_work.empty(); });
+                    if (m_work.empty())
+                        return;
+                    op = m_work.front();
+                    m_work.pop_front();
+                }
+
+                Result result;
+                if (op->is_write)
+                {
+                    result.success = op->file->write_at(op->offset, memory_view{op->source, op->size});
+                    result.bytes = result.success ? op->size : 0;
+                }
+                else
+                {
+                    result.success = op->file->read_at(op->offset, op->target, op->size, result.bytes);
+                }
+                complete(op, result);
+            }
+        }
+
+#ifdef PNQ_ASYNC_IO_URING
+        /// Largest transfer per request; the SQE length is 32 bits, so bigger requests take several.
+        static constexpr size_t max_ring_transfer = size_t{1} << 30;
+
+        /// Fill sqe with the part of op that is not transferred yet.
+        static void prepare(io_uring_sqe *sqe, Operation *op)
+        {
+            const int fd = op->file->native_handle();
+            const auto size = static_cast<unsigned>(std::min(op->size - op->done, max_ring_transfer));
+            if (op->is_write)
+                io_uring_prep_write(sqe, fd, op->source + op->done, size, op->offset + op->done);
+            else
+                io_uring_prep_read(sqe, fd, op->target + op->done, size, op->offset + op->done);
+            io_uring_sqe_set_data(sqe, op);
+        }
+
+        /// Marks SQEs whose submission failed; their completions are ignored.
+        void *cancelled_tag()
+        {
+            return &m_ring;
+        }
+
+        /// Get a free SQE, flushing the submission queue once if it is full. Caller holds m_mutex.
+        io_uring_sqe *get_sqe()
+        {
+            auto *sqe = io_uring_get_sqe(&m_ring);
+            if (!sqe && io_uring_submit(&m_ring) >= 0)
+                sqe = io_uring_get_sqe(&m_ring);
+            return sqe;
+        }
+
+        /// Submit the prepared sqes. Caller holds m_mutex.
+        /// @return false if the kernel took none of them; they are turned into ignored nops
+        bool submit_locked(const std::vector<io_uring_sqe *> &sqes)
+        {
+            int rc;
+            do
+                rc = io_uring_submit(&m_ring);
+            while (rc == -EINTR);
+            if (rc >= 0)
+                return true;
+
+            errno = -rc;
+            PNQ_LOG_ERRNO("io_uring_submit failed");
+
+            // They are in the submission queue already; a later submit must not run them
+            for (auto *sqe : sqes)
+            {
+                io_uring_prep_nop(sqe);
+                io_uring_sqe_set_data(sqe, cancelled_tag());
+            }
+            return false;
+        }
+
+        /// Queue the rest of a short transfer.
+        /// @return false if it could not be submitted
+        bool resubmit(Operation *op)
+        {
+            std::lock_guard lock{m_mutex};
+            auto *sqe = get_sqe();
+            if (!sqe)
+            {
+                PNQ_LOG_ERROR("no io_uring submission entry for the rest of a short transfer");
+                return false;
+            }
+            prepare(sqe, op);
+            return submit_locked({sqe});
+        }
+
+        /// Fail every request the kernel still has once nothing reaps completions anymore,
+        /// so wait_all() and the destructor don't wait forever; later submits fail too.
+        /// The kernel may still finish those transfers until the ring is torn down.
+        void abandon()
+        {
+            std::vector<Operation *> orphaned;
+            {
+                std::lock_guard lock{m_mutex};
+                m_broken = true;
+                orphaned.assign(m_submitted.begin(), m_submitted.end());
+                m_submitted.clear();
+            }
+            for (auto *op : orphaned)
+                complete(op, Result{false, op->done});
+        }
+
+        /// Completion thread for the io_uring backend.
+        void reap()
+        {
+            for (;;)
+            {
+                // The constructor made sure this passes the timeout to the kernel instead of queueing
+                // a timeout request, so it never touches the submission queue submit() fills
+                io_uring_cqe *cqe = nullptr;
+                __kernel_timespec timeout{0, 100'000'000};
+                const int rc = io_uring_wait_cqe_timeout(&m_ring, &cqe, &timeout);
+                if (rc == -EINTR || rc == -EAGAIN || rc == -EBUSY)
+                    continue;
+                if (rc == -ETIME)
+                {
+                    std::lock_guard lock{m_mutex};
+                    if (m_stopping)
+                        return;
+                    continue;
+                }
+                if (rc < 0)
+                {
+                    errno = -rc;
+                    PNQ_LOG_ERRNO("io_uring_wait_cqe failed");
+                    abandon();
+                    return;
+                }
+
+                void *data = io_uring_cqe_get_data(cqe);
+                const int res = cqe->res;
+                io_uring_cqe_seen(&m_ring, cqe);
+
+                // The shutdown nop carries no operation
+                if (!data)
+                    return;
+                if (data == cancelled_tag())
+                    continue;
+
+                auto *op = static_cast<Operation *>(data);
+                if (res < 0)
+                {
+                    errno = -res;
+                    PNQ_LOG_ERRNO("async {} of {} bytes at {} failed", op->is_write ? "write" : "read", op->size, op->offset);
+                    complete(op, Result{false, op->done});
+                    continue;
+                }
+
+                // Like read_at/write_at: continue short transfers, a read ends at end of file
+                op->done += static_cast<size_t>(res);
+                if (res == 0 && op->is_write)
+                {
+                    PNQ_LOG_ERROR("async write of {} bytes at {} stopped after {} bytes", op->size, op->offset, op->done);
+                    complete(op, Result{false, op->done});
+                }
+                else if (res == 0 || op->done == op->size)
+                    complete(op, Result{true, op->done});
+                else if (!resubmit(op))
+                    complete(op, Result{false, op->done});
+            }
+        }
+
+        io_uring m_ring{};
+        std::thread m_reaper;
+
+        /// Requests handed to the kernel and not completed yet
+        std::unordered_set<Operation *> m_submitted;
+
+        /// Set once the completion thread has stopped on an error
+        bool m_broken{false};
+#endif
+
+        /// The AsyncIO whose completion callback this thread is running, if any
+        static inline thread_local const AsyncIO *t_completing{nullptr};
+
+        const unsigned m_queue_depth;
+        bool m_use_ring{false};
+        mutable std::mutex m_mutex;
+        std::condition_variable m_completed;
+        std::condition_variable m_work_available;
+        std::deque<Operation *> m_pending;
+        std::deque<Operation *> m_work;
+        std::vector<std::thread> m_workers;
+        size_t m_in_flight{0};
+        bool m_stopping{false};
+    };
+} // namespace pnq
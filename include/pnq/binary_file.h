@@ -1,17 +1,117 @@
 #pragma once
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
 #include <format>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include <pnq/platform.h>
+#include <pnq/memory_view.h>
+#include <pnq/logging.h>
+
+#ifdef PNQ_PLATFORM_WINDOWS
 #include <pnq/string.h>
 #include <pnq/win32/handle.h>
 #include <pnq/win32/security_attributes.h>
-#include <pnq/memory_view.h>
-#include <pnq/logging.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
 
 namespace pnq
 {
+    /// Required alignment of buffers, offsets and sizes for file_options::direct.
+    inline constexpr size_t direct_io_alignment = 4096;
+
+    /// Options for opening a BinaryFile.
+    enum class file_options : uint32_t
+    {
+        /// No specific options.
+        none = 0,
+
+        /// File will be read/written front to back (FILE_FLAG_SEQUENTIAL_SCAN / POSIX_FADV_SEQUENTIAL).
+        sequential = 1,
+
+        /// File will be accessed at random offsets (FILE_FLAG_RANDOM_ACCESS / POSIX_FADV_RANDOM).
+        random_access = 2,
+
+        /// Bypass the OS page cache (FILE_FLAG_NO_BUFFERING / O_DIRECT / F_NOCACHE).
+        /// Buffers, offsets and sizes must then be multiples of direct_io_alignment;
+        /// use AlignedBuffer for the memory.
+        direct = 4,
+    };
+
+    /// Bitwise OR for file_options.
+    inline constexpr file_options operator|(file_options a, file_options b)
+    {
+        return static_cast<file_options>(
+            static_cast<uint32_t>(a) | static_cast<uint32_t>(b));
+    }
+
+    /// Bitwise AND for file_options.
+    inline constexpr file_options operator&(file_options a, file_options b)
+    {
+        return static_cast<file_options>(
+            static_cast<uint32_t>(a) & static_cast<uint32_t>(b));
+    }
+
+    /// Check if a flag is set in file_options.
+    inline constexpr bool has_flag(file_options set, file_options test)
+    {
+        return (static_cast<uint32_t>(set) & static_cast<uint32_t>(test)) ==
+               static_cast<uint32_t>(test);
+    }
+
+    /// Heap buffer with the alignment required for file_options::direct I/O.
+    class AlignedBuffer final
+    {
+    public:
+        explicit AlignedBuffer(size_t size, size_t alignment = direct_io_alignment)
+            : m_data{static_cast<std::uint8_t *>(::operator new(size ? size : 1, std::align_val_t{alignment}))},
+              m_size{size},
+              m_alignment{alignment}
+        {
+        }
+
+        ~AlignedBuffer()
+        {
+            ::operator delete(m_data, std::align_val_t{m_alignment});
+        }
+
+        AlignedBuffer(const AlignedBuffer &) = delete;
+        AlignedBuffer &operator=(const AlignedBuffer &) = delete;
+        AlignedBuffer(AlignedBuffer &&) = delete;
+        AlignedBuffer &operator=(AlignedBuffer &&) = delete;
+
+        std::uint8_t *data() { return m_data; }
+        const std::uint8_t *data() const { return m_data; }
+        size_t size() const { return m_size; }
+
+        /// View the whole buffer.
+        memory_view view() const { return {m_data, m_size}; }
+
+    private:
+        std::uint8_t *const m_data;
+        const size_t m_size;
+        const size_t m_alignment;
+    };
+
     /// Binary file I/O with optional write caching.
+    /// Windows uses CreateFileW/ReadFile/WriteFile, other platforms use POSIX file descriptors.
+    ///
+    /// With set_write_buffers() the cache becomes write-behind: full buffers are written by a
+    /// background thread while write() keeps filling the next one.
     class BinaryFile final
     {
     public:
@@ -23,6 +123,7 @@ namespace pnq
         ~BinaryFile()
         {
             close();
+            stop_flusher();
         }
 
         BinaryFile(const BinaryFile &) = delete;
@@ -32,83 +133,67 @@ namespace pnq
 
         /// Open or create file for appending.
         /// @param filename path to file
+        /// @param options access pattern / caching options
         /// @return true if successful
-        bool create_or_open_for_write_append(std::string_view filename)
+        bool create_or_open_for_write_append(std::string_view filename, file_options options = file_options::none)
         {
-            win32::SecurityAttributes sa;
-
-            const auto handle = ::CreateFileW(string::encode_as_utf16(filename).c_str(),
-                GENERIC_WRITE,
-                FILE_SHARE_READ,
-                sa.default_access(),
-                OPEN_ALWAYS,
-                FILE_ATTRIBUTE_NORMAL,
-                nullptr);
-            if (!win32::Handle::is_valid(handle))
-            {
-                PNQ_LOG_LAST_ERROR( "CreateFile('{}') failed", filename);
+#ifdef PNQ_PLATFORM_WINDOWS
+            if (!open_handle(filename, GENERIC_WRITE, FILE_SHARE_READ, OPEN_ALWAYS, options))
                 return false;
-            }
-            m_file.set(handle);
+
             LARGE_INTEGER offset{0};
-            if (!::SetFilePointerEx(handle, offset, nullptr, FILE_END))
+            if (!::SetFilePointerEx(m_file, offset, nullptr, FILE_END))
             {
                 PNQ_LOG_LAST_ERROR( "SetFilePointerEx failed");
                 m_file.close();
                 return false;
             }
             return true;
+#else
+            // Seek to the end instead of O_APPEND, which would make pwrite ignore its offset (as on Windows)
+            if (!open_fd(filename, O_WRONLY | O_CREAT, options))
+                return false;
+
+            if (::lseek(m_fd, 0, SEEK_END) < 0)
+            {
+                PNQ_LOG_ERRNO("lseek failed");
+                close();
+                return false;
+            }
+            return true;
+#endif
         }
 
         /// Create file for writing (truncates existing).
         /// @param filename path to file
+        /// @param options access pattern / caching options
         /// @return true if successful
-        bool create_for_writing(std::string_view filename)
+        bool create_for_writing(std::string_view filename, file_options options = file_options::none)
         {
-            win32::SecurityAttributes sa;
-
-            const auto handle = ::CreateFileW(string::encode_as_utf16(filename).c_str(),
-                GENERIC_WRITE,
-                FILE_SHARE_READ,
-                sa.default_access(),
-                CREATE_ALWAYS,
-                FILE_ATTRIBUTE_NORMAL,
-                nullptr);
-            if (!win32::Handle::is_valid(handle))
-            {
-                PNQ_LOG_LAST_ERROR( "CreateFile('{}') failed", filename);
-                return false;
-            }
-            m_file.set(handle);
-            return true;
+#ifdef PNQ_PLATFORM_WINDOWS
+            return open_handle(filename, GENERIC_WRITE, FILE_SHARE_READ, CREATE_ALWAYS, options);
+#else
+            return open_fd(filename, O_WRONLY | O_CREAT | O_TRUNC, options);
+#endif
         }
 
         /// Open existing file for reading.
         /// @param filename path to file
+        /// @param options access pattern / caching options
         /// @return true if successful
-        bool open_for_reading(std::string_view filename)
+        bool open_for_reading(std::string_view filename, file_options options = file_options::none)
         {
-            win32::SecurityAttributes sa;
-
-            const auto handle = ::CreateFileW(string::encode_as_utf16(filename).c_str(),
-                GENERIC_READ,
-                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-                sa.default_access(),
-                OPEN_EXISTING,
-                FILE_ATTRIBUTE_NORMAL,
-                nullptr);
-            if (!win32::Handle::is_valid(handle))
-            {
-                PNQ_LOG_LAST_ERROR( "CreateFile('{}') failed", filename);
-                return false;
-            }
-            m_file.set(handle);
-            return true;
+#ifdef PNQ_PLATFORM_WINDOWS
+            return open_handle(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, OPEN_EXISTING, options);
+#else
+            return open_fd(filename, O_RDONLY, options);
+#endif
         }
 
         /// Get file size in bytes.
         uint64_t get_file_size() const
         {
+#ifdef PNQ_PLATFORM_WINDOWS
             LARGE_INTEGER file_size{0};
             if (!GetFileSizeEx(m_file, &file_size))
             {
@@ -116,6 +201,15 @@ namespace pnq
                 return 0;
             }
             return file_size.QuadPart;
+#else
+            struct stat st{};
+            if (::fstat(m_fd, &st) != 0)
+            {
+                PNQ_LOG_ERRNO("fstat failed");
+                return 0;
+            }
+            return static_cast<uint64_t>(st.st_size);
+#endif
         }
 
         /// Read entire file into buffer.
@@ -128,7 +222,7 @@ namespace pnq
             result.clear();
 
             BinaryFile bf;
-            if (!bf.open_for_reading(filename))
+            if (!bf.open_for_reading(filename, file_options::sequential))
                 return false;
 
             const size_t expected_file_size = static_cast<size_t>(bf.get_file_size());
@@ -141,8 +235,8 @@ namespace pnq
 
             if (expected_file_size > 0)
             {
-                DWORD bytes_actually_read = 0;
-                if (!bf.raw_read(result.data(), static_cast<DWORD>(expected_file_size), bytes_actually_read))
+                size_t bytes_actually_read = 0;
+                if (!bf.read_at(0, result.data(), expected_file_size, bytes_actually_read))
                     return false;
 
                 if (bytes_actually_read < expected_file_size)
@@ -165,14 +259,14 @@ namespace pnq
         /// @return true if successful
         bool read(bytes &result) const
         {
-            const DWORD bytes_available = static_cast<DWORD>(result.size());
+            const size_t bytes_available = result.size();
             if (bytes_available == 0)
             {
                 PNQ_LOG_ERROR("BinaryFile::read() called with empty buffer");
                 return false;
             }
 
-            DWORD bytes_actually_read = 0;
+            size_t bytes_actually_read = 0;
             if (!raw_read(result.data(), bytes_available, bytes_actually_read))
                 return false;
 
@@ -183,6 +277,97 @@ namespace pnq
             return true;
         }
 
+        /// Read at an absolute offset without using or moving the shared file position (pread).
+        /// On Windows the file pointer does move, as with any synchronous ReadFile.
+        /// Loops until size bytes are read or end of file is reached.
+        /// @param offset byte offset from start of file
+        /// @param data buffer to read into
+        /// @param size number of bytes to read
+        /// @param bytes_actually_read receives number of bytes read (less than size only at end of file)
+        /// @return true if successful
+        bool read_at(uint64_t offset, std::uint8_t *data, size_t size, size_t &bytes_actually_read) const
+        {
+            bytes_actually_read = 0;
+            while (bytes_actually_read < size)
+            {
+                size_t chunk = 0;
+                if (!raw_read_at(offset + bytes_actually_read, data + bytes_actually_read, size - bytes_actually_read, chunk))
+                    return false;
+                if (chunk == 0)
+                    break;
+                bytes_actually_read += chunk;
+            }
+            return true;
+        }
+
+        /// Write at an absolute offset without using or moving the shared file position (pwrite).
+        /// Bypasses the write cache; call flush() first if cached and positional writes overlap.
+        /// @param offset byte offset from start of file
+        /// @param data data to write
+        /// @return true if successful
+        bool write_at(uint64_t offset, const memory_view &data) const
+        {
+            size_t written = 0;
+            while (written < data.size())
+            {
+                size_t chunk = 0;
+                if (!raw_write_at(offset + written, data.data() + written, data.size() - written, chunk))
+                    return false;
+                written += chunk;
+            }
+            return true;
+        }
+
+        /// Write several fragments at an absolute offset, in order (pwritev).
+        /// Bypasses the write cache, like write_at(offset, data).
+        /// @param offset byte offset from start of file
+        /// @param fragments data to write back to back
+        /// @return true if successful
+        bool write_at(uint64_t offset, std::span<const memory_view> fragments) const
+        {
+            return raw_write_gather(fragments, &offset);
+        }
+
+        /// Reserve disk space for size bytes without changing the file size (fallocate / FileAllocationInfo).
+        /// Avoids fragmentation and repeated metadata updates when writing large exports.
+        /// @param size number of bytes to reserve
+        /// @return true if successful (or not supported by the file system)
+        bool preallocate(uint64_t size) const
+        {
+#ifdef PNQ_PLATFORM_WINDOWS
+            FILE_ALLOCATION_INFO info{};
+            info.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+            if (!::SetFileInformationByHandle(m_file, FileAllocationInfo, &info, sizeof(info)))
+            {
+                PNQ_LOG_LAST_ERROR( "SetFileInformationByHandle(FileAllocationInfo) failed");
+                return false;
+            }
+            return true;
+#elif defined(PNQ_PLATFORM_LINUX)
+            if (::fallocate(m_fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size)) != 0)
+            {
+                // Not every file system supports it; that is not an error for a hint
+                if (errno == EOPNOTSUPP || errno == ENOSYS)
+                    return true;
+                PNQ_LOG_ERRNO("fallocate({}) failed", size);
+                return false;
+            }
+            return true;
+#else
+            fstore_t store{F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, static_cast<off_t>(size), 0};
+            if (::fcntl(m_fd, F_PREALLOCATE, &store) != 0)
+            {
+                store.fst_flags = F_ALLOCATEALL;
+                if (::fcntl(m_fd, F_PREALLOCATE, &store) != 0)
+                {
+                    PNQ_LOG_ERRNO("fcntl(F_PREALLOCATE, {}) failed", size);
+                    return false;
+                }
+            }
+            return true;
+#endif
+        }
+
         /// Write entire buffer to new file.
         /// @param filename path to file
         /// @param data data to write
@@ -191,7 +376,7 @@ namespace pnq
         {
             BinaryFile bf;
 
-            if (!bf.create_for_writing(filename))
+            if (!bf.create_for_writing(filename, file_options::sequential))
                 return false;
 
             return bf.raw_write(data.data(), data.size());
@@ -216,15 +401,41 @@ namespace pnq
             return write(data.data(), data.size());
         }
 
+        /// Write several fragments in order without concatenating them first (writev).
+        /// With the cache enabled the fragments are copied into it as usual.
+        /// @param fragments data to write back to back
+        /// @return true if successful
+        bool write(std::span<const memory_view> fragments)
+        {
+            if (m_cache.empty())
+                return raw_write_gather(fragments, nullptr);
+
+            size_t total = 0;
+            for (const auto &fragment : fragments)
+                total += fragment.size();
+
+            // A synchronous cache would be flushed anyway; write the fragments directly after it
+            if (!m_flusher && m_cache_write_pos + total >= m_cache.size())
+                return flush() && raw_write_gather(fragments, nullptr);
+
+            for (const auto &fragment : fragments)
+            {
+                if (!cached_write(fragment.data(), fragment.size()))
+                    return false;
+            }
+            return true;
+        }
+
         /// Write C string.
         bool write(const char *text)
         {
-            return write(reinterpret_cast<const std::uint8_t *>(text), string::length(text));
+            return write(reinterpret_cast<const std::uint8_t *>(text), std::strlen(text));
         }
 
         /// Get current file position.
         uint64_t get_absolute_file_position() const
         {
+#ifdef PNQ_PLATFORM_WINDOWS
             const LARGE_INTEGER offset{0};
             LARGE_INTEGER new_pos{0};
             if (!SetFilePointerEx(m_file, offset, &new_pos, FILE_CURRENT))
@@ -232,13 +443,24 @@ namespace pnq
                 PNQ_LOG_LAST_ERROR( "GetFilePosition failed");
             }
             return new_pos.QuadPart;
+#else
+            const auto pos = ::lseek(m_fd, 0, SEEK_CUR);
+            if (pos < 0)
+            {
+                PNQ_LOG_ERRNO("lseek failed");
+                return 0;
+            }
+            return static_cast<uint64_t>(pos);
+#endif
         }
 
         /// Set absolute file position.
+        /// Cached data is written at the position current when it is flushed, so flush() first.
         /// @param position byte offset from start
         /// @return true if successful
         bool set_absolute_file_position(uint64_t position) const
         {
+#ifdef PNQ_PLATFORM_WINDOWS
             LARGE_INTEGER offset;
             offset.QuadPart = position;
             LARGE_INTEGER new_pos{0};
@@ -248,32 +470,89 @@ namespace pnq
                 return false;
             }
             return true;
+#else
+            if (::lseek(m_fd, static_cast<off_t>(position), SEEK_SET) < 0)
+            {
+                PNQ_LOG_ERRNO("lseek({}) failed", position);
+                return false;
+            }
+            return true;
+#endif
         }
 
         /// Flush cache and close file.
         void close()
         {
             flush();
+#ifdef PNQ_PLATFORM_WINDOWS
             m_file.close();
+#else
+            if (m_fd >= 0)
+            {
+                ::close(m_fd);
+                m_fd = -1;
+            }
+#endif
+        }
+
+#ifdef PNQ_PLATFORM_WINDOWS
+        /// Get the underlying file handle (for APIs BinaryFile does not wrap).
+        HANDLE native_handle() const
+        {
+            return m_file;
+        }
+#else
+        /// Get the underlying file descriptor (for APIs BinaryFile does not wrap).
+        int native_handle() const
+        {
+            return m_fd;
         }
+#endif
 
         /// Check if file handle is valid.
         bool is_valid() const
         {
+#ifdef PNQ_PLATFORM_WINDOWS
             return m_file.is_valid();
+#else
+            return m_fd >= 0;
+#endif
         }
 
         /// Set write cache size (0 disables caching).
+        /// The cache is written synchronously whenever it fills; see set_write_buffers().
         void set_cache_size(size_t size)
         {
-            if (size == 0)
+            set_write_buffers(size, 1);
+        }
+
+        /// Configure write buffering.
+        /// With more than one buffer, a full buffer is handed to a background thread and
+        /// write() continues in the next one; it only blocks when all buffers are waiting
+        /// to be written. Errors of background writes are reported by the next write() or flush().
+        /// @param buffer_size size of each buffer in bytes (0 disables caching)
+        /// @param buffer_count number of buffers (1 = synchronous cache, 2 = double buffering)
+        /// @return true if data cached so far was written successfully
+        bool set_write_buffers(size_t buffer_size, size_t buffer_count = 2)
+        {
+            const bool result = flush();
+            stop_flusher();
+            m_cache_write_pos = 0;
+
+            if (buffer_size == 0 || buffer_count == 0)
             {
                 m_cache.clear();
+                return result;
             }
-            else
+
+            m_cache.resize(buffer_size);
+            if (buffer_count > 1)
             {
-                m_cache.resize(size);
+                m_flusher = std::make_unique<Flusher>();
+                m_flusher->spare.resize(buffer_count - 1, bytes(buffer_size));
+                m_flusher->thread = std::thread{[this] { flusher_thread(); }};
             }
+            return result;
         }
 
         /// Check if write caching is enabled.
@@ -282,30 +561,244 @@ namespace pnq
             return !m_cache.empty();
         }
 
-        /// Flush write cache to disk.
+        /// Write all cached data to the OS and wait until the background writer is idle.
+        /// Data is then visible to other readers of the file, but not necessarily on disk; see sync().
+        /// @return false if this or any earlier cached write failed
         bool flush()
         {
-            if (!has_cache() || !m_cache_write_pos)
+            if (!has_cache())
                 return true;
 
-            const bool result = raw_write(m_cache.data(), m_cache_write_pos);
-            m_cache_write_pos = 0;
+            if (!m_flusher)
+            {
+                if (!m_cache_write_pos)
+                    return true;
+
+                const bool result = raw_write(m_cache.data(), m_cache_write_pos);
+                m_cache_write_pos = 0;
+                return result;
+            }
+
+            bool result = !m_cache_write_pos || hand_off();
+
+            std::unique_lock lock{m_flusher->mutex};
+            m_flusher->changed.wait(lock, [this] { return m_flusher->queue.empty() && !m_flusher->busy; });
+            if (std::exchange(m_flusher->failed, false))
+                result = false;
             return result;
         }
 
+        /// Flush the cache and commit the file contents to disk (FlushFileBuffers / fsync).
+        /// @return true if successful
+        bool sync()
+        {
+            if (!flush() || !is_valid())
+                return false;
+
+#ifdef PNQ_PLATFORM_WINDOWS
+            if (!::FlushFileBuffers(m_file))
+            {
+                PNQ_LOG_LAST_ERROR( "FlushFileBuffers failed");
+                return false;
+            }
+#else
+            if (::fsync(m_fd) != 0)
+            {
+                PNQ_LOG_ERRNO("fsync failed");
+                return false;
+            }
+#endif
+            return true;
+        }
+
     private:
+#ifdef PNQ_PLATFORM_WINDOWS
+        bool open_handle(std::string_view filename, DWORD access, DWORD share_mode, DWORD disposition, file_options options)
+        {
+            win32::SecurityAttributes sa;
+
+            DWORD flags = FILE_ATTRIBUTE_NORMAL;
+            if (has_flag(options, file_options::sequential))
+                flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+            if (has_flag(options, file_options::random_access))
+                flags |= FILE_FLAG_RANDOM_ACCESS;
+            if (has_flag(options, file_options::direct))
+                flags |= FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH;
+
+            const auto handle = ::CreateFileW(string::encode_as_utf16(filename).c_str(),
+                access,
+                share_mode,
+                sa.default_access(),
+                disposition,
+                flags,
+                nullptr);
+            if (!win32::Handle::is_valid(handle))
+            {
+                PNQ_LOG_LAST_ERROR( "CreateFile('{}') failed", filename);
+                return false;
+            }
+            m_file.set(handle);
+            return true;
+        }
+#else
+        bool open_fd(std::string_view filename, int flags, file_options options)
+        {
+            flags |= O_CLOEXEC;
+#ifdef PNQ_PLATFORM_LINUX
+            if (has_flag(options, file_options::direct))
+                flags |= O_DIRECT;
+#endif
+
+            const std::string path{filename};
+            int fd;
+            do
+            {
+                fd = ::open(path.c_str(), flags, 0666);
+            } while (fd < 0 && errno == EINTR);
+
+            if (fd < 0)
+            {
+                PNQ_LOG_ERRNO("open('{}') failed", filename);
+                return false;
+            }
+            m_fd = fd;
+
+#ifdef PNQ_PLATFORM_LINUX
+            // Access pattern hints; failures are harmless
+            if (has_flag(options, file_options::sequential))
+                ::posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            if (has_flag(options, file_options::random_access))
+                ::posix_fadvise(m_fd, 0, 0, POSIX_FADV_RANDOM);
+#else
+            if (has_flag(options, file_options::sequential))
+                ::fcntl(m_fd, F_RDAHEAD, 1);
+            if (has_flag(options, file_options::random_access))
+                ::fcntl(m_fd, F_RDAHEAD, 0);
+            if (has_flag(options, file_options::direct))
+                ::fcntl(m_fd, F_NOCACHE, 1);
+#endif
+            return true;
+        }
+#endif
+
         bool raw_write(const std::uint8_t *memory, size_t size) const
         {
-            if (!m_file.is_valid())
+            if (!is_valid())
                 return false;
 
+#ifdef PNQ_PLATFORM_WINDOWS
             DWORD bytes_written = 0;
             if (!::WriteFile(m_file, memory, static_cast<DWORD>(size), &bytes_written, nullptr))
             {
-                PNQ_LOG_LAST_ERROR( "WriteFile failed");
+                PNQ_LOG_LAST_ERROR_RATELIMITED(10, "WriteFile failed");
+                return false;
+            }
+            return true;
+#else
+            while (size)
+            {
+                const auto rc = ::write(m_fd, memory, size);
+                if (rc < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    PNQ_LOG_ERRNO_RATELIMITED(10, "write failed");
+                    return false;
+                }
+                memory += rc;
+                size -= static_cast<size_t>(rc);
+            }
+            return true;
+#endif
+        }
+
+        /// Write fragments back to back, at *offset if given, else at the file position.
+        bool raw_write_gather(std::span<const memory_view> fragments, const uint64_t *offset) const
+        {
+            if (!is_valid())
                 return false;
+
+#ifdef PNQ_PLATFORM_WINDOWS
+            // WriteFileGather only works on unbuffered handles with page-sized, page-aligned
+            // fragments, so small fragments are coalesced into one WriteFile instead
+            std::uint8_t staging[16384];
+            size_t staged = 0;
+            uint64_t position = offset ? *offset : 0;
+
+            const auto emit = [&](const std::uint8_t *data, size_t size)
+            {
+                if (!offset)
+                    return raw_write(data, size);
+                if (!write_at(position, memory_view{data, size}))
+                    return false;
+                position += size;
+                return true;
+            };
+
+            for (const auto &fragment : fragments)
+            {
+                if (staged + fragment.size() > sizeof(staging))
+                {
+                    if (staged && !emit(staging, staged))
+                        return false;
+                    staged = 0;
+                }
+
+                if (fragment.size() >= sizeof(staging))
+                {
+                    if (!emit(fragment.data(), fragment.size()))
+                        return false;
+                }
+                else if (fragment.size())
+                {
+                    std::memcpy(staging + staged, fragment.data(), fragment.size());
+                    staged += fragment.size();
+                }
+            }
+            return !staged || emit(staging, staged);
+#else
+            uint64_t position = offset ? *offset : 0;
+            size_t index = 0;
+            size_t done = 0; // bytes of fragments[index] already written
+
+            while (index < fragments.size())
+            {
+                // Stay well below IOV_MAX; the loop picks up the rest
+                iovec vectors[64];
+                int count = 0;
+                for (size_t i = index; i < fragments.size() && count < 64; ++i)
+                {
+                    const size_t skip = (i == index) ? done : 0;
+                    vectors[count].iov_base = const_cast<std::uint8_t *>(fragments[i].data()) + skip;
+                    vectors[count].iov_len = fragments[i].size() - skip;
+                    ++count;
+                }
+
+                ssize_t rc;
+                do
+                {
+                    rc = offset ? ::pwritev(m_fd, vectors, count, static_cast<off_t>(position)) : ::writev(m_fd, vectors, count);
+                } while (rc < 0 && errno == EINTR);
+
+                if (rc < 0)
+                {
+                    PNQ_LOG_ERRNO_RATELIMITED(10, "{} of {} fragments failed", offset ? "pwritev" : "writev", count);
+                    return false;
+                }
+                position += static_cast<uint64_t>(rc);
+
+                // Skip the fragments written completely, then remember how far into the next one we got
+                auto written = static_cast<size_t>(rc);
+                while (index < fragments.size() && written >= fragments[index].size() - done)
+                {
+                    written -= fragments[index].size() - done;
+                    done = 0;
+                    ++index;
+                }
+                done += written;
             }
             return true;
+#endif
         }
 
         bool cached_write(const std::uint8_t *memory, size_t size)
@@ -325,6 +818,23 @@ namespace pnq
                 return true;
             }
 
+            // Write-behind: fill the buffers in turn and let the flusher write them
+            if (m_flusher)
+            {
+                while (size)
+                {
+                    const auto chunk = std::min(size, cache_size - m_cache_write_pos);
+                    std::memcpy(&m_cache[m_cache_write_pos], memory, chunk);
+                    m_cache_write_pos += chunk;
+                    memory += chunk;
+                    size -= chunk;
+
+                    if (m_cache_write_pos == cache_size && !hand_off())
+                        return false;
+                }
+                return true;
+            }
+
             // We need to flush at some point anyway
             flush();
 
@@ -347,18 +857,181 @@ namespace pnq
             return true;
         }
 
-        bool raw_read(std::uint8_t *data, DWORD bytes_to_read, DWORD &bytes_actually_read) const
+        /// Queue the current buffer for the flusher and continue in a spare one.
+        /// @return false if a background write has failed
+        bool hand_off()
+        {
+            std::unique_lock lock{m_flusher->mutex};
+            m_flusher->queue.push_back({std::move(m_cache), m_cache_write_pos});
+            m_cache_write_pos = 0;
+            m_flusher->changed.notify_all();
+
+            m_flusher->changed.wait(lock, [this] { return !m_flusher->spare.empty(); });
+            m_cache = std::move(m_flusher->spare.back());
+            m_flusher->spare.pop_back();
+            return !m_flusher->failed;
+        }
+
+        /// Background thread: writes queued buffers in order and returns them as spares.
+        void flusher_thread()
+        {
+            std::unique_lock lock{m_flusher->mutex};
+            for (;;)
+            {
+                m_flusher->changed.wait(lock, [this] { return m_flusher->stopping || !m_flusher->queue.empty(); });
+                if (m_flusher->queue.empty())
+                    return;
+
+                auto [buffer, size] = std::move(m_flusher->queue.front());
+                m_flusher->queue.pop_front();
+                m_flusher->busy = true;
+
+                lock.unlock();
+                const bool result = raw_write(buffer.data(), size);
+                lock.lock();
+
+                m_flusher->busy = false;
+                if (!result)
+                    m_flusher->failed = true;
+                m_flusher->spare.push_back(std::move(buffer));
+                m_flusher->changed.notify_all();
+            }
+        }
+
+        void stop_flusher()
+        {
+            if (!m_flusher)
+                return;
+
+            {
+                std::lock_guard lock{m_flusher->mutex};
+                m_flusher->stopping = true;
+            }
+            m_flusher->changed.notify_all();
+            m_flusher->thread.join();
+            m_flusher.reset();
+        }
+
+        bool raw_read(std::uint8_t *data, size_t bytes_to_read, size_t &bytes_actually_read) const
+        {
+#ifdef PNQ_PLATFORM_WINDOWS
+            DWORD dw_bytes_read = 0;
+            if (!::ReadFile(m_file, data, static_cast<DWORD>(bytes_to_read), &dw_bytes_read, nullptr))
+            {
+                PNQ_LOG_LAST_ERROR_RATELIMITED(10, "ReadFile failed");
+                return false;
+            }
+            bytes_actually_read = dw_bytes_read;
+            return true;
+#else
+            ssize_t rc;
+            do
+            {
+                rc = ::read(m_fd, data, bytes_to_read);
+            } while (rc < 0 && errno == EINTR);
+
+            if (rc < 0)
+            {
+                PNQ_LOG_ERRNO_RATELIMITED(10, "read failed");
+                return false;
+            }
+            bytes_actually_read = static_cast<size_t>(rc);
+            return true;
+#endif
+        }
+
+        bool raw_read_at(uint64_t offset, std::uint8_t *data, size_t bytes_to_read, size_t &bytes_actually_read) const
         {
-            if (!::ReadFile(m_file, data, bytes_to_read, &bytes_actually_read, nullptr))
+#ifdef PNQ_PLATFORM_WINDOWS
+            OVERLAPPED overlapped{};
+            overlapped.Offset = static_cast<DWORD>(offset);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+            // ReadFile takes a DWORD count; larger requests are completed by the read_at loop
+            const auto chunk = static_cast<DWORD>(bytes_to_read > 0x40000000 ? 0x40000000 : bytes_to_read);
+            DWORD dw_bytes_read = 0;
+            if (!::ReadFile(m_file, data, chunk, &dw_bytes_read, &overlapped))
             {
-                PNQ_LOG_LAST_ERROR( "ReadFile failed");
+                if (GetLastError() == ERROR_HANDLE_EOF)
+                {
+                    bytes_actually_read = 0;
+                    return true;
+                }
+                PNQ_LOG_LAST_ERROR_RATELIMITED(10, "ReadFile failed");
                 return false;
             }
+            bytes_actually_read = dw_bytes_read;
             return true;
+#else
+            ssize_t rc;
+            do
+            {
+                rc = ::pread(m_fd, data, bytes_to_read, static_cast<off_t>(offset));
+            } while (rc < 0 && errno == EINTR);
+
+            if (rc < 0)
+            {
+                PNQ_LOG_ERRNO_RATELIMITED(10, "pread({}) failed", offset);
+                return false;
+            }
+            bytes_actually_read = static_cast<size_t>(rc);
+            return true;
+#endif
+        }
+
+        bool raw_write_at(uint64_t offset, const std::uint8_t *data, size_t bytes_to_write, size_t &bytes_written) const
+        {
+#ifdef PNQ_PLATFORM_WINDOWS
+            OVERLAPPED overlapped{};
+            overlapped.Offset = static_cast<DWORD>(offset);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+            const auto chunk = static_cast<DWORD>(bytes_to_write > 0x40000000 ? 0x40000000 : bytes_to_write);
+            DWORD dw_bytes_written = 0;
+            if (!::WriteFile(m_file, data, chunk, &dw_bytes_written, &overlapped))
+            {
+                PNQ_LOG_LAST_ERROR_RATELIMITED(10, "WriteFile failed");
+                return false;
+            }
+            bytes_written = dw_bytes_written;
+            return true;
+#else
+            ssize_t rc;
+            do
+            {
+                rc = ::pwrite(m_fd, data, bytes_to_write, static_cast<off_t>(offset));
+            } while (rc < 0 && errno == EINTR);
+
+            if (rc < 0)
+            {
+                PNQ_LOG_ERRNO_RATELIMITED(10, "pwrite({}) failed", offset);
+                return false;
+            }
+            bytes_written = static_cast<size_t>(rc);
+            return true;
+#endif
         }
 
+#ifdef PNQ_PLATFORM_WINDOWS
         win32::Handle m_file;
+#else
+        int m_fd{-1};
+#endif
+        /// State shared with the background writer (write-behind mode only).
+        struct Flusher
+        {
+            std::mutex mutex;
+            std::condition_variable changed;
+            std::deque<std::pair<bytes, size_t>> queue;
+            std::vector<bytes> spare;
+            std::thread thread;
+            bool busy{false};
+            bool failed{false};
+            bool stopping{false};
+        };
+
         bytes m_cache;
         size_t m_cache_write_pos;
+        std::unique_ptr<Flusher> m_flusher;
     };
 } // namespace pnq
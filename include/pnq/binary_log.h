@@ -0,0 +1,679 @@
+#pragma once
+
+/// @file pnq/binary_log.h
+/// @brief Binary structured logging with deferred formatting.
+///
+/// A log statement only copies its format ID and raw argument bytes into a ring buffer owned
+/// by the calling thread. A background thread writes them to a binary file, and
+/// pnq/binary_log_decoder.h (or the pnq_logdecode tool) formats them later.
+///
+/// Built with PNQ_USE_BINARY_LOG, all PNQ_LOG_* statements go here while binary::start() is
+/// active, and to the regular spdlog/Quill backend otherwise.
+///
+/// This header only depends on the standard library and the backend pnq/log.h includes,
+/// because pnq/log.h includes it and most pnq headers log. Statements are recorded if the
+/// backend's level (see logging::set_level()) lets them through.
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <pnq/log.h>
+
+/// Log through the binary logger if it is active, and through fallback (a PNQ_LOG_AT_* macro) otherwise.
+/// @param lvl one of the PNQ_LOG_LEVEL_* values
+#define PNQ_LOG_BINARY(lvl, fallback, ...) \
+    do { \
+        if (pnq::logging::binary::is_active()) \
+        { \
+            if (pnq::logging::binary::should_log(lvl)) \
+            { \
+                static pnq::logging::binary::CallSite pnq__site{__FILE__, __LINE__}; \
+                pnq::logging::binary::log(pnq__site, lvl, __VA_ARGS__); \
+            } \
+        } \
+        else \
+        { \
+            fallback(__VA_ARGS__); \
+        } \
+    } while (0)
+
+namespace pnq::logging::binary
+{
+    // =========================================================================
+    // File format
+    // =========================================================================
+    //
+    // A file starts with file_magic, followed by records that each start with a record_kind.
+    // Numbers are stored in native (little endian) byte order.
+
+    /// Signature at the start of every binary log file.
+    inline constexpr std::string_view file_magic{"PNQBLOG1"};
+
+    /// Record kinds in a binary log file.
+    enum class record_kind : std::uint8_t
+    {
+        /// u32 id, u8 level, u32 line, u32 length + source file, u32 length + format string
+        format = 'F',
+
+        /// u32 thread, u32 payload size, payload: u32 format id, i64 nanoseconds since 1970, arguments
+        message = 'M',
+
+        /// u32 thread, i64 nanoseconds since 1970, u64 number of statements of that thread that were lost
+        dropped = 'D',
+    };
+
+    /// Type tags of message arguments; each is followed by the argument bytes.
+    enum class arg_tag : std::uint8_t
+    {
+        i64 = 1,   ///< 8 bytes
+        u64,       ///< 8 bytes
+        f64,       ///< 8 bytes
+        boolean,   ///< 1 byte
+        character, ///< 1 byte
+        string,    ///< u32 length + bytes
+        pointer,   ///< 8 bytes
+    };
+
+    /// Longer string arguments are truncated.
+    inline constexpr size_t max_string_size = 16 * 1024;
+
+    /// A log statement; its format string is written to the file once, on first use.
+    struct CallSite
+    {
+        const char* file;
+        std::uint32_t line;
+        std::atomic<std::uint32_t> id{0};
+    };
+
+    // =========================================================================
+    // Per-thread ring buffer
+    // =========================================================================
+
+    /// Single-producer single-consumer ring buffer of variable-size records.
+    /// The owning thread writes, the background thread reads.
+    class Ring final
+    {
+    public:
+        /// @param capacity size in bytes, rounded up to a power of two
+        /// @param thread small number identifying the owning thread in the file
+        Ring(size_t capacity, std::uint32_t thread)
+            : m_capacity{std::bit_ceil(std::max<size_t>(capacity, 4096))},
+              m_data{std::make_unique<std::uint8_t[]>(m_capacity)},
+              m_thread{thread}
+        {
+        }
+
+        Ring(const Ring&) = delete;
+        Ring& operator=(const Ring&) = delete;
+        Ring(Ring&&) = delete;
+        Ring& operator=(Ring&&) = delete;
+
+        /// Reserve size bytes for a record, waiting while the ring is full and the consumer runs.
+        /// A record that is not written is counted (see take_dropped()).
+        /// @param consumer_running cleared when nobody drains the ring any more
+        /// @return pointer to write the record to, or nullptr if it can never fit or the consumer stopped
+        std::uint8_t* begin_write(std::uint32_t size, const std::atomic<bool>& consumer_running)
+        {
+            const size_t needed = align(size_t{size} + sizeof(std::uint32_t));
+            if (needed > m_capacity / 2)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            // Announce the write before checking the consumer: once the consumer is told to stop,
+            // wait_for_writer() either sees the announcement or this thread sees the stop
+            m_writing.store(true, std::memory_order_seq_cst);
+            if (!consumer_running.load(std::memory_order_seq_cst))
+                return abandon_write();
+
+            // Records never wrap; the rest of the ring is skipped instead
+            size_t offset = m_head & (m_capacity - 1);
+            const size_t padding = offset + needed > m_capacity ? m_capacity - offset : 0;
+
+            while (m_capacity - (m_head - m_tail.load(std::memory_order_acquire)) < padding + needed)
+            {
+                if (!consumer_running.load(std::memory_order_acquire))
+                    return abandon_write();
+                std::this_thread::yield();
+            }
+
+            if (padding)
+            {
+                const std::uint32_t skip = 0;
+                std::memcpy(m_data.get() + offset, &skip, sizeof(skip));
+                m_head += padding;
+                offset = 0;
+            }
+
+            std::memcpy(m_data.get() + offset, &size, sizeof(size));
+            m_pending = needed;
+            return m_data.get() + offset + sizeof(std::uint32_t);
+        }
+
+        /// Publish the record reserved by begin_write().
+        void end_write()
+        {
+            m_head += m_pending;
+            m_published.store(m_head, std::memory_order_release);
+            m_writing.store(false, std::memory_order_release);
+        }
+
+        /// Wait until a write that began before the consumer was told to stop is published or dropped.
+        void wait_for_writer() const
+        {
+            while (m_writing.load(std::memory_order_seq_cst))
+                std::this_thread::yield();
+        }
+
+        /// Pass every published record to sink(data, size), then free their space.
+        /// @return number of records
+        template <typename Sink>
+        size_t drain(Sink&& sink)
+        {
+            size_t count = 0;
+            auto tail = m_tail.load(std::memory_order_relaxed);
+            const auto head = m_published.load(std::memory_order_acquire);
+            while (tail != head)
+            {
+                const size_t offset = tail & (m_capacity - 1);
+                std::uint32_t size;
+                std::memcpy(&size, m_data.get() + offset, sizeof(size));
+                if (size == 0)
+                {
+                    tail += m_capacity - offset;
+                    continue;
+                }
+
+                sink(m_data.get() + offset + sizeof(size), size);
+                tail += align(size_t{size} + sizeof(size));
+                ++count;
+            }
+            m_tail.store(tail, std::memory_order_release);
+            return count;
+        }
+
+        /// Number of records dropped since the last call.
+        std::uint64_t take_dropped()
+        {
+            return m_dropped.exchange(0, std::memory_order_relaxed);
+        }
+
+        /// Mark the ring as abandoned by its thread; it is freed once drained.
+        void retire()
+        {
+            m_retired.store(true, std::memory_order_release);
+        }
+
+        bool is_retired() const
+        {
+            return m_retired.load(std::memory_order_acquire);
+        }
+
+        std::uint32_t thread() const
+        {
+            return m_thread;
+        }
+
+    private:
+        static size_t align(size_t size)
+        {
+            return (size + 3) & ~size_t{3};
+        }
+
+        std::uint8_t* abandon_write()
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            m_writing.store(false, std::memory_order_release);
+            return nullptr;
+        }
+
+        const size_t m_capacity;
+        const std::unique_ptr<std::uint8_t[]> m_data;
+        const std::uint32_t m_thread;
+
+        // Producer side
+        size_t m_head{0};
+        size_t m_pending{0};
+        alignas(64) std::atomic<size_t> m_published{0};
+        std::atomic<std::uint64_t> m_dropped{0};
+        std::atomic<bool> m_writing{false};
+
+        // Consumer side
+        alignas(64) std::atomic<size_t> m_tail{0};
+        std::atomic<bool> m_retired{false};
+    };
+
+    // =========================================================================
+    // Argument encoding
+    // =========================================================================
+
+    namespace detail
+    {
+        /// Reduce an argument to one of the types the file format stores.
+        /// Anything else is formatted here, on the calling thread.
+        template <typename T>
+        auto prepare(const T& arg)
+        {
+            using A = std::remove_cvref_t<T>;
+            if constexpr (std::is_same_v<A, bool> || std::is_same_v<A, char>)
+                return arg;
+            else if constexpr (std::is_integral_v<A> && std::is_signed_v<A>)
+                return static_cast<std::int64_t>(arg);
+            else if constexpr (std::is_integral_v<A>)
+                return static_cast<std::uint64_t>(arg);
+            else if constexpr (std::is_floating_point_v<A>)
+                return static_cast<double>(arg);
+            else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+                return std::string_view{arg};
+            else if constexpr (std::is_same_v<A, const void*> || std::is_same_v<A, void*> || std::is_null_pointer_v<A>)
+                return static_cast<const void*>(arg);
+            else
+                return std::format("{}", arg);
+        }
+
+        inline size_t encoded_size(bool) { return 2; }
+        inline size_t encoded_size(char) { return 2; }
+        inline size_t encoded_size(std::int64_t) { return 9; }
+        inline size_t encoded_size(std::uint64_t) { return 9; }
+        inline size_t encoded_size(double) { return 9; }
+        inline size_t encoded_size(const void*) { return 9; }
+        inline size_t encoded_size(std::string_view s) { return 5 + std::min(s.size(), max_string_size); }
+
+        template <typename T>
+        std::uint8_t* put(std::uint8_t* p, const T& value)
+        {
+            std::memcpy(p, &value, sizeof(value));
+            return p + sizeof(value);
+        }
+
+        template <typename T>
+        std::uint8_t* put_tagged(std::uint8_t* p, arg_tag tag, const T& value)
+        {
+            *p++ = static_cast<std::uint8_t>(tag);
+            return put(p, value);
+        }
+
+        inline std::uint8_t* encode(std::uint8_t* p, bool v) { return put_tagged(p, arg_tag::boolean, static_cast<std::uint8_t>(v)); }
+        inline std::uint8_t* encode(std::uint8_t* p, char v) { return put_tagged(p, arg_tag::character, v); }
+        inline std::uint8_t* encode(std::uint8_t* p, std::int64_t v) { return put_tagged(p, arg_tag::i64, v); }
+        inline std::uint8_t* encode(std::uint8_t* p, std::uint64_t v) { return put_tagged(p, arg_tag::u64, v); }
+        inline std::uint8_t* encode(std::uint8_t* p, double v) { return put_tagged(p, arg_tag::f64, v); }
+        inline std::uint8_t* encode(std::uint8_t* p, const void* v) { return put_tagged(p, arg_tag::pointer, reinterpret_cast<std::uint64_t>(v)); }
+
+        inline std::uint8_t* encode(std::uint8_t* p, std::string_view s)
+        {
+            const auto size = static_cast<std::uint32_t>(std::min(s.size(), max_string_size));
+            p = put_tagged(p, arg_tag::string, size);
+            std::memcpy(p, s.data(), size);
+            return p + size;
+        }
+
+        inline std::int64_t now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        /// Runtime level of the regular backend as a PNQ_LOG_LEVEL_* value.
+        inline int backend_level()
+        {
+#ifdef PNQ_USE_QUILL
+            switch (pnq::logging::default_logger()->get_log_level())
+            {
+            case quill::LogLevel::TraceL3:
+            case quill::LogLevel::TraceL2:
+            case quill::LogLevel::TraceL1:  return PNQ_LOG_LEVEL_TRACE;
+            case quill::LogLevel::Debug:    return PNQ_LOG_LEVEL_DEBUG;
+            case quill::LogLevel::Info:
+            case quill::LogLevel::Notice:   return PNQ_LOG_LEVEL_INFO;
+            case quill::LogLevel::Warning:  return PNQ_LOG_LEVEL_WARN;
+            case quill::LogLevel::Error:    return PNQ_LOG_LEVEL_ERROR;
+            case quill::LogLevel::Critical: return PNQ_LOG_LEVEL_CRITICAL;
+            default:                        return PNQ_LOG_LEVEL_OFF;
+            }
+#else
+            // spdlog's levels are numbered like PNQ_LOG_LEVEL_*
+            return static_cast<int>(spdlog::default_logger_raw()->level());
+#endif
+        }
+
+        /// Process-wide state of the binary logger.
+        class State final
+        {
+        public:
+            static State& instance()
+            {
+                static State state;
+                return state;
+            }
+
+            ~State()
+            {
+                stop();
+            }
+
+            bool start(std::string_view filename, size_t ring_capacity)
+            {
+                std::lock_guard control{m_control};
+                stop_locked();
+
+                const auto u8 = std::u8string_view{reinterpret_cast<const char8_t*>(filename.data()), filename.size()};
+                m_file.open(std::filesystem::path{u8}, std::ios::binary | std::ios::trunc);
+                if (!m_file)
+                    return false;
+                m_file.write(file_magic.data(), file_magic.size());
+
+                {
+                    std::lock_guard lock{m_mutex};
+                    m_ring_capacity = ring_capacity;
+                    m_formats_written = 0;  // a new file needs every format again
+                    m_stopping = false;
+                }
+                m_thread = std::thread{[this] { run(); }};
+                m_active.store(true, std::memory_order_release);
+                return true;
+            }
+
+            void stop()
+            {
+                std::lock_guard control{m_control};
+                stop_locked();
+            }
+
+            void flush()
+            {
+                if (!is_active())
+                    return;
+                std::unique_lock lock{m_mutex};
+                const auto target = ++m_flush_requested;
+                m_wake.notify_all();
+                m_flushed_cv.wait(lock, [&] { return m_flushed >= target || m_stopping; });
+            }
+
+            bool is_active() const
+            {
+                return m_active.load(std::memory_order_relaxed);
+            }
+
+            void note_dropped()
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            std::uint64_t dropped() const
+            {
+                return m_dropped.load(std::memory_order_relaxed);
+            }
+
+            const std::atomic<bool>& active_flag() const
+            {
+                return m_active;
+            }
+
+            std::uint32_t register_site(CallSite& site, int level, std::string_view format)
+            {
+                std::lock_guard lock{m_mutex};
+                if (const auto id = site.id.load(std::memory_order_acquire))
+                    return id;
+
+                const auto id = ++m_next_id;
+                const std::string_view file{site.file};
+                m_formats.push_back(static_cast<std::uint8_t>(record_kind::format));
+                append(m_formats, id);
+                append(m_formats, static_cast<std::uint8_t>(level));
+                append(m_formats, site.line);
+                append(m_formats, static_cast<std::uint32_t>(file.size()));
+                m_formats.insert(m_formats.end(), file.begin(), file.end());
+                append(m_formats, static_cast<std::uint32_t>(format.size()));
+                m_formats.insert(m_formats.end(), format.begin(), format.end());
+
+                site.id.store(id, std::memory_order_release);
+                return id;
+            }
+
+            /// Ring of the calling thread, created on first use.
+            Ring* thread_ring()
+            {
+                struct Owner
+                {
+                    std::shared_ptr<Ring> ring;
+
+                    ~Owner()
+                    {
+                        if (ring)
+                            ring->retire();
+                    }
+                };
+                thread_local Owner owner;
+
+                if (!owner.ring)
+                {
+                    std::lock_guard lock{m_mutex};
+                    owner.ring = std::make_shared<Ring>(m_ring_capacity, ++m_next_thread);
+                    m_rings.push_back(owner.ring);
+                }
+                return owner.ring.get();
+            }
+
+        private:
+            State() = default;
+
+            template <typename T>
+            static void append(std::vector<std::uint8_t>& buffer, const T& value)
+            {
+                const auto* bytes = reinterpret_cast<const std::uint8_t*>(&value);
+                buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+            }
+
+            void stop_locked()
+            {
+                if (!m_thread.joinable())
+                    return;
+
+                // Statements that already passed is_active() either finish their record before
+                // the last drain or, like those waiting for room, are counted as dropped
+                m_active.store(false, std::memory_order_seq_cst);
+                std::vector<std::shared_ptr<Ring>> rings;
+                {
+                    std::lock_guard lock{m_mutex};
+                    rings = m_rings;
+                }
+                for (const auto& ring : rings)
+                    ring->wait_for_writer();
+                {
+                    std::lock_guard lock{m_mutex};
+                    m_stopping = true;
+                }
+                m_wake.notify_all();
+                m_flushed_cv.notify_all();
+                m_thread.join();
+                m_file.close();
+            }
+
+            /// Background thread: write new formats and drain all rings until stopped.
+            void run()
+            {
+                std::vector<std::uint8_t> formats;
+                std::vector<std::shared_ptr<Ring>> rings;
+                std::vector<const Ring*> drained;
+                for (;;)
+                {
+                    std::uint64_t flush_target;
+                    bool stopping;
+                    {
+                        std::lock_guard lock{m_mutex};
+                        formats.assign(m_formats.begin() + m_formats_written, m_formats.end());
+                        m_formats_written = m_formats.size();
+                        rings = m_rings;
+                        flush_target = m_flush_requested;
+                        stopping = m_stopping;
+                    }
+                    m_file.write(reinterpret_cast<const char*>(formats.data()), formats.size());
+
+                    size_t records = 0;
+                    drained.clear();
+                    for (const auto& ring : rings)
+                    {
+                        // Check before draining: a retired ring gets no more records
+                        if (ring->is_retired())
+                            drained.push_back(ring.get());
+                        const auto thread = ring->thread();
+                        records += ring->drain([&](const std::uint8_t* data, std::uint32_t size) {
+                            const auto kind = static_cast<char>(record_kind::message);
+                            m_file.write(&kind, 1);
+                            m_file.write(reinterpret_cast<const char*>(&thread), sizeof(thread));
+                            m_file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+                            m_file.write(reinterpret_cast<const char*>(data), size);
+                        });
+
+                        if (const auto dropped = ring->take_dropped())
+                        {
+                            const auto kind = static_cast<char>(record_kind::dropped);
+                            const auto time = now();
+                            m_file.write(&kind, 1);
+                            m_file.write(reinterpret_cast<const char*>(&thread), sizeof(thread));
+                            m_file.write(reinterpret_cast<const char*>(&time), sizeof(time));
+                            m_file.write(reinterpret_cast<const char*>(&dropped), sizeof(dropped));
+                        }
+                    }
+
+                    std::unique_lock lock{m_mutex};
+                    if (!drained.empty())
+                    {
+                        std::erase_if(m_rings, [&](const auto& ring) {
+                            return std::find(drained.begin(), drained.end(), ring.get()) != drained.end();
+                        });
+                    }
+
+                    if (flush_target != m_flushed || stopping)
+                    {
+                        m_file.flush();
+                        m_flushed = flush_target;
+                        m_flushed_cv.notify_all();
+                    }
+                    if (stopping)
+                        return;
+
+                    if (!records)
+                        m_wake.wait_for(lock, std::chrono::milliseconds{1}, [&] { return m_stopping || m_flush_requested != m_flushed; });
+                }
+            }
+
+            std::atomic<bool> m_active{false};
+            std::atomic<std::uint64_t> m_dropped{0};
+
+            /// Serializes start() and stop()
+            std::mutex m_control;
+
+            /// Guards everything below
+            std::mutex m_mutex;
+            std::condition_variable m_wake;
+            std::condition_variable m_flushed_cv;
+            std::vector<std::uint8_t> m_formats;
+            size_t m_formats_written{0};
+            std::vector<std::shared_ptr<Ring>> m_rings;
+            size_t m_ring_capacity{1024 * 1024};
+            std::uint32_t m_next_id{0};
+            std::uint32_t m_next_thread{0};
+            std::uint64_t m_flush_requested{0};
+            std::uint64_t m_flushed{0};
+            bool m_stopping{false};
+
+            // Only used by the background thread while it runs
+            std::ofstream m_file;
+            std::thread m_thread;
+        };
+    }
+
+    // =========================================================================
+    // Public API
+    // =========================================================================
+
+    /// Start writing binary log records to filename (truncated).
+    /// Standard library streams are used instead of BinaryFile, which logs itself.
+    /// @param filename UTF-8 path of the log file
+    /// @param ring_capacity bytes per thread ring; a full ring makes its thread wait.
+    ///        Statements larger than half of it are dropped (see dropped()).
+    /// @return true if the file was created
+    inline bool start(std::string_view filename, size_t ring_capacity = 1024 * 1024)
+    {
+        return detail::State::instance().start(filename, ring_capacity);
+    }
+
+    /// Write everything logged so far and close the file.
+    inline void stop()
+    {
+        detail::State::instance().stop();
+    }
+
+    /// Wait until everything logged so far is in the file.
+    inline void flush()
+    {
+        detail::State::instance().flush();
+    }
+
+    /// Check if statements are currently recorded in binary form.
+    inline bool is_active()
+    {
+        return detail::State::instance().is_active();
+    }
+
+    /// Check if statements of a level (PNQ_LOG_LEVEL_*) are recorded: the same level as the
+    /// regular backend's, which logging::set_level() changes.
+    inline bool should_log(int level)
+    {
+        return level >= detail::backend_level();
+    }
+
+    /// Number of statements dropped since the program started, because they did not fit into
+    /// a ring or because stop() ran while they waited for room.
+    /// The file records how many of each thread were lost; the decoder reports them.
+    inline std::uint64_t dropped()
+    {
+        return detail::State::instance().dropped();
+    }
+
+    /// Record a statement: copies its format ID, a timestamp and the raw arguments.
+    /// Usually called through PNQ_LOG_BINARY.
+    template <typename... Args>
+    void log(CallSite& site, int level, std::format_string<Args...> format, Args&&... args)
+    {
+        auto& state = detail::State::instance();
+        auto id = site.id.load(std::memory_order_acquire);
+        if (!id)
+            id = state.register_site(site, level, format.get());
+
+        const auto timestamp = detail::now();
+        std::apply([&](const auto&... prepared) {
+            const size_t size = sizeof(id) + sizeof(timestamp) + (size_t{0} + ... + detail::encoded_size(prepared));
+            auto* ring = state.thread_ring();
+            auto* p = ring->begin_write(static_cast<std::uint32_t>(size), state.active_flag());
+            if (!p)
+            {
+                state.note_dropped();
+                return;
+            }
+
+            p = detail::put(p, id);
+            p = detail::put(p, timestamp);
+            ((p = detail::encode(p, prepared)), ...);
+            ring->end_write();
+        }, std::tuple{detail::prepare(args)...});
+    }
+}
@@ -0,0 +1,391 @@
+#pragma once
+
+/// @file pnq/binary_log_decoder.h
+/// @brief Render files written by pnq/binary_log.h as text.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include <pnq/binary_log.h>
+#include <pnq/logging.h>
+#include <pnq/mapped_file.h>
+
+namespace pnq::logging::binary
+{
+    /// One decoded log statement.
+    struct Message
+    {
+        /// Time of the statement (UTC)
+        std::chrono::sys_time<std::chrono::nanoseconds> time;
+
+        /// PNQ_LOG_LEVEL_* value
+        int level{PNQ_LOG_LEVEL_INFO};
+
+        /// Small number identifying the logging thread within the file
+        std::uint32_t thread{0};
+
+        /// Source location of the statement
+        std::string_view file;
+        std::uint32_t line{0};
+
+        /// Formatted message
+        std::string text;
+    };
+
+    namespace detail
+    {
+        using Argument = std::variant<std::int64_t, std::uint64_t, double, bool, char, std::string_view, const void*>;
+
+        struct Format
+        {
+            int level;
+            std::uint32_t line;
+            std::string_view file;
+            std::string_view text;
+        };
+
+        /// Bounds-checked reader over the mapped file.
+        class Reader final
+        {
+        public:
+            explicit Reader(std::string_view data)
+                : m_data{data}
+            {
+            }
+
+            bool at_end() const { return m_offset >= m_data.size(); }
+            size_t offset() const { return m_offset; }
+
+            template <typename T>
+            bool read(T& value)
+            {
+                if (m_data.size() - m_offset < sizeof(T))
+                    return false;
+                std::memcpy(&value, m_data.data() + m_offset, sizeof(T));
+                m_offset += sizeof(T);
+                return true;
+            }
+
+            bool read(std::string_view& bytes, size_t size)
+            {
+                if (m_data.size() - m_offset < size)
+                    return false;
+                bytes = m_data.substr(m_offset, size);
+                m_offset += size;
+                return true;
+            }
+
+            bool read_string(std::string_view& text)
+            {
+                std::uint32_t size;
+                return read(size) && read(text, size);
+            }
+
+        private:
+            std::string_view m_data;
+            size_t m_offset{0};
+        };
+
+        inline bool read_arguments(Reader& reader, std::vector<Argument>& arguments)
+        {
+            arguments.clear();
+            while (!reader.at_end())
+            {
+                std::uint8_t tag;
+                reader.read(tag);
+                switch (static_cast<arg_tag>(tag))
+                {
+                case arg_tag::i64:
+                {
+                    std::int64_t v;
+                    if (!reader.read(v))
+                        return false;
+                    arguments.emplace_back(v);
+                    break;
+                }
+                case arg_tag::u64:
+                {
+                    std::uint64_t v;
+                    if (!reader.read(v))
+                        return false;
+                    arguments.emplace_back(v);
+                    break;
+                }
+                case arg_tag::f64:
+                {
+                    double v;
+                    if (!reader.read(v))
+                        return false;
+                    arguments.emplace_back(v);
+                    break;
+                }
+                case arg_tag::boolean:
+                {
+                    std::uint8_t v;
+                    if (!reader.read(v))
+                        return false;
+                    arguments.emplace_back(v != 0);
+                    break;
+                }
+                case arg_tag::character:
+                {
+                    char v;
+                    if (!reader.read(v))
+                        return false;
+                    arguments.emplace_back(v);
+                    break;
+                }
+                case arg_tag::string:
+                {
+                    std::string_view v;
+                    if (!reader.read_string(v))
+                        return false;
+                    arguments.emplace_back(v);
+                    break;
+                }
+                case arg_tag::pointer:
+                {
+                    std::uint64_t v;
+                    if (!reader.read(v))
+                        return false;
+                    arguments.emplace_back(reinterpret_cast<const void*>(static_cast<std::uintptr_t>(v)));
+                    break;
+                }
+                default:
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// Format one argument with the spec of its replacement field (the part after ':').
+        /// A spec that does not fit the recorded type is rendered as "{!field: error: value}".
+        inline void format_argument(std::string& output, const Argument& argument, std::string_view spec)
+        {
+            std::visit([&](const auto& value) {
+                const std::string field = std::format("{{:{}}}", spec);
+                try
+                {
+                    output += std::vformat(field, std::make_format_args(value));
+                }
+                catch (const std::format_error& e)
+                {
+                    output += std::format("{{!{}: {}: {}}}", field, e.what(), value);
+                }
+            }, argument);
+        }
+
+        /// Render a std::format string with runtime arguments.
+        /// Replacement fields with nested (dynamic) width or precision are copied as-is.
+        inline std::string render(std::string_view format, const std::vector<Argument>& arguments)
+        {
+            std::string output;
+            output.reserve(format.size() + 16 * arguments.size());
+            size_t next_argument = 0;
+
+            for (size_t i = 0; i < format.size(); ++i)
+            {
+                const char c = format[i];
+                if (c == '}')
+                {
+                    output += c;
+                    if (i + 1 < format.size() && format[i + 1] == '}')
+                        ++i;
+                    continue;
+                }
+                if (c != '{')
+                {
+                    output += c;
+                    continue;
+                }
+                if (i + 1 < format.size() && format[i + 1] == '{')
+                {
+                    output += '{';
+                    ++i;
+                    continue;
+                }
+
+                const auto close = format.find('}', i + 1);
+                const auto nested = format.find('{', i + 1);
+                if (close == std::string_view::npos || nested < close)
+                {
+                    output += format.substr(i);
+                    break;
+                }
+
+                const auto field = format.substr(i + 1, close - i - 1);
+                const auto colon = field.find(':');
+                const auto index_part = field.substr(0, colon);
+                const auto spec = colon == std::string_view::npos ? std::string_view{} : field.substr(colon + 1);
+
+                size_t index = next_argument++;
+                if (!index_part.empty())
+                {
+                    index = 0;
+                    for (const char digit : index_part)
+                        index = index * 10 + static_cast<size_t>(digit - '0');
+                }
+
+                if (index < arguments.size())
+                    format_argument(output, arguments[index], spec);
+                else
+                    output += format.substr(i, close - i + 1);
+                i = close;
+            }
+            return output;
+        }
+
+        inline std::string_view level_name(int level)
+        {
+            switch (level)
+            {
+            case PNQ_LOG_LEVEL_TRACE:    return "trace";
+            case PNQ_LOG_LEVEL_DEBUG:    return "debug";
+            case PNQ_LOG_LEVEL_INFO:     return "info";
+            case PNQ_LOG_LEVEL_WARN:     return "warning";
+            case PNQ_LOG_LEVEL_ERROR:    return "error";
+            case PNQ_LOG_LEVEL_CRITICAL: return "critical";
+            default:                     return "?";
+            }
+        }
+    }
+
+    /// Decode a binary log file.
+    /// Messages are passed to callback in time order. A record cut short at the end of the
+    /// file (e.g. after a crash) ends decoding without error. Statements the logger dropped
+    /// show up as warnings "N statements dropped" without a source location.
+    /// @param filename binary log written by binary::start()
+    /// @param callback receives every message; file names are only valid during the call
+    /// @return true if the file is a binary log and could be decoded
+    inline bool decode(std::string_view filename, const std::function<void(const Message&)>& callback)
+    {
+        MappedFile mapped;
+        if (!mapped.open(filename))
+            return false;
+
+        const auto data = mapped.text();
+        if (!data.starts_with(file_magic))
+        {
+            PNQ_LOG_ERROR("'{}' is not a binary log file", filename);
+            return false;
+        }
+
+        struct Record
+        {
+            std::int64_t time;
+            std::uint32_t thread;
+            std::string_view payload;
+            std::uint64_t dropped;
+        };
+
+        // Formats can follow the first message that uses them, so collect everything first
+        std::unordered_map<std::uint32_t, detail::Format> formats;
+        std::vector<Record> records;
+        detail::Reader reader{data.substr(file_magic.size())};
+        while (!reader.at_end())
+        {
+            std::uint8_t kind;
+            reader.read(kind);
+            if (kind == static_cast<std::uint8_t>(record_kind::format))
+            {
+                std::uint32_t id;
+                std::uint8_t level;
+                detail::Format format{};
+                if (!reader.read(id) || !reader.read(level) || !reader.read(format.line) ||
+                    !reader.read_string(format.file) || !reader.read_string(format.text))
+                    break;
+                format.level = level;
+                formats[id] = format;
+            }
+            else if (kind == static_cast<std::uint8_t>(record_kind::message))
+            {
+                Record record{};
+                std::uint32_t size;
+                if (!reader.read(record.thread) || !reader.read(size) || !reader.read(record.payload, size))
+                    break;
+                if (size < sizeof(std::uint32_t) + sizeof(std::int64_t))
+                {
+                    PNQ_LOG_ERROR("'{}': message record at offset {} is too short", filename, reader.offset());
+                    return false;
+                }
+                std::memcpy(&record.time, record.payload.data() + sizeof(std::uint32_t), sizeof(record.time));
+                records.push_back(record);
+            }
+            else if (kind == static_cast<std::uint8_t>(record_kind::dropped))
+            {
+                Record record{};
+                if (!reader.read(record.thread) || !reader.read(record.time) || !reader.read(record.dropped))
+                    break;
+                records.push_back(record);
+            }
+            else
+            {
+                PNQ_LOG_ERROR("'{}': unknown record kind {} at offset {}", filename, kind, reader.offset());
+                return false;
+            }
+        }
+
+        // Each thread's records are in order already; merge them by time
+        std::stable_sort(records.begin(), records.end(), [](const Record& a, const Record& b) { return a.time < b.time; });
+
+        Message message;
+        std::vector<detail::Argument> arguments;
+        for (const auto& record : records)
+        {
+            message.time = std::chrono::sys_time<std::chrono::nanoseconds>{std::chrono::nanoseconds{record.time}};
+            message.thread = record.thread;
+            if (record.dropped)
+            {
+                message.level = PNQ_LOG_LEVEL_WARN;
+                message.file = {};
+                message.line = 0;
+                message.text = std::format("{} statements dropped", record.dropped);
+                callback(message);
+                continue;
+            }
+
+            detail::Reader payload{record.payload};
+            // The timestamp was read into record.time already
+            std::uint32_t id;
+            std::int64_t time;
+            payload.read(id);
+            payload.read(time);
+
+            const auto format = formats.find(id);
+            if (format == formats.end())
+            {
+                PNQ_LOG_ERROR("'{}': message uses unknown format {}", filename, id);
+                return false;
+            }
+            if (!detail::read_arguments(payload, arguments))
+            {
+                PNQ_LOG_ERROR("'{}': malformed arguments for '{}'", filename, format->second.text);
+                return false;
+            }
+
+            message.level = format->second.level;
+            message.file = format->second.file;
+            message.line = format->second.line;
+            message.text = detail::render(format->second.text, arguments);
+            callback(message);
+        }
+        return true;
+    }
+
+    /// Render a message as a text log line, e.g. "[2025-01-31 12:00:00.123] [info] [3] text".
+    inline std::string to_string(const Message& message)
+    {
+        return std::format("[{:%Y-%m-%d %H:%M:%S}] [{}] [{}] {}",
+            std::chrono::floor<std::chrono::milliseconds>(message.time),
+            detail::level_name(message.level), message.thread, message.text);
+    }
+}
@@ -0,0 +1,543 @@
+#pragma once
+
+/// @file pnq/bounded_queue.h
+/// @brief Bounded lock-free queues: single-producer/single-consumer and multi-producer/multi-consumer.
+///
+/// @code
+/// pnq::MpmcQueue<std::string> lines{1024};
+///
+/// // producers
+/// lines.push(std::move(line));
+///
+/// // consumer
+/// std::string line;
+/// while (lines.pop(line))     // false once the queue is closed and drained
+///     write(line);
+///
+/// // shutdown
+/// lines.close();
+/// @endcode
+///
+/// try_push()/try_pop() never block. push()/pop() wait according to the queue's
+/// wait_strategy when it is full or empty.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <pnq/sync.h>
+
+// ThreadSanitizer does not model atomic_thread_fence (and GCC warns about it)
+#if defined(__SANITIZE_THREAD__)
+#define PNQ_QUEUE_NO_FENCES 1
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define PNQ_QUEUE_NO_FENCES 1
+#endif
+#endif
+
+namespace pnq
+{
+    /// How push() and pop() wait for room or for items.
+    enum class wait_strategy
+    {
+        /// Busy-wait; lowest latency, burns a core per waiting thread
+        spin,
+
+        /// Busy-wait, giving up the time slice on every retry
+        yield,
+
+        /// Spin briefly, then sleep until the other side makes progress
+        park,
+    };
+
+    namespace detail
+    {
+        /// Keeps producer and consumer indices on separate cache lines.
+        inline constexpr size_t queue_cache_line = 64;
+
+        inline size_t queue_capacity(size_t requested)
+        {
+            size_t capacity = 2;
+            while (capacity < requested)
+                capacity *= 2;
+            return capacity;
+        }
+
+        /// Where threads blocked in push() or pop() wait for the other side.
+        class QueueWaitPoint final
+        {
+        public:
+            /// Wait until attempt() returns true.
+            template <typename Attempt>
+            void wait_until(wait_strategy strategy, Attempt&& attempt)
+            {
+                for (int i = 0; !attempt(); ++i)
+                {
+                    if (strategy == wait_strategy::spin || (strategy == wait_strategy::park && i < sync::detail::spin_count))
+                    {
+                        sync::detail::cpu_relax();
+                    }
+                    else if (strategy == wait_strategy::yield)
+                    {
+                        std::this_thread::yield();
+                    }
+                    else
+                    {
+                        // Pairs with the fence in notify(): either we see the change or it sees us
+                        m_waiters.fetch_add(1, std::memory_order_seq_cst);
+#ifndef PNQ_QUEUE_NO_FENCES
+                        std::atomic_thread_fence(std::memory_order_seq_cst);
+#endif
+                        const auto epoch = m_epoch.load(std::memory_order_acquire);
+                        const bool done = attempt();
+                        if (!done)
+                            sync::detail::wait(m_epoch, epoch);
+                        m_waiters.fetch_sub(1, std::memory_order_relaxed);
+                        if (done)
+                            return;
+                    }
+                }
+            }
+
+            /// Wake waiters after the queue changed (only needed for wait_strategy::park).
+            void notify()
+            {
+#ifdef PNQ_QUEUE_NO_FENCES
+                // Same ordering through the modification order of m_waiters, at the price of a write
+                const auto waiters = m_waiters.fetch_add(0, std::memory_order_seq_cst);
+#else
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                const auto waiters = m_waiters.load(std::memory_order_relaxed);
+#endif
+                if (waiters)
+                    wake();
+            }
+
+            void wake()
+            {
+                m_epoch.fetch_add(1, std::memory_order_release);
+                sync::detail::wake_all(m_epoch);
+            }
+
+        private:
+            std::atomic<std::uint32_t> m_epoch{0};
+            std::atomic<std::uint32_t> m_waiters{0};
+        };
+
+        /// Uninitialized storage for one T.
+        template <typename T>
+        struct QueueSlot
+        {
+            alignas(T) unsigned char bytes[sizeof(T)];
+
+            void* storage() { return bytes; }
+            T* get() { return std::launder(reinterpret_cast<T*>(bytes)); }
+        };
+    }
+
+    /// Bounded ring buffer for exactly one producer thread and one consumer thread.
+    ///
+    /// Each side caches the other side's index and only re-reads it when the cached value says
+    /// the queue is full (or empty), so the two threads rarely touch the same cache line.
+    template <typename T>
+    class SpscQueue final
+    {
+        static_assert(std::is_nothrow_move_constructible_v<T>, "queue items must be nothrow move constructible");
+
+    public:
+        /// @param capacity minimum number of items; rounded up to a power of two
+        explicit SpscQueue(size_t capacity, wait_strategy wait = wait_strategy::park)
+            : m_capacity{detail::queue_capacity(capacity)},
+              m_mask{m_capacity - 1},
+              m_wait{wait},
+              m_slots{std::make_unique_for_overwrite<detail::QueueSlot<T>[]>(m_capacity)}
+        {
+        }
+
+        ~SpscQueue()
+        {
+            const auto tail = m_tail.load(std::memory_order_relaxed);
+            for (auto head = m_head.load(std::memory_order_relaxed); head != tail; ++head)
+                m_slots[head & m_mask].get()->~T();
+        }
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+        SpscQueue(SpscQueue&&) = delete;
+        SpscQueue& operator=(SpscQueue&&) = delete;
+
+        size_t capacity() const { return m_capacity; }
+
+        /// Number of queued items; only a snapshot while the other thread is active.
+        size_t size() const
+        {
+            // A third thread may see the head move past the tail it loaded
+            const auto tail = m_tail.load(std::memory_order_acquire);
+            const auto head = m_head.load(std::memory_order_acquire);
+            return tail > head ? tail - head : 0;
+        }
+
+        /// Producer: add an item if there is room.
+        /// @return false if the queue is full (item is left untouched)
+        template <typename U>
+        bool try_push(U&& item)
+        {
+            const auto tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_cached_head == m_capacity)
+            {
+                m_cached_head = m_head.load(std::memory_order_acquire);
+                if (tail - m_cached_head == m_capacity)
+                    return false;
+            }
+            ::new (m_slots[tail & m_mask].storage()) T(std::forward<U>(item));
+            m_tail.store(tail + 1, std::memory_order_release);
+            if (m_wait == wait_strategy::park)
+                m_not_empty.notify();
+            return true;
+        }
+
+        /// Producer: move items from [first, first + count) as long as there is room.
+        /// @return number of items moved
+        template <typename Iterator>
+        size_t try_push_bulk(Iterator first, size_t count)
+        {
+            const auto tail = m_tail.load(std::memory_order_relaxed);
+            if (m_capacity - (tail - m_cached_head) < count)
+                m_cached_head = m_head.load(std::memory_order_acquire);
+
+            const auto room = m_capacity - (tail - m_cached_head);
+            if (count > room)
+                count = room;
+            if (!count)
+                return 0;
+
+            for (size_t i = 0; i < count; ++i, ++first)
+                ::new (m_slots[(tail + i) & m_mask].storage()) T(std::move(*first));
+            m_tail.store(tail + count, std::memory_order_release);
+            if (m_wait == wait_strategy::park)
+                m_not_empty.notify();
+            return count;
+        }
+
+        /// Producer: add an item, waiting for room.
+        /// @return false if the queue was closed
+        template <typename U>
+        bool push(U&& item)
+        {
+            bool pushed = false;
+            m_not_full.wait_until(m_wait, [&] {
+                if (is_closed())
+                    return true;
+                pushed = try_push(std::forward<U>(item));
+                return pushed;
+            });
+            return pushed;
+        }
+
+        /// Consumer: take the oldest item if there is one.
+        bool try_pop(T& item)
+        {
+            const auto head = m_head.load(std::memory_order_relaxed);
+            if (head == m_cached_tail)
+            {
+                m_cached_tail = m_tail.load(std::memory_order_acquire);
+                if (head == m_cached_tail)
+                    return false;
+            }
+            auto* slot = m_slots[head & m_mask].get();
+            item = std::move(*slot);
+            slot->~T();
+            m_head.store(head + 1, std::memory_order_release);
+            if (m_wait == wait_strategy::park)
+                m_not_full.notify();
+            return true;
+        }
+
+        /// Consumer: move up to max_count items to out.
+        /// @return number of items moved
+        template <typename OutputIterator>
+        size_t try_pop_bulk(OutputIterator out, size_t max_count)
+        {
+            const auto head = m_head.load(std::memory_order_relaxed);
+            if (m_cached_tail - head < max_count)
+                m_cached_tail = m_tail.load(std::memory_order_acquire);
+
+            auto count = m_cached_tail - head;
+            if (count > max_count)
+                count = max_count;
+            if (!count)
+                return 0;
+
+            for (size_t i = 0; i < count; ++i, ++out)
+            {
+                auto* slot = m_slots[(head + i) & m_mask].get();
+                *out = std::move(*slot);
+                slot->~T();
+            }
+            m_head.store(head + count, std::memory_order_release);
+            if (m_wait == wait_strategy::park)
+                m_not_full.notify();
+            return count;
+        }
+
+        /// Consumer: take the oldest item, waiting for one.
+        /// @return false once the queue is closed and empty
+        bool pop(T& item)
+        {
+            bool popped = false;
+            m_not_empty.wait_until(m_wait, [&] {
+                popped = try_pop(item);
+                if (popped || !is_closed())
+                    return popped;
+
+                // Items pushed before close() are still delivered
+                popped = try_pop(item);
+                return true;
+            });
+            return popped;
+        }
+
+        /// Make push() fail and let pop() return false once the queue is drained.
+        void close()
+        {
+            m_closed.store(true, std::memory_order_seq_cst);
+            m_not_empty.wake();
+            m_not_full.wake();
+        }
+
+        bool is_closed() const
+        {
+            return m_closed.load(std::memory_order_acquire);
+        }
+
+    private:
+        // Consumer side
+        alignas(detail::queue_cache_line) std::atomic<size_t> m_head{0};
+        size_t m_cached_tail{0};
+
+        // Producer side
+        alignas(detail::queue_cache_line) std::atomic<size_t> m_tail{0};
+        size_t m_cached_head{0};
+
+        alignas(detail::queue_cache_line) const size_t m_capacity;
+        const size_t m_mask;
+        const wait_strategy m_wait;
+        std::atomic<bool> m_closed{false};
+        std::unique_ptr<detail::QueueSlot<T>[]> m_slots;
+        detail::QueueWaitPoint m_not_empty;
+        detail::QueueWaitPoint m_not_full;
+    };
+
+    /// Bounded queue for any number of producers and consumers (Dmitry Vyukov's design).
+    ///
+    /// Every cell carries a sequence number that says whose turn it is, so producers and
+    /// consumers only contend on one CAS each and never wait for a thread that was preempted
+    /// in the middle of an operation on a different cell.
+    template <typename T>
+    class MpmcQueue final
+    {
+        static_assert(std::is_nothrow_move_constructible_v<T>, "queue items must be nothrow move constructible");
+
+    public:
+        /// @param capacity minimum number of items; rounded up to a power of two
+        explicit MpmcQueue(size_t capacity, wait_strategy wait = wait_strategy::park)
+            : m_capacity{detail::queue_capacity(capacity)},
+              m_mask{m_capacity - 1},
+              m_wait{wait},
+              m_cells{std::make_unique<Cell[]>(m_capacity)}
+        {
+            for (size_t i = 0; i < m_capacity; ++i)
+                m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        ~MpmcQueue()
+        {
+            const auto tail = m_enqueue_position.load(std::memory_order_relaxed);
+            for (auto head = m_dequeue_position.load(std::memory_order_relaxed); head != tail; ++head)
+                m_cells[head & m_mask].slot.get()->~T();
+        }
+
+        MpmcQueue(const MpmcQueue&) = delete;
+        MpmcQueue& operator=(const MpmcQueue&) = delete;
+        MpmcQueue(MpmcQueue&&) = delete;
+        MpmcQueue& operator=(MpmcQueue&&) = delete;
+
+        size_t capacity() const { return m_capacity; }
+
+        /// Number of queued items; only a snapshot while other threads are active.
+        size_t size() const
+        {
+            const auto tail = m_enqueue_position.load(std::memory_order_acquire);
+            const auto head = m_dequeue_position.load(std::memory_order_acquire);
+            return tail > head ? tail - head : 0;
+        }
+
+        /// Add an item if there is room.
+        /// @return false if the queue is full (item is left untouched)
+        template <typename U>
+        bool try_push(U&& item)
+        {
+            auto position = m_enqueue_position.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                auto& cell = m_cells[position & m_mask];
+                const auto sequence = cell.sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+                if (difference == 0)
+                {
+                    if (m_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        ::new (cell.slot.storage()) T(std::forward<U>(item));
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        if (m_wait == wait_strategy::park)
+                            m_not_empty.notify();
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = m_enqueue_position.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /// Move items from [first, first + count) as long as there is room.
+        /// Items are pushed one by one, so other producers' items may interleave.
+        /// @return number of items moved
+        template <typename Iterator>
+        size_t try_push_bulk(Iterator first, size_t count)
+        {
+            size_t pushed = 0;
+            for (; pushed < count; ++pushed, ++first)
+            {
+                if (!try_push(std::move(*first)))
+                    break;
+            }
+            return pushed;
+        }
+
+        /// Add an item, waiting for room.
+        /// @return false if the queue was closed
+        template <typename U>
+        bool push(U&& item)
+        {
+            bool pushed = false;
+            m_not_full.wait_until(m_wait, [&] {
+                if (is_closed())
+                    return true;
+                pushed = try_push(std::forward<U>(item));
+                return pushed;
+            });
+            return pushed;
+        }
+
+        /// Take the oldest item if there is one.
+        bool try_pop(T& item)
+        {
+            return try_take([&](T& slot) { item = std::move(slot); });
+        }
+
+        /// Move up to max_count items to out.
+        /// @return number of items moved
+        template <typename OutputIterator>
+        size_t try_pop_bulk(OutputIterator out, size_t max_count)
+        {
+            size_t popped = 0;
+            for (; popped < max_count && try_take([&](T& slot) { *out = std::move(slot); }); ++popped)
+                ++out;
+            return popped;
+        }
+
+        /// Take the oldest item, waiting for one.
+        /// @return false once the queue is closed and empty
+        bool pop(T& item)
+        {
+            bool popped = false;
+            m_not_empty.wait_until(m_wait, [&] {
+                popped = try_pop(item);
+                if (popped || !is_closed())
+                    return popped;
+
+                // Items pushed before close() are still delivered
+                popped = try_pop(item);
+                return true;
+            });
+            return popped;
+        }
+
+        /// Make push() fail and let pop() return false once the queue is drained.
+        void close()
+        {
+            m_closed.store(true, std::memory_order_seq_cst);
+            m_not_empty.wake();
+            m_not_full.wake();
+        }
+
+        bool is_closed() const
+        {
+            return m_closed.load(std::memory_order_acquire);
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            detail::QueueSlot<T> slot;
+        };
+
+        /// Claim the oldest cell, hand its item to take and destroy it there.
+        /// Lets try_pop_bulk move straight out of the cell, so T needs no default constructor.
+        template <typename Take>
+        bool try_take(Take&& take)
+        {
+            auto position = m_dequeue_position.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                auto& cell = m_cells[position & m_mask];
+                const auto sequence = cell.sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+                if (difference == 0)
+                {
+                    if (m_dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        auto* slot = cell.slot.get();
+                        take(*slot);
+                        slot->~T();
+                        cell.sequence.store(position + m_capacity, std::memory_order_release);
+                        if (m_wait == wait_strategy::park)
+                            m_not_full.notify();
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = m_dequeue_position.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        alignas(detail::queue_cache_line) std::atomic<size_t> m_enqueue_position{0};
+        alignas(detail::queue_cache_line) std::atomic<size_t> m_dequeue_position{0};
+        alignas(detail::queue_cache_line) const size_t m_capacity;
+        const size_t m_mask;
+        const wait_strategy m_wait;
+        std::atomic<bool> m_closed{false};
+        std::unique_ptr<Cell[]> m_cells;
+        detail::QueueWaitPoint m_not_empty;
+        detail::QueueWaitPoint m_not_full;
+    };
+}
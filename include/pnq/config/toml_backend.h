@@ -8,6 +8,7 @@
 
 #include <toml++/toml.hpp>
 #include <pnq/config/config_backend.h>
+#include <pnq/profile.h>
 
 namespace pnq
 {
@@ -194,6 +195,7 @@ namespace pnq
 
             void loadFromFile()
             {
+                PNQ_PROFILE_ZONE("config::TomlBackend::load");
                 try
                 {
                     if (std::filesystem::exists(m_filename))
@@ -210,6 +212,7 @@ namespace pnq
 
             void saveToFile()
             {
+                PNQ_PROFILE_ZONE("config::TomlBackend::save");
                 std::ofstream file(m_filename);
                 if (file.is_open())
                 {
@@ -1,18 +1,34 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdlib>
 #include <format>
+#include <iterator>
 #include <locale>
 #include <string>
 
+#include <pnq/environment_variables.h>
+#include <pnq/platform.h>
 #include <pnq/string.h>
 #include <pnq/string_writer.h>
 
+#ifndef PNQ_PLATFORM_WINDOWS
+#include <cerrno>
+#include <unistd.h>
+#endif
+
 namespace pnq
 {
     /// Console output with UTF-8 support and color codes.
     namespace console
     {
+        /// Line ending for console output; terminals outside Windows expect a bare "\n".
+#ifdef PNQ_PLATFORM_WINDOWS
+        constexpr std::string_view newline = string::newline;
+#else
+        constexpr std::string_view newline = "\n";
+#endif
+
         // Color escape codes - use ESC + attribute byte
         #define CONSOLE_FOREGROUND_BRIGHT_BLACK "\x1b\x00"
         #define CONSOLE_FOREGROUND_BRIGHT_BLUE "\x1b\x09"
@@ -33,6 +49,62 @@ namespace pnq
         #define CONSOLE_FOREGROUND_BRIGHT_YELLOW "\x1b\x0e"
         #define CONSOLE_STANDARD "\x1b\xFF"
 
+        /// How color escape codes are rendered.
+        enum class color_mode
+        {
+            /// Not yet determined; detected on first output
+            detect,
+
+            /// Colors are dropped (output is redirected, or NO_COLOR is set)
+            plain,
+
+            /// Colors become ANSI SGR sequences, so text and colors go out in one write
+            ansi,
+
+            /// Colors become SetConsoleTextAttribute calls (Windows consoles without VT support)
+            attributes,
+        };
+
+        namespace detail
+        {
+            /// Append the ANSI SGR sequence for a console attribute byte (0xFF resets).
+            inline void append_sgr(std::string &output, unsigned char attribute)
+            {
+                if (attribute == 0xFF)
+                {
+                    output.append("\x1b[0m");
+                    return;
+                }
+
+                // Console attributes are IRGB, ANSI color indices are BGR
+                const int index = ((attribute & 0x04) ? 1 : 0) | ((attribute & 0x02) ? 2 : 0) | ((attribute & 0x01) ? 4 : 0);
+                std::format_to(std::back_inserter(output), "\x1b[{}m", ((attribute & 0x08) ? 90 : 30) + index);
+            }
+
+            /// Render color escape codes for ansi or plain mode.
+            inline std::string translate(std::string_view text, color_mode mode)
+            {
+                std::string output;
+                output.reserve(text.size() + text.size() / 8);
+
+                const char *p = text.data();
+                const char *end = p + text.size();
+                while (p < end)
+                {
+                    const char *q = std::find(p, end, '\x1b');
+                    output.append(p, q);
+                    if (q + 1 >= end)
+                        break;
+
+                    if (mode == color_mode::ansi)
+                        append_sgr(output, static_cast<unsigned char>(q[1]));
+                    p = q + 2;
+                }
+                return output;
+            }
+        }
+
+#ifdef PNQ_PLATFORM_WINDOWS
         /// Internal console state.
         struct console_context
         {
@@ -43,6 +115,9 @@ namespace pnq
             WORD wOldColorAttrs;
             bool has_retrieved_old_color_attrs;
             bool write_output_has_failed_once;
+            color_mode mode;
+            DWORD dwOldConsoleMode;
+            bool has_changed_console_mode;
         };
 
         /// Get the global console context singleton.
@@ -51,11 +126,26 @@ namespace pnq
             static console_context the_console_context{
                 INVALID_HANDLE_VALUE,
                 INVALID_HANDLE_VALUE,
-                false, false, 0, false, false
+                false, false, 0, false, false,
+                color_mode::detect,
+                0, false
             };
             return the_console_context;
         }
 
+        /// Restore the console mode that was in effect before VT processing was enabled.
+        /// Registered with atexit: statics constructed after the registration are destroyed before it
+        /// runs, which is why LineQueue::console() sets up the output before building its queue.
+        inline void restore_console_mode()
+        {
+            auto &cc = get_context();
+            if (cc.has_changed_console_mode)
+            {
+                ::SetConsoleMode(cc.hConsoleOutput, cc.dwOldConsoleMode);
+                cc.has_changed_console_mode = false;
+            }
+        }
+
         /// Encode wide string to console output codepage.
         inline std::string encode_as_output_bytes(std::wstring_view text)
         {
@@ -133,11 +223,111 @@ namespace pnq
             {
                 return false;
             }
+
+            if (cc.mode == color_mode::detect)
+            {
+                DWORD console_mode = 0;
+                std::string no_color;
+                if (!::GetConsoleMode(cc.hConsoleOutput, &console_mode) || environment_variables::get("NO_COLOR", no_color))
+                {
+                    cc.mode = color_mode::plain;
+                }
+                else if (console_mode & ENABLE_VIRTUAL_TERMINAL_PROCESSING)
+                {
+                    cc.mode = color_mode::ansi;
+                }
+                else if (::SetConsoleMode(cc.hConsoleOutput, console_mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING))
+                {
+                    // Leave the console as we found it for whatever runs after us
+                    cc.dwOldConsoleMode = console_mode;
+                    cc.has_changed_console_mode = true;
+                    std::atexit(restore_console_mode);
+                    cc.mode = color_mode::ansi;
+                }
+                else
+                {
+                    cc.mode = color_mode::attributes;
+                }
+            }
+
             // Set locale so std::format understands {:L} properly
             std::locale::global(std::locale(""));
             return true;
         }
 
+        namespace detail
+        {
+            /// Write UTF-8 text without color processing; transcodes only if the console code page isn't UTF-8.
+            inline bool write_bytes(std::string_view utf8_encoded_string)
+            {
+                auto &cc = get_context();
+                if (utf8_encoded_string.empty())
+                    return true;
+
+                std::string transcoded;
+                if (::GetConsoleOutputCP() != CP_UTF8)
+                {
+                    transcoded = encode_as_output_bytes(string::encode_as_utf16(utf8_encoded_string));
+                    utf8_encoded_string = transcoded;
+                }
+
+                DWORD chars_written = 0;
+                if (!::WriteFile(cc.hConsoleOutput, utf8_encoded_string.data(), static_cast<DWORD>(utf8_encoded_string.size()), &chars_written, nullptr))
+                {
+                    cc.write_output_has_failed_once = true;
+                    return false;
+                }
+                return true;
+            }
+
+            /// Write text with color codes through SetConsoleTextAttribute.
+            inline bool write_with_attributes(std::string_view utf8_encoded_string)
+            {
+                auto &cc = get_context();
+
+                const char *p = utf8_encoded_string.data();
+                const char *end = p + utf8_encoded_string.size();
+
+                while (p < end)
+                {
+                    const char *q = std::find(p, end, '\x1b');
+                    if (q == end)
+                    {
+                        return write_bytes(std::string_view(p, end - p));
+                    }
+
+                    if (!cc.has_retrieved_old_color_attrs)
+                    {
+                        CONSOLE_SCREEN_BUFFER_INFO csbiInfo{};
+                        GetConsoleScreenBufferInfo(cc.hConsoleOutput, &csbiInfo);
+                        cc.wOldColorAttrs = csbiInfo.wAttributes;
+                        cc.has_retrieved_old_color_attrs = true;
+                    }
+
+                    if (q > p)
+                    {
+                        write_bytes(std::string_view(p, q - p));
+                    }
+
+                    // Need at least 2 bytes for escape sequence
+                    if (q + 1 >= end)
+                        break;
+
+                    if (q[1] == '\xFF')
+                    {
+                        SetConsoleTextAttribute(cc.hConsoleOutput, cc.wOldColorAttrs);
+                    }
+                    else
+                    {
+                        SetConsoleTextAttribute(cc.hConsoleOutput, static_cast<WORD>(static_cast<unsigned char>(q[1])));
+                    }
+
+                    p = q + 2;
+                }
+                return true;
+            }
+        }
+
         /// Write UTF-16 string to console.
         inline bool write(std::wstring_view utf16_encoded_string)
         {
@@ -159,75 +349,103 @@ namespace pnq
             }
             return true;
         }
+#else
+        /// Internal console state.
+        struct console_context
+        {
+            bool write_output_has_failed_once;
+            color_mode mode;
+        };
+
+        /// Get the global console context singleton.
+        inline console_context &get_context()
+        {
+            static console_context the_console_context{false, color_mode::detect};
+            return the_console_context;
+        }
 
-        /// Internal: write UTF-8 string without color processing.
-        inline bool do_write_output_as_unicode(std::string_view utf8_encoded_string)
+        /// Decide how colors are rendered; stdout itself needs no setup.
+        inline bool ensure_output_handle()
         {
             auto &cc = get_context();
-            const auto utf16_encoded_string = string::encode_as_utf16(utf8_encoded_string);
-            const auto output_bytes = encode_as_output_bytes(utf16_encoded_string);
-
-            DWORD chars_written = 0;
-            if (!::WriteFile(cc.hConsoleOutput, output_bytes.data(), static_cast<DWORD>(output_bytes.size()), &chars_written, nullptr))
+            if (cc.mode == color_mode::detect)
             {
-                cc.write_output_has_failed_once = true;
-                return false;
+                std::string term, no_color;
+                const bool dumb = environment_variables::get("TERM", term) && term == "dumb";
+                cc.mode = (::isatty(STDOUT_FILENO) && !dumb && !environment_variables::get("NO_COLOR", no_color)) ? color_mode::ansi : color_mode::plain;
             }
             return true;
         }
 
-        /// Write UTF-8 string to console with color code processing.
-        /// Color codes are ESC (0x1b) followed by attribute byte.
-        inline bool write(std::string_view utf8_encoded_string)
+        namespace detail
+        {
+            /// Write UTF-8 text without color processing; terminals take UTF-8 as-is.
+            inline bool write_bytes(std::string_view utf8_encoded_string)
+            {
+                auto &cc = get_context();
+                while (!utf8_encoded_string.empty())
+                {
+                    const auto rc = ::write(STDOUT_FILENO, utf8_encoded_string.data(), utf8_encoded_string.size());
+                    if (rc < 0)
+                    {
+                        if (errno == EINTR)
+                            continue;
+                        cc.write_output_has_failed_once = true;
+                        return false;
+                    }
+                    utf8_encoded_string.remove_prefix(static_cast<size_t>(rc));
+                }
+                return true;
+            }
+        }
+
+        /// Write UTF-16 string to console.
+        inline bool write(std::wstring_view utf16_encoded_string)
         {
             auto &cc = get_context();
 
-            if (utf8_encoded_string.empty())
+            if (utf16_encoded_string.empty())
                 return true;
 
             if (cc.write_output_has_failed_once || !ensure_output_handle())
                 return false;
 
-            const char *p = utf8_encoded_string.data();
-            const char *end = p + utf8_encoded_string.size();
+            return detail::write_bytes(string::encode_as_utf8(utf16_encoded_string));
+        }
+#endif
 
-            while (p < end)
-            {
-                const char *q = std::find(p, end, '\x1b');
-                if (q == end)
-                {
-                    return do_write_output_as_unicode(std::string_view(p, end - p));
-                }
+        /// Force a color mode instead of detecting it (e.g. ansi for output piped into a pager).
+        inline void set_color_mode(color_mode mode)
+        {
+            get_context().mode = mode;
+        }
 
-                if (!cc.has_retrieved_old_color_attrs)
-                {
-                    CONSOLE_SCREEN_BUFFER_INFO csbiInfo{};
-                    GetConsoleScreenBufferInfo(cc.hConsoleOutput, &csbiInfo);
-                    cc.wOldColorAttrs = csbiInfo.wAttributes;
-                    cc.has_retrieved_old_color_attrs = true;
-                }
+        /// Get the color mode in effect (detect until the first output).
+        inline color_mode get_color_mode()
+        {
+            return get_context().mode;
+        }
 
-                if (q > p)
-                {
-                    do_write_output_as_unicode(std::string_view(p, q - p));
-                }
+        /// Write UTF-8 string to console with color code processing.
+        /// Color codes are ESC (0x1b) followed by attribute byte.
+        inline bool write(std::string_view utf8_encoded_string)
+        {
+            auto &cc = get_context();
 
-                // Need at least 2 bytes for escape sequence
-                if (q + 1 >= end)
-                    break;
+            if (utf8_encoded_string.empty())
+                return true;
 
-                if (q[1] == '\xFF')
-                {
-                    SetConsoleTextAttribute(cc.hConsoleOutput, cc.wOldColorAttrs);
-                }
-                else
-                {
-                    SetConsoleTextAttribute(cc.hConsoleOutput, static_cast<WORD>(static_cast<unsigned char>(q[1])));
-                }
+            if (cc.write_output_has_failed_once || !ensure_output_handle())
+                return false;
 
-                p = q + 2;
-            }
-            return true;
+#ifdef PNQ_PLATFORM_WINDOWS
+            if (cc.mode == color_mode::attributes)
+                return detail::write_with_attributes(utf8_encoded_string);
+#endif
+            if (utf8_encoded_string.find('\x1b') == std::string_view::npos)
+                return detail::write_bytes(utf8_encoded_string);
+
+            return detail::write_bytes(detail::translate(utf8_encoded_string, cc.mode));
         }
 
         /// Write text followed by newline.
@@ -236,7 +454,7 @@ namespace pnq
         {
             string::Writer temp;
             temp.append(text);
-            temp.append(string::newline);
+            temp.append(newline);
             return write(temp.as_string());
         }
 
@@ -253,5 +471,91 @@ namespace pnq
         {
             return write_line(std::vformat(text, std::make_format_args(args...)));
         }
+
+        /// Collects console output (with color codes) and writes it in large batches.
+        ///
+        /// Each flush translates colors and transcodes once for the whole buffer and, unless
+        /// colors need SetConsoleTextAttribute, issues a single write. Flushes automatically
+        /// when full and on destruction. Not thread-safe.
+        class BufferedWriter final
+        {
+        public:
+            /// @param capacity bytes collected before the buffer is flushed
+            explicit BufferedWriter(size_t capacity = 64 * 1024)
+                : m_capacity{capacity}
+            {
+                m_buffer.reserve(capacity);
+            }
+
+            ~BufferedWriter()
+            {
+                flush();
+            }
+
+            BufferedWriter(const BufferedWriter &) = delete;
+            BufferedWriter &operator=(const BufferedWriter &) = delete;
+            BufferedWriter(BufferedWriter &&) = delete;
+            BufferedWriter &operator=(BufferedWriter &&) = delete;
+
+            /// Append UTF-8 text with color codes.
+            /// @return false if a flush this caused failed
+            bool write(std::string_view text)
+            {
+                if (m_buffer.size() + text.size() > m_capacity && !flush())
+                    return false;
+
+                // Too large to be worth copying
+                if (text.size() >= m_capacity)
+                    return console::write(text);
+
+                m_buffer.append(text);
+                return true;
+            }
+
+            /// Append text followed by newline.
+            bool write_line(std::string_view text)
+            {
+                return write(text) && write(newline);
+            }
+
+            /// Format directly into the buffer.
+            template <typename... Args>
+            bool format(std::format_string<Args...> text, Args &&...args)
+            {
+                std::format_to(std::back_inserter(m_buffer), text, std::forward<Args>(args)...);
+                return m_buffer.size() < m_capacity || flush();
+            }
+
+            /// Format directly into the buffer, followed by newline.
+            template <typename... Args>
+            bool format_line(std::format_string<Args...> text, Args &&...args)
+            {
+                std::format_to(std::back_inserter(m_buffer), text, std::forward<Args>(args)...);
+                m_buffer.append(newline);
+                return m_buffer.size() < m_capacity || flush();
+            }
+
+            /// Write everything collected so far to the console.
+            /// @return true if successful
+            bool flush()
+            {
+                if (m_buffer.empty())
+                    return true;
+
+                const bool result = console::write(m_buffer);
+                m_buffer.clear();
+                return result;
+            }
+
+            /// Get number of bytes waiting for flush().
+            size_t size() const
+            {
+                return m_buffer.size();
+            }
+
+        private:
+            const size_t m_capacity;
+            std::string m_buffer;
+        };
     } // namespace console
 } // namespace pnq
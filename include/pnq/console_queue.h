@@ -0,0 +1,263 @@
+#pragma once
+
+/// @file pnq/console_queue.h
+/// @brief Tear-free console lines from many threads without a global lock.
+
+#include <atomic>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <pnq/console.h>
+
+namespace pnq
+{
+    namespace console
+    {
+        /// Multi-producer queue of complete lines, written by a single background thread.
+        ///
+        /// publish() is lock-free and never waits for the sink: text is pushed onto an intrusive
+        /// stack that the writer thread takes over as a whole, restores to publishing order and
+        /// hands to the sink as one batch. Text published by one thread comes out in the same
+        /// order; each publish() comes out in one piece.
+        ///
+        /// The queue is unbounded: if the sink is slower than the producers, memory grows
+        /// instead of producers stalling.
+        class LineQueue final
+        {
+        public:
+            /// Receives the text of one or more publish() calls, concatenated.
+            using Sink = std::function<void(std::string_view)>;
+
+            explicit LineQueue(Sink sink)
+                : m_sink{std::move(sink)}
+            {
+                m_thread = std::thread{[this] { run(); }};
+            }
+
+            /// Write everything published so far, then stop the writer thread.
+            ~LineQueue()
+            {
+                push(&m_stop);
+                m_thread.join();
+            }
+
+            LineQueue(const LineQueue &) = delete;
+            LineQueue &operator=(const LineQueue &) = delete;
+            LineQueue(LineQueue &&) = delete;
+            LineQueue &operator=(LineQueue &&) = delete;
+
+            /// Queue text for the writer thread.
+            void publish(std::string text)
+            {
+                if (text.empty())
+                    return;
+
+                // Count before pushing, so a flush() target always covers text already written
+                m_published.fetch_add(1, std::memory_order_relaxed);
+                push(new Node{nullptr, std::move(text)});
+            }
+
+            /// Wait until everything published so far (by any thread) has reached the sink.
+            void flush()
+            {
+                const auto target = m_published.load(std::memory_order_acquire);
+                for (auto written = m_written.load(std::memory_order_acquire); written < target;
+                     written = m_written.load(std::memory_order_acquire))
+                {
+                    m_written.wait(written, std::memory_order_acquire);
+                }
+            }
+
+            /// Queue shared by all LineWriters that write to the console.
+            static LineQueue &console()
+            {
+                static LineQueue queue{[] {
+                    // Set up the console before the queue exists: the atexit handler that restores
+                    // the console mode then runs after ~LineQueue has written the last lines.
+                    pnq::console::ensure_output_handle();
+                    return Sink{[](std::string_view batch) { pnq::console::write(batch); }};
+                }()};
+                return queue;
+            }
+
+        private:
+            struct Node
+            {
+                Node *next;
+                std::string text;
+            };
+
+            void push(Node *node)
+            {
+                auto *head = m_head.load(std::memory_order_relaxed);
+                do
+                {
+                    node->next = head;
+                } while (!m_head.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+
+                // Only an empty queue can have a sleeping writer
+                if (!head)
+                    m_head.notify_one();
+            }
+
+            /// Writer thread: take all queued nodes, reverse them and write them as one batch.
+            void run()
+            {
+                std::string batch;
+                for (;;)
+                {
+                    m_head.wait(nullptr, std::memory_order_acquire);
+                    auto *node = m_head.exchange(nullptr, std::memory_order_acquire);
+
+                    Node *ordered = nullptr;
+                    while (node)
+                    {
+                        auto *next = node->next;
+                        node->next = ordered;
+                        ordered = node;
+                        node = next;
+                    }
+
+                    bool stopping = false;
+                    std::uint64_t count = 0;
+                    batch.clear();
+                    while (ordered)
+                    {
+                        auto *next = ordered->next;
+                        if (ordered == &m_stop)
+                        {
+                            stopping = true;
+                        }
+                        else
+                        {
+                            batch.append(ordered->text);
+                            delete ordered;
+                            ++count;
+                        }
+                        ordered = next;
+                    }
+
+                    if (!batch.empty())
+                        m_sink(batch);
+                    if (count)
+                    {
+                        m_written.fetch_add(count, std::memory_order_release);
+                        m_written.notify_all();
+                    }
+                    if (stopping)
+                        return;
+                }
+            }
+
+            Sink m_sink;
+            std::atomic<Node *> m_head{nullptr};
+            std::atomic<std::uint64_t> m_published{0};
+            std::atomic<std::uint64_t> m_written{0};
+            Node m_stop{nullptr, {}};
+            std::thread m_thread;
+        };
+
+        /// Per-thread line buffer in front of a LineQueue.
+        ///
+        /// Text is collected until a line is complete; only complete lines are published, so
+        /// lines from different threads never interleave. Use one LineWriter per thread
+        /// (see thread_line_writer()); a LineWriter itself is not thread-safe.
+        class LineWriter final
+        {
+        public:
+            explicit LineWriter(LineQueue &queue = LineQueue::console())
+                : m_queue{queue}
+            {
+            }
+
+            /// Publishes an incomplete last line as-is.
+            ~LineWriter()
+            {
+                publish_all();
+            }
+
+            LineWriter(const LineWriter &) = delete;
+            LineWriter &operator=(const LineWriter &) = delete;
+            LineWriter(LineWriter &&) = delete;
+            LineWriter &operator=(LineWriter &&) = delete;
+
+            /// Append UTF-8 text (with color codes); publishes every line it completes.
+            void write(std::string_view text)
+            {
+                m_pending.append(text);
+                publish_complete_lines();
+            }
+
+            /// Append text and end the line.
+            void write_line(std::string_view text)
+            {
+                m_pending.append(text);
+                m_pending.append(newline);
+                publish_all();
+            }
+
+            /// Format into the current line.
+            template <typename... Args>
+            void format(std::format_string<Args...> text, Args &&...args)
+            {
+                std::format_to(std::back_inserter(m_pending), text, std::forward<Args>(args)...);
+                publish_complete_lines();
+            }
+
+            /// Format into the current line and end it.
+            template <typename... Args>
+            void format_line(std::format_string<Args...> text, Args &&...args)
+            {
+                std::format_to(std::back_inserter(m_pending), text, std::forward<Args>(args)...);
+                m_pending.append(newline);
+                publish_all();
+            }
+
+            /// Publish the incomplete line and wait until all queued text has been written.
+            void flush()
+            {
+                publish_all();
+                m_queue.flush();
+            }
+
+        private:
+            void publish_all()
+            {
+                m_queue.publish(std::move(m_pending));
+                m_pending.clear();
+            }
+
+            void publish_complete_lines()
+            {
+                const auto end = m_pending.rfind('\n');
+                if (end == std::string::npos)
+                    return;
+
+                if (end + 1 == m_pending.size())
+                {
+                    publish_all();
+                    return;
+                }
+                m_queue.publish(m_pending.substr(0, end + 1));
+                m_pending.erase(0, end + 1);
+            }
+
+            LineQueue &m_queue;
+            std::string m_pending;
+        };
+
+        /// LineWriter of the calling thread for the console queue.
+        inline LineWriter &thread_line_writer()
+        {
+            // Construct the queue first so it outlives the writers of the main thread
+            LineQueue::console();
+            thread_local LineWriter writer;
+            return writer;
+        }
+    } // namespace console
+} // namespace pnq
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <cstdlib>
 #include <string>
 #include <vector>
 
+#include <pnq/platform.h>
 #include <pnq/string.h>
 
 namespace pnq
@@ -15,6 +17,7 @@ namespace pnq
         /// @return true if variable exists, false otherwise
         inline bool get(std::string_view name, std::string &value)
         {
+#ifdef PNQ_PLATFORM_WINDOWS
             const auto wide_name = string::encode_as_utf16(name);
             const auto bytes_needed = GetEnvironmentVariableW(wide_name.c_str(), nullptr, 0);
             if (bytes_needed == 0)
@@ -27,6 +30,14 @@ namespace pnq
                 return true;
             }
             return false;
+#else
+            const char *result = std::getenv(std::string{name}.c_str());
+            if (!result)
+                return false;
+
+            value = result;
+            return true;
+#endif
         }
 
     } // namespace environment_variables
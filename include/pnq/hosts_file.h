@@ -1,14 +1,21 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstring>
+#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <optional>
+#include <span>
 #include <sstream>
+#include <unordered_map>
 #include <vector>
 
 #include <pnq/pnq.h>
+#include <pnq/binary_file.h>
 #include <pnq/directory.h>
 #include <pnq/file.h>
 
@@ -16,6 +23,9 @@ namespace pnq
 {
     /// Helper class for reading/modifying the Windows hosts file.
     /// Preserves comments, blank lines, and file structure.
+    /// Each line is parsed once on load; a case-insensitive hostname index makes
+    /// find/contains/set/remove independent of the file size.
+    /// Loaded lines are views into a single buffer; only edited lines own their text.
     class HostsFile
     {
     public:
@@ -26,6 +36,47 @@ namespace pnq
             std::string comment;
         };
 
+        /// Non-owning view of a single entry, valid until the HostsFile is modified.
+        struct EntryView
+        {
+            std::string_view ip;
+            std::string_view hostname;
+            std::string_view comment;
+        };
+
+        HostsFile() = default;
+
+        /// Copies share nothing with the original: line views are rebuilt over the copy's own storage.
+        HostsFile(const HostsFile& other)
+        {
+            copy_from(other);
+        }
+
+        HostsFile& operator=(const HostsFile& other)
+        {
+            if (this != &other)
+            {
+                clear();
+                copy_from(other);
+            }
+            return *this;
+        }
+
+        HostsFile(HostsFile&& other)
+        {
+            take_from(other);
+        }
+
+        HostsFile& operator=(HostsFile&& other)
+        {
+            if (this != &other)
+            {
+                clear();
+                take_from(other);
+            }
+            return *this;
+        }
+
         /// Get the system hosts file path.
         static std::string system_path()
         {
@@ -36,35 +87,49 @@ namespace pnq
         bool load(const std::string& path = {})
         {
             m_path = path.empty() ? system_path() : path;
-            m_lines.clear();
+            clear();
 
-            std::ifstream file(m_path);
+            // Read the whole file with a single read; lines become views into this buffer.
+            std::ifstream file(m_path, std::ios::binary | std::ios::ate);
             if (!file.is_open())
             {
                 PNQ_LOG_WARN("Failed to open hosts file: {}", m_path);
                 return false;
             }
 
-            std::string line;
-            while (std::getline(file, line))
-                m_lines.push_back(line);
+            const auto size = static_cast<size_t>(file.tellg());
+            m_buffer.resize(size);
+            file.seekg(0);
+            if (size && !file.read(m_buffer.data(), static_cast<std::streamsize>(size)))
+            {
+                PNQ_LOG_WARN("Failed to read hosts file: {}", m_path);
+                m_buffer.clear();
+                return false;
+            }
 
+            split_buffer(true);
             return true;
         }
 
         /// Load hosts file from string content.
         void load_from_string(std::string_view content)
+        {
+            load_from_buffer(std::string{content});
+        }
+
+        /// Load hosts file from a buffer, taking ownership of it (no copy).
+        void load_from_buffer(std::string content)
         {
             m_path.clear();
-            m_lines.clear();
+            clear();
 
-            std::istringstream iss{std::string{content}};
-            std::string line;
-            while (std::getline(iss, line))
-                m_lines.push_back(line);
+            m_buffer = std::move(content);
+            split_buffer(false);
         }
 
         /// Save hosts file (creates timestamped backup first if path was loaded from file).
+        /// The content is written with a single write to a sibling temp file and committed to disk,
+        /// which then replaces the original. ReplaceFileW keeps the original's ACL, owner and attributes.
         bool save()
         {
             if (m_path.empty())
@@ -73,181 +138,548 @@ namespace pnq
             if (!create_backup())
                 return false;
 
-            std::ofstream file(m_path);
-            if (!file.is_open())
+            std::string content = to_string();
+            if (m_live_lines && !last_live_line().text.empty())
+                content += '\n';
+
+            const std::string temp_path = m_path + ".tmp";
+            if (!write_temp_file(temp_path, content))
             {
-                PNQ_LOG_ERROR("Failed to open hosts file for writing: {}", m_path);
+                PNQ_LOG_ERROR("Failed to write hosts file: {}", temp_path);
+                file::remove(temp_path);
                 return false;
             }
 
-            for (size_t i = 0; i < m_lines.size(); ++i)
+            const auto wide_path = string::encode_as_utf16(m_path);
+            const auto wide_temp_path = string::encode_as_utf16(temp_path);
+            if (!::ReplaceFileW(wide_path.c_str(), wide_temp_path.c_str(), nullptr, REPLACEFILE_IGNORE_MERGE_ERRORS, nullptr, nullptr))
             {
-                file << m_lines[i];
-                if (i + 1 < m_lines.size())
-                    file << '\n';
+                // Nothing to replace (new file): a plain move is all there is to do
+                if (::GetLastError() != ERROR_FILE_NOT_FOUND ||
+                    !::MoveFileExW(wide_temp_path.c_str(), wide_path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+                {
+                    PNQ_LOG_LAST_ERROR("Failed to replace hosts file {}", m_path);
+                    file::remove(temp_path);
+                    return false;
+                }
             }
-
-            if (!m_lines.empty() && !m_lines.back().empty())
-                file << '\n';
-
             return true;
         }
 
         /// Export current content as string.
         std::string to_string() const
         {
-            std::ostringstream oss;
-            for (size_t i = 0; i < m_lines.size(); ++i)
+            size_t total = 0;
+            for (const auto& line : m_lines)
+            {
+                if (!line.removed)
+                    total += line.text.size() + 1;
+            }
+
+            std::string result;
+            result.reserve(total);
+            bool first = true;
+            for (const auto& line : m_lines)
             {
-                oss << m_lines[i];
-                if (i + 1 < m_lines.size())
-                    oss << '\n';
+                if (line.removed)
+                    continue;
+                if (first)
+                    first = false;
+                else
+                    result += '\n';
+                result += line.text;
             }
-            return oss.str();
+            return result;
         }
 
         /// Find entry by hostname (case-insensitive).
         std::optional<Entry> find(std::string_view hostname) const
         {
-            for (const auto& line : m_lines)
-            {
-                if (auto entry = parse_line(line))
-                {
-                    if (contains_hostname(*entry, hostname))
-                        return Entry{entry->ip, std::string{hostname}, entry->comment};
-                }
-            }
-            return std::nullopt;
+            const auto index = first_line_of(hostname);
+            if (!index)
+                return std::nullopt;
+
+            const auto& line = m_lines[*index];
+            return Entry{std::string{token(line, line.ip)}, std::string{hostname}, std::string{token(line, line.comment)}};
         }
 
         /// Check if hostname exists.
         bool contains(std::string_view hostname) const
         {
-            return find(hostname).has_value();
+            return m_index.find(hostname) != m_index.end();
         }
 
         /// Add or update entry for hostname.
+        /// The text of an overwritten edit is reclaimed once superseded edits outnumber live lines.
         void set(std::string_view hostname, std::string_view ip, std::string_view comment = {})
         {
-            // Try to update existing
+            set_line(hostname, m_owned.emplace_back(format_entry(ip, hostname, comment)));
+            compact_if_wasteful();
+        }
+
+        /// Add or update many entries; equivalent to calling set() for each, in order.
+        /// All new line text is formatted into a single allocation.
+        void apply(std::span<const Entry> entries)
+        {
+            std::vector<EntryView> views;
+            views.reserve(entries.size());
+            for (const auto& entry : entries)
+                views.push_back(EntryView{entry.ip, entry.hostname, entry.comment});
+            apply_views(views);
+        }
+
+        /// Add or update every entry of another hosts file (e.g. a blocklist); entries in other win.
+        void merge_from(const HostsFile& other)
+        {
+            std::vector<EntryView> views;
+            views.reserve(other.m_index.size());
+            other.for_each_entry([&views](const EntryView& entry) { views.push_back(entry); });
+            apply_views(views);
+        }
+
+        /// Remove every line that has at least one entry matching pred.
+        /// @param pred callable taking const EntryView& and returning bool
+        /// @return number of lines removed
+        template <typename Predicate>
+        size_t remove_if(Predicate pred)
+        {
+            size_t removed = 0;
             for (auto& line : m_lines)
             {
-                if (auto entry = parse_line(line))
+                if (line.removed)
+                    continue;
+                for (uint32_t i = 0; i < line.hostname_count; ++i)
                 {
-                    if (contains_hostname(*entry, hostname))
+                    if (pred(EntryView{token(line, line.ip), token(line, m_hostnames[line.first_hostname + i]), token(line, line.comment)}))
                     {
-                        line = format_entry(ip, hostname, comment);
-                        return;
+                        line.removed = true;
+                        ++removed;
+                        break;
                     }
                 }
             }
 
-            // Append new entry
-            m_lines.push_back(format_entry(ip, hostname, comment));
+            // One rebuild instead of unindexing line by line
+            if (removed)
+            {
+                m_live_lines -= removed;
+                compact();
+            }
+            return removed;
         }
 
         /// Remove entry containing hostname.
         bool remove(std::string_view hostname)
         {
-            bool removed = false;
-            std::vector<std::string> filtered;
+            std::vector<size_t> matches;
+            auto [first, last] = m_index.equal_range(hostname);
+            for (auto it = first; it != last; ++it)
+                matches.push_back(it->second);
 
-            for (const auto& line : m_lines)
+            if (matches.empty())
+                return false;
+
+            for (const auto index : matches)
             {
-                auto entry = parse_line(line);
-                if (entry && contains_hostname(*entry, hostname))
-                    removed = true;
-                else
-                    filtered.push_back(line);
+                // A line listing the same hostname twice shows up twice in the index
+                if (m_lines[index].removed)
+                    continue;
+                unindex_line(index);
+                m_lines[index].removed = true;
+                --m_live_lines;
             }
 
-            m_lines = std::move(filtered);
-            return removed;
+            compact_if_wasteful();
+            return true;
         }
 
         /// Get all entries (skips comments and blank lines).
         std::vector<Entry> entries() const
         {
             std::vector<Entry> result;
+            result.reserve(m_index.size());
+            for_each_entry([&result](const EntryView& entry) {
+                result.push_back(Entry{std::string{entry.ip}, std::string{entry.hostname}, std::string{entry.comment}});
+            });
+            return result;
+        }
+
+        /// Invoke callback with an EntryView for every entry, in file order, without copying.
+        template <typename Callback>
+        void for_each_entry(Callback callback) const
+        {
             for (const auto& line : m_lines)
             {
-                if (auto parsed = parse_line(line))
-                {
-                    for (const auto& hostname : parsed->hostnames)
-                        result.push_back(Entry{parsed->ip, hostname, parsed->comment});
-                }
+                if (line.removed)
+                    continue;
+                for (uint32_t i = 0; i < line.hostname_count; ++i)
+                    callback(EntryView{token(line, line.ip), token(line, m_hostnames[line.first_hostname + i]), token(line, line.comment)});
             }
-            return result;
         }
 
         /// Get the loaded file path.
         const std::string& path() const { return m_path; }
 
         /// Get raw line count.
-        size_t line_count() const { return m_lines.size(); }
+        size_t line_count() const { return m_live_lines; }
 
     private:
-        struct ParsedLine
+        /// Offset/length pair into a line's text, so it survives moves of the owning string.
+        struct Token
         {
-            std::string ip;
-            std::vector<std::string> hostnames;
-            std::string comment;
+            uint32_t pos{0};
+            uint32_t len{0};
         };
 
-        static std::optional<ParsedLine> parse_line(const std::string& line)
+        /// A raw line plus the result of parsing it once.
+        /// text views either m_buffer (as loaded) or an m_owned string (edited/appended).
+        /// Lines without hostnames (comments, blanks, malformed) have hostname_count == 0.
+        struct Line
         {
-            // Skip empty lines and comment-only lines
-            size_t start = line.find_first_not_of(" \t");
-            if (start == std::string::npos || line[start] == '#')
-                return std::nullopt;
+            std::string_view text;
+            Token ip;
+            Token comment;
+            uint32_t first_hostname{0};
+            uint32_t hostname_count{0};
+            bool removed{false};
+        };
+
+        /// Tombstoned lines and superseded edits are only dropped once they outnumber live lines by this margin.
+        static constexpr size_t compaction_threshold = 1024;
+
+        static std::string_view token(const Line& line, Token t)
+        {
+            return line.text.substr(t.pos, t.len);
+        }
+
+        /// Character class table for the tokenizer: 1 = whitespace, 2 = comment start.
+        static constexpr auto char_classes = []
+        {
+            std::array<uint8_t, 256> table{};
+            for (const unsigned char c : std::string_view{" \t\r\n\v\f"})
+                table[c] = 1;
+            table['#'] = 2;
+            return table;
+        }();
+
+        void clear()
+        {
+            m_buffer.clear();
+            m_owned.clear();
+            m_lines.clear();
+            m_hostnames.clear();
+            m_index.clear();
+            m_live_lines = 0;
+            m_superseded_edits = 0;
+        }
+
+        const Line& last_live_line() const
+        {
+            auto it = std::find_if(m_lines.rbegin(), m_lines.rend(), [](const Line& line) { return !line.removed; });
+            return *it;
+        }
+
+        /// Split m_buffer into line views, with std::getline semantics (no empty trailing line).
+        /// memchr is vectorized by every mainstream CRT, so the newline scan runs at memory bandwidth.
+        /// @param strip_cr drop the '\r' of CRLF endings, like a text-mode stream would
+        void split_buffer(bool strip_cr)
+        {
+            const char* pos = m_buffer.data();
+            const char* const end = pos + m_buffer.size();
+
+            const auto line_estimate = static_cast<size_t>(std::count(pos, end, '\n')) + 1;
+            m_lines.reserve(line_estimate);
+            m_index.reserve(line_estimate);
+            while (pos < end)
+            {
+                const auto* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+                const char* line_end = newline ? newline : end;
+
+                std::string_view text{pos, static_cast<size_t>(line_end - pos)};
+                if (strip_cr && newline && !text.empty() && text.back() == '\r')
+                    text.remove_suffix(1);
+                append_line(text);
+
+                pos = newline ? newline + 1 : end;
+            }
+        }
+
+        void append_line(std::string text)
+        {
+            append_line(std::string_view{m_owned.emplace_back(std::move(text))});
+        }
 
-            ParsedLine result;
+        void append_line(std::string_view text)
+        {
+            auto& line = m_lines.emplace_back();
+            line.text = text;
+            parse_line(line);
+            index_line(m_lines.size() - 1);
+            ++m_live_lines;
+        }
 
-            // Extract comment
-            std::string content = line;
-            if (size_t pos = line.find('#'); pos != std::string::npos)
+        /// Tokenize a line into ip, hostnames and comment. Hostname tokens are appended to m_hostnames.
+        /// Single pass over the line using the char_classes table.
+        void parse_line(Line& line)
+        {
+            line.ip = {};
+            line.comment = {};
+            line.first_hostname = static_cast<uint32_t>(m_hostnames.size());
+            line.hostname_count = 0;
+
+            const std::string_view text{line.text};
+            const size_t size = text.size();
+
+            bool have_ip = false;
+            Token ip;
+            size_t i = 0;
+            while (i < size)
             {
-                result.comment = line.substr(pos + 1);
-                if (size_t cstart = result.comment.find_first_not_of(" \t"); cstart != std::string::npos)
-                    result.comment = result.comment.substr(cstart);
+                const auto cls = char_classes[static_cast<unsigned char>(text[i])];
+                if (cls == 1)
+                {
+                    ++i;
+                    continue;
+                }
+
+                if (cls == 2)
+                {
+                    // Comment-only lines carry no entry
+                    if (!have_ip)
+                        return;
+
+                    size_t cstart = i + 1;
+                    while (cstart < size && (text[cstart] == ' ' || text[cstart] == '\t'))
+                        ++cstart;
+                    if (cstart < size)
+                        line.comment = Token{static_cast<uint32_t>(cstart), static_cast<uint32_t>(size - cstart)};
+                    break;
+                }
+
+                const size_t start = i;
+                while (i < size && char_classes[static_cast<unsigned char>(text[i])] == 0)
+                    ++i;
+
+                const Token t{static_cast<uint32_t>(start), static_cast<uint32_t>(i - start)};
+                if (!have_ip)
+                {
+                    ip = t;
+                    have_ip = true;
+                }
                 else
-                    result.comment.clear();
-                content = line.substr(0, pos);
+                {
+                    m_hostnames.push_back(t);
+                    ++line.hostname_count;
+                }
             }
 
-            // Parse IP and hostnames
-            std::istringstream iss(content);
-            iss >> result.ip;
-            if (result.ip.empty())
-                return std::nullopt;
+            if (line.hostname_count == 0)
+            {
+                line.comment = {};
+                return;
+            }
+            line.ip = ip;
+        }
 
-            std::string hostname;
-            while (iss >> hostname)
-                result.hostnames.push_back(hostname);
+        void index_line(size_t index)
+        {
+            const auto& line = m_lines[index];
+            for (uint32_t i = 0; i < line.hostname_count; ++i)
+                m_index.emplace(token(line, m_hostnames[line.first_hostname + i]), index);
+        }
 
-            if (result.hostnames.empty())
-                return std::nullopt;
+        void unindex_line(size_t index)
+        {
+            const auto& line = m_lines[index];
+            for (uint32_t i = 0; i < line.hostname_count; ++i)
+            {
+                auto [first, last] = m_index.equal_range(token(line, m_hostnames[line.first_hostname + i]));
+                for (auto it = first; it != last;)
+                {
+                    if (it->second == index)
+                        it = m_index.erase(it);
+                    else
+                        ++it;
+                }
+            }
+        }
+
+        /// Point the first line containing hostname at text, or append text as a new line.
+        /// text must live in m_buffer or m_owned.
+        void set_line(std::string_view hostname, std::string_view text)
+        {
+            if (const auto index = first_line_of(hostname))
+            {
+                if (!is_in_buffer(m_lines[*index].text))
+                    ++m_superseded_edits;
+                unindex_line(*index);
+                m_lines[*index].text = text;
+                parse_line(m_lines[*index]);
+                index_line(*index);
+                return;
+            }
+            append_line(text);
+        }
+
+        void apply_views(const std::vector<EntryView>& entries)
+        {
+            size_t total = 0;
+            for (const auto& entry : entries)
+                total += formatted_size(entry.ip, entry.hostname, entry.comment);
+
+            // Format everything first: entries may view our own lines (merge_from(*this)),
+            // and those must not change underneath us.
+            auto& chunk = m_owned.emplace_back();
+            chunk.reserve(total);
+            for (const auto& entry : entries)
+                append_entry(chunk, entry.ip, entry.hostname, entry.comment);
+
+            m_lines.reserve(m_lines.size() + entries.size());
+            m_index.reserve(m_index.size() + entries.size());
+            const std::string_view formatted{chunk};
+            size_t pos = 0;
+            for (const auto& entry : entries)
+            {
+                const auto size = formatted_size(entry.ip, entry.hostname, entry.comment);
+                set_line(entry.hostname, formatted.substr(pos, size));
+                pos += size;
+            }
 
+            // Not inside the loop: compacting would free the chunk formatted views
+            compact_if_wasteful();
+        }
+
+        /// Index of the first line (in file order) containing hostname.
+        std::optional<size_t> first_line_of(std::string_view hostname) const
+        {
+            std::optional<size_t> result;
+            auto [first, last] = m_index.equal_range(hostname);
+            for (auto it = first; it != last; ++it)
+            {
+                if (!result || it->second < *result)
+                    result = it->second;
+            }
             return result;
         }
 
-        static bool contains_hostname(const ParsedLine& entry, std::string_view hostname)
+        bool is_in_buffer(std::string_view text) const
+        {
+            return text.data() >= m_buffer.data() && text.data() < m_buffer.data() + m_buffer.size();
+        }
+
+        /// Copy the live lines of other; edited lines get their own strings, like compact() does.
+        void copy_from(const HostsFile& other)
         {
-            for (const auto& h : entry.hostnames)
+            m_path = other.m_path;
+            m_buffer = other.m_buffer;
+            m_lines.reserve(other.m_live_lines);
+            m_index.reserve(other.m_index.size());
+            for (const auto& line : other.m_lines)
             {
-                if (string::equals_nocase(h, hostname))
-                    return true;
+                if (line.removed)
+                    continue;
+                if (other.is_in_buffer(line.text))
+                    append_line(std::string_view{m_buffer}.substr(static_cast<size_t>(line.text.data() - other.m_buffer.data()), line.text.size()));
+                else
+                    append_line(std::string{line.text});
             }
-            return false;
         }
 
-        static std::string format_entry(std::string_view ip, std::string_view hostname, std::string_view comment)
+        /// Take over the storage of other. Moving a deque keeps its strings in place, but m_buffer
+        /// may be stored inline, so lines viewing it are rebased and the index is rebuilt.
+        void take_from(HostsFile& other)
+        {
+            const char* const old_buffer = other.m_buffer.data();
+            const size_t old_size = other.m_buffer.size();
+
+            m_path = std::move(other.m_path);
+            m_buffer = std::move(other.m_buffer);
+            m_owned = std::move(other.m_owned);
+            m_lines = std::move(other.m_lines);
+            m_hostnames = std::move(other.m_hostnames);
+            m_live_lines = other.m_live_lines;
+            m_superseded_edits = other.m_superseded_edits;
+
+            for (auto& line : m_lines)
+            {
+                if (line.text.data() >= old_buffer && line.text.data() < old_buffer + old_size)
+                    line.text = std::string_view{m_buffer}.substr(static_cast<size_t>(line.text.data() - old_buffer), line.text.size());
+            }
+
+            m_index.reserve(other.m_index.size());
+            for (size_t i = 0; i < m_lines.size(); ++i)
+            {
+                if (!m_lines[i].removed)
+                    index_line(i);
+            }
+            other.clear();
+        }
+
+        /// Compact once tombstoned lines and superseded edits outnumber live lines.
+        void compact_if_wasteful()
+        {
+            const size_t waste = (m_lines.size() - m_live_lines) + m_superseded_edits;
+            if (waste > compaction_threshold && waste > m_live_lines)
+                compact();
+        }
+
+        /// Drop tombstoned lines and superseded edits, then rebuild hostname tokens and index.
+        void compact()
         {
-            std::ostringstream oss;
-            oss << ip << "\t" << hostname;
+            std::deque<std::string> owned;
+            std::vector<Line> lines;
+            lines.reserve(m_live_lines);
+            for (const auto& line : m_lines)
+            {
+                if (line.removed)
+                    continue;
+                auto& copy = lines.emplace_back();
+                copy.text = is_in_buffer(line.text) ? line.text : std::string_view{owned.emplace_back(line.text)};
+            }
+
+            m_owned = std::move(owned);
+            m_lines = std::move(lines);
+            m_hostnames.clear();
+            m_index.clear();
+            for (size_t i = 0; i < m_lines.size(); ++i)
+            {
+                parse_line(m_lines[i]);
+                index_line(i);
+            }
+            m_live_lines = m_lines.size();
+            m_superseded_edits = 0;
+        }
+
+        static size_t formatted_size(std::string_view ip, std::string_view hostname, std::string_view comment)
+        {
+            return ip.size() + 1 + hostname.size() + (comment.empty() ? 0 : 3 + comment.size());
+        }
+
+        static void append_entry(std::string& output, std::string_view ip, std::string_view hostname, std::string_view comment)
+        {
+            output += ip;
+            output += '\t';
+            output += hostname;
             if (!comment.empty())
-                oss << " # " << comment;
-            return oss.str();
+            {
+                output += " # ";
+                output += comment;
+            }
+        }
+
+        static std::string format_entry(std::string_view ip, std::string_view hostname, std::string_view comment)
+        {
+            std::string result;
+            result.reserve(formatted_size(ip, hostname, comment));
+            append_entry(result, ip, hostname, comment);
+            return result;
+        }
+
+        /// Write content with a single write and commit it to disk before it replaces anything.
+        static bool write_temp_file(const std::string& path, std::string_view content)
+        {
+            BinaryFile output;
+            return output.create_for_writing(path) && output.write(memory_view{content}) && output.sync();
         }
 
         bool create_backup()
@@ -282,7 +714,13 @@ namespace pnq
         }
 
         std::string m_path;
-        std::vector<std::string> m_lines;
+        std::string m_buffer;
+        std::deque<std::string> m_owned;
+        std::vector<Line> m_lines;
+        std::vector<Token> m_hostnames;
+        std::unordered_multimap<std::string_view, size_t, string::nocase_hash, string::nocase_equal> m_index;
+        size_t m_live_lines{0};
+        size_t m_superseded_edits{0};
     };
 
 } // namespace pnq
@@ -5,6 +5,273 @@
 ///
 /// Define PNQ_USE_QUILL before including this header to use Quill instead of spdlog.
 /// Both backends use std::format syntax for format strings.
+///
+/// Arguments of a PNQ_LOG_* statement are only evaluated if its level is enabled at runtime.
+/// Statements below PNQ_LOG_ACTIVE_LEVEL are removed at compile time.
+/// With PNQ_USE_BINARY_LOG defined they can also be recorded in binary form (see pnq/binary_log.h).
+
+/// Levels for PNQ_LOG_ACTIVE_LEVEL.
+#define PNQ_LOG_LEVEL_TRACE    0
+#define PNQ_LOG_LEVEL_DEBUG    1
+#define PNQ_LOG_LEVEL_INFO     2
+#define PNQ_LOG_LEVEL_WARN     3
+#define PNQ_LOG_LEVEL_ERROR    4
+#define PNQ_LOG_LEVEL_CRITICAL 5
+#define PNQ_LOG_LEVEL_OFF      6
+
+/// Lowest level compiled into the program, e.g. -DPNQ_LOG_ACTIVE_LEVEL=PNQ_LOG_LEVEL_INFO
+/// for release builds. Must be the same in every translation unit.
+#ifndef PNQ_LOG_ACTIVE_LEVEL
+#define PNQ_LOG_ACTIVE_LEVEL PNQ_LOG_LEVEL_TRACE
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+/// A statement that is type-checked (so variables used only for logging stay "used")
+/// but never executed, and not compiled into the binary.
+#define PNQ_LOG_ELIDED(...) do { if constexpr (false) { __VA_ARGS__; } } while (0)
+
+namespace pnq::logging
+{
+    namespace detail
+    {
+        class SuppressedCount;
+
+        /// Call sites holding suppressed counts, for flush_suppressed().
+        struct SuppressedCountRegistry
+        {
+            std::mutex mutex;
+            std::vector<SuppressedCount*> counts;
+        };
+
+        /// Never destroyed: call sites with static storage duration unregister after it would be gone.
+        inline SuppressedCountRegistry& suppressed_counts()
+        {
+            static auto* registry = new SuppressedCountRegistry;
+            return *registry;
+        }
+
+        /// Statements a call site did not log and has not reported yet.
+        /// The first suppressed statement registers the call site once, so flush_suppressed() can
+        /// report counts that no later statement reported.
+        class SuppressedCount
+        {
+        public:
+            /// Take the count of suppressed statements that were not reported yet.
+            std::uint32_t take_suppressed() noexcept
+            {
+                return m_suppressed.exchange(0, std::memory_order_relaxed);
+            }
+
+            const char* file() const noexcept { return m_file; }
+            std::uint32_t line() const noexcept { return m_line; }
+            int level() const noexcept { return m_level; }
+
+        protected:
+            SuppressedCount() = default;
+
+            constexpr SuppressedCount(const char* file, std::uint32_t line, int level) noexcept
+                : m_file{file}
+                , m_line{line}
+                , m_level{level}
+            {
+            }
+
+            ~SuppressedCount()
+            {
+                if (!m_registered.load(std::memory_order_acquire))
+                    return;
+                auto& registry = suppressed_counts();
+                std::lock_guard lock{registry.mutex};
+                std::erase(registry.counts, this);
+            }
+
+            SuppressedCount(const SuppressedCount&) = delete;
+            SuppressedCount& operator=(const SuppressedCount&) = delete;
+
+            void add_suppressed(std::uint32_t count)
+            {
+                m_suppressed.fetch_add(count, std::memory_order_relaxed);
+                if (!m_registered.load(std::memory_order_relaxed) && !m_registered.exchange(true, std::memory_order_acq_rel))
+                {
+                    auto& registry = suppressed_counts();
+                    std::lock_guard lock{registry.mutex};
+                    registry.counts.push_back(this);
+                }
+            }
+
+        private:
+            std::atomic<std::uint32_t> m_suppressed{0};
+            std::atomic<bool> m_registered{false};
+            const char* m_file{""};
+            std::uint32_t m_line{0};
+            int m_level{PNQ_LOG_LEVEL_INFO};
+        };
+
+        /// Current steady clock second, for RateLimiter and Deduplicator.
+        inline std::int64_t steady_seconds()
+        {
+            return std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    /// Per-call-site budget of a rate-limited log statement (see PNQ_LOG_RATELIMITED).
+    /// Lock-free; a statement within its budget costs one clock read and one atomic increment.
+    class RateLimiter final : public detail::SuppressedCount
+    {
+    public:
+        RateLimiter() = default;
+
+        /// @param file, line call site named in reports
+        /// @param level PNQ_LOG_LEVEL_* of the reports
+        constexpr RateLimiter(const char* file, std::uint32_t line, int level) noexcept
+            : SuppressedCount{file, line, level}
+        {
+        }
+
+        /// Count a statement against the budget of the current second.
+        /// @param per_second number of statements let through per second
+        /// @param suppressed receives the number of statements suppressed in earlier seconds,
+        ///        if this is the first one let through since
+        /// @return true if the statement should be logged
+        bool allow(std::uint32_t per_second, std::uint32_t& suppressed)
+        {
+            return allow(per_second, suppressed, detail::steady_seconds());
+        }
+
+        /// allow() for a given second instead of the steady clock's.
+        bool allow(std::uint32_t per_second, std::uint32_t& suppressed, std::int64_t now)
+        {
+            std::uint32_t reported = 0;
+            auto window = m_window.load(std::memory_order_relaxed);
+            if (window != now && m_window.compare_exchange_strong(window, now, std::memory_order_relaxed))
+            {
+                m_count.store(0, std::memory_order_relaxed);
+                reported = take_suppressed();
+            }
+
+            if (m_count.fetch_add(1, std::memory_order_relaxed) < per_second)
+            {
+                suppressed = reported;
+                return true;
+            }
+
+            // Other threads used up the new second first: keep the count for them to report
+            add_suppressed(reported + 1);
+            return false;
+        }
+
+    private:
+        std::atomic<std::int64_t> m_window{0};
+        std::atomic<std::uint32_t> m_count{0};
+    };
+
+    /// During a run of identical messages, a deduplicated call site still logs one every this many seconds.
+    inline constexpr std::int64_t dedup_report_interval = 5;
+
+    /// Per-call-site state of a deduplicated log statement (see PNQ_LOG_DEDUPLICATED).
+    /// Lock-free; remembers a hash of the last message and counts repeats of it instead of
+    /// logging them. A repeat costs one clock read and a few atomic operations.
+    class Deduplicator final : public detail::SuppressedCount
+    {
+    public:
+        Deduplicator() = default;
+
+        /// @param file, line call site named in reports
+        /// @param level PNQ_LOG_LEVEL_* of the reports
+        constexpr Deduplicator(const char* file, std::uint32_t line, int level) noexcept
+            : SuppressedCount{file, line, level}
+        {
+        }
+
+        /// Check a message against the last one seen at this call site.
+        /// @param hash hash of the formatted message
+        /// @param repeated receives the number of repeats not reported yet, if the message is let through
+        /// @return true if the message should be logged: it differs from the last one, or a run
+        ///         of repeats has not been reported for dedup_report_interval
+        bool allow(std::size_t hash, std::uint32_t& repeated)
+        {
+            return allow(hash, repeated, detail::steady_seconds());
+        }
+
+        /// allow() for a given second instead of the steady clock's.
+        bool allow(std::size_t hash, std::uint32_t& repeated, std::int64_t now)
+        {
+            if (m_hash.exchange(hash, std::memory_order_relaxed) == hash && m_seen.load(std::memory_order_relaxed))
+            {
+                auto logged = m_logged.load(std::memory_order_relaxed);
+                if (now - logged < dedup_report_interval || !m_logged.compare_exchange_strong(logged, now, std::memory_order_relaxed))
+                {
+                    add_suppressed(1);
+                    return false;
+                }
+            }
+            else
+            {
+                m_seen.store(true, std::memory_order_relaxed);
+                m_logged.store(now, std::memory_order_relaxed);
+            }
+            repeated = take_suppressed();
+            return true;
+        }
+
+    private:
+        std::atomic<std::size_t> m_hash{0};
+        std::atomic<std::int64_t> m_logged{0};
+        std::atomic<bool> m_seen{false};
+    };
+}
+
+/// Run a log statement at most per_second times per second at this call site.
+/// The first statement let through after others were suppressed is followed by a
+/// level_macro message saying how many.
+/// @param lvl PNQ_LOG_LEVEL_* of the statement, for compile-time elision
+#define PNQ_LOG_RATELIMITED(lvl, level_macro, per_second, ...) \
+    do { \
+        if constexpr (PNQ_LOG_ACTIVE_LEVEL <= lvl) \
+        { \
+            static pnq::logging::RateLimiter pnq__limiter{__FILE__, __LINE__, lvl}; \
+            std::uint32_t pnq__suppressed = 0; \
+            if (pnq__limiter.allow(per_second, pnq__suppressed)) \
+            { \
+                __VA_ARGS__; \
+                if (pnq__suppressed) \
+                    level_macro("{} similar messages were suppressed ({}:{})", pnq__suppressed, __FILE__, __LINE__); \
+            } \
+        } \
+    } while (0)
+
+/// Log a message only if it differs from the last one logged at this call site.
+/// Identical messages are counted instead; the next message let through is preceded by a
+/// level_macro message saying how many. The message is formatted (and hashed) only if lvl is enabled.
+/// @param lvl PNQ_LOG_LEVEL_* of the statement, for compile-time elision
+#define PNQ_LOG_DEDUPLICATED(lvl, level_macro, ...) \
+    do { \
+        if constexpr (PNQ_LOG_ACTIVE_LEVEL <= lvl) \
+        { \
+            if (PNQ_LOG_ENABLED(lvl)) \
+            { \
+                static pnq::logging::Deduplicator pnq__dedup{__FILE__, __LINE__, lvl}; \
+                const auto pnq__message = std::format(__VA_ARGS__); \
+                std::uint32_t pnq__repeated = 0; \
+                if (pnq__dedup.allow(std::hash<std::string_view>{}(pnq__message), pnq__repeated)) \
+                { \
+                    if (pnq__repeated) \
+                        level_macro("last message repeated {} times ({}:{})", pnq__repeated, __FILE__, __LINE__); \
+                    level_macro("{}", pnq__message); \
+                } \
+            } \
+        } \
+    } while (0)
 
 #ifdef PNQ_USE_QUILL
 
@@ -25,23 +292,202 @@ namespace pnq::logging
     }
 }
 
-#define PNQ_LOG_TRACE(...) LOG_TRACE_L1(pnq::logging::default_logger(), __VA_ARGS__)
-#define PNQ_LOG_DEBUG(...) LOG_DEBUG(pnq::logging::default_logger(), __VA_ARGS__)
-#define PNQ_LOG_INFO(...)  LOG_INFO(pnq::logging::default_logger(), __VA_ARGS__)
-#define PNQ_LOG_WARN(...)  LOG_WARNING(pnq::logging::default_logger(), __VA_ARGS__)
-#define PNQ_LOG_ERROR(...) LOG_ERROR(pnq::logging::default_logger(), __VA_ARGS__)
-#define PNQ_LOG_CRITICAL(...) LOG_CRITICAL(pnq::logging::default_logger(), __VA_ARGS__)
+namespace pnq::logging::detail
+{
+    /// Whether the default logger logs statements of a PNQ_LOG_LEVEL_* level.
+    inline bool should_log(int lvl)
+    {
+        switch (lvl)
+        {
+        case PNQ_LOG_LEVEL_TRACE:
+            return default_logger()->should_log_statement<quill::LogLevel::TraceL1>();
+        case PNQ_LOG_LEVEL_DEBUG:
+            return default_logger()->should_log_statement<quill::LogLevel::Debug>();
+        case PNQ_LOG_LEVEL_INFO:
+            return default_logger()->should_log_statement<quill::LogLevel::Info>();
+        case PNQ_LOG_LEVEL_WARN:
+            return default_logger()->should_log_statement<quill::LogLevel::Warning>();
+        case PNQ_LOG_LEVEL_ERROR:
+            return default_logger()->should_log_statement<quill::LogLevel::Error>();
+        default:
+            return default_logger()->should_log_statement<quill::LogLevel::Critical>();
+        }
+    }
+}
+
+#define PNQ_LOG_AT_ENABLED(lvl) pnq::logging::detail::should_log(lvl)
+
+// Quill's macros check the level before evaluating their arguments
+#define PNQ_LOG_AT_TRACE(...) LOG_TRACE_L1(pnq::logging::default_logger(), __VA_ARGS__)
+#define PNQ_LOG_AT_DEBUG(...) LOG_DEBUG(pnq::logging::default_logger(), __VA_ARGS__)
+#define PNQ_LOG_AT_INFO(...)  LOG_INFO(pnq::logging::default_logger(), __VA_ARGS__)
+#define PNQ_LOG_AT_WARN(...)  LOG_WARNING(pnq::logging::default_logger(), __VA_ARGS__)
+#define PNQ_LOG_AT_ERROR(...) LOG_ERROR(pnq::logging::default_logger(), __VA_ARGS__)
+#define PNQ_LOG_AT_CRITICAL(...) LOG_CRITICAL(pnq::logging::default_logger(), __VA_ARGS__)
 
 #else // spdlog (default)
 
 #include <spdlog/spdlog.h>
 
-#define PNQ_LOG_TRACE(...) spdlog::trace(__VA_ARGS__)
-#define PNQ_LOG_DEBUG(...) spdlog::debug(__VA_ARGS__)
-#define PNQ_LOG_INFO(...)  spdlog::info(__VA_ARGS__)
-#define PNQ_LOG_WARN(...)  spdlog::warn(__VA_ARGS__)
-#define PNQ_LOG_ERROR(...) spdlog::error(__VA_ARGS__)
-#define PNQ_LOG_CRITICAL(...) spdlog::critical(__VA_ARGS__)
+/// Log through the default logger if lvl is enabled; arguments are not evaluated otherwise.
+#define PNQ_LOG_SPDLOG(lvl, ...) \
+    do { \
+        auto* pnq__logger = spdlog::default_logger_raw(); \
+        if (pnq__logger->should_log(lvl)) \
+            pnq__logger->log(lvl, __VA_ARGS__); \
+    } while (0)
+
+// PNQ_LOG_LEVEL_* values are the same as spdlog's
+#define PNQ_LOG_AT_ENABLED(lvl) spdlog::default_logger_raw()->should_log(static_cast<spdlog::level::level_enum>(lvl))
+
+#define PNQ_LOG_AT_TRACE(...) PNQ_LOG_SPDLOG(spdlog::level::trace, __VA_ARGS__)
+#define PNQ_LOG_AT_DEBUG(...) PNQ_LOG_SPDLOG(spdlog::level::debug, __VA_ARGS__)
+#define PNQ_LOG_AT_INFO(...)  PNQ_LOG_SPDLOG(spdlog::level::info, __VA_ARGS__)
+#define PNQ_LOG_AT_WARN(...)  PNQ_LOG_SPDLOG(spdlog::level::warn, __VA_ARGS__)
+#define PNQ_LOG_AT_ERROR(...) PNQ_LOG_SPDLOG(spdlog::level::err, __VA_ARGS__)
+#define PNQ_LOG_AT_CRITICAL(...) PNQ_LOG_SPDLOG(spdlog::level::critical, __VA_ARGS__)
 
 #endif
 
+#ifdef PNQ_USE_BINARY_LOG
+/// Whether a PNQ_LOG_LEVEL_* level is enabled at runtime, in the binary logger or the backend.
+#define PNQ_LOG_ENABLED(lvl) \
+    (pnq::logging::binary::is_active() ? pnq::logging::binary::should_log(lvl) : PNQ_LOG_AT_ENABLED(lvl))
+
+// Binary records while pnq::logging::binary is active, the backend above otherwise
+#define PNQ_LOG_EMIT_TRACE(...) PNQ_LOG_BINARY(PNQ_LOG_LEVEL_TRACE, PNQ_LOG_AT_TRACE, __VA_ARGS__)
+#define PNQ_LOG_EMIT_DEBUG(...) PNQ_LOG_BINARY(PNQ_LOG_LEVEL_DEBUG, PNQ_LOG_AT_DEBUG, __VA_ARGS__)
+#define PNQ_LOG_EMIT_INFO(...)  PNQ_LOG_BINARY(PNQ_LOG_LEVEL_INFO, PNQ_LOG_AT_INFO, __VA_ARGS__)
+#define PNQ_LOG_EMIT_WARN(...)  PNQ_LOG_BINARY(PNQ_LOG_LEVEL_WARN, PNQ_LOG_AT_WARN, __VA_ARGS__)
+#define PNQ_LOG_EMIT_ERROR(...) PNQ_LOG_BINARY(PNQ_LOG_LEVEL_ERROR, PNQ_LOG_AT_ERROR, __VA_ARGS__)
+#define PNQ_LOG_EMIT_CRITICAL(...) PNQ_LOG_BINARY(PNQ_LOG_LEVEL_CRITICAL, PNQ_LOG_AT_CRITICAL, __VA_ARGS__)
+#else
+/// Whether a PNQ_LOG_LEVEL_* level is enabled at runtime.
+#define PNQ_LOG_ENABLED(lvl) PNQ_LOG_AT_ENABLED(lvl)
+
+#define PNQ_LOG_EMIT_TRACE(...) PNQ_LOG_AT_TRACE(__VA_ARGS__)
+#define PNQ_LOG_EMIT_DEBUG(...) PNQ_LOG_AT_DEBUG(__VA_ARGS__)
+#define PNQ_LOG_EMIT_INFO(...)  PNQ_LOG_AT_INFO(__VA_ARGS__)
+#define PNQ_LOG_EMIT_WARN(...)  PNQ_LOG_AT_WARN(__VA_ARGS__)
+#define PNQ_LOG_EMIT_ERROR(...) PNQ_LOG_AT_ERROR(__VA_ARGS__)
+#define PNQ_LOG_EMIT_CRITICAL(...) PNQ_LOG_AT_CRITICAL(__VA_ARGS__)
+#endif
+
+#if PNQ_LOG_ACTIVE_LEVEL <= PNQ_LOG_LEVEL_TRACE
+#define PNQ_LOG_TRACE(...) PNQ_LOG_EMIT_TRACE(__VA_ARGS__)
+#else
+#define PNQ_LOG_TRACE(...) PNQ_LOG_ELIDED(PNQ_LOG_AT_TRACE(__VA_ARGS__))
+#endif
+
+#if PNQ_LOG_ACTIVE_LEVEL <= PNQ_LOG_LEVEL_DEBUG
+#define PNQ_LOG_DEBUG(...) PNQ_LOG_EMIT_DEBUG(__VA_ARGS__)
+#else
+#define PNQ_LOG_DEBUG(...) PNQ_LOG_ELIDED(PNQ_LOG_AT_DEBUG(__VA_ARGS__))
+#endif
+
+#if PNQ_LOG_ACTIVE_LEVEL <= PNQ_LOG_LEVEL_INFO
+#define PNQ_LOG_INFO(...) PNQ_LOG_EMIT_INFO(__VA_ARGS__)
+#else
+#define PNQ_LOG_INFO(...) PNQ_LOG_ELIDED(PNQ_LOG_AT_INFO(__VA_ARGS__))
+#endif
+
+#if PNQ_LOG_ACTIVE_LEVEL <= PNQ_LOG_LEVEL_WARN
+#define PNQ_LOG_WARN(...) PNQ_LOG_EMIT_WARN(__VA_ARGS__)
+#else
+#define PNQ_LOG_WARN(...) PNQ_LOG_ELIDED(PNQ_LOG_AT_WARN(__VA_ARGS__))
+#endif
+
+#if PNQ_LOG_ACTIVE_LEVEL <= PNQ_LOG_LEVEL_ERROR
+#define PNQ_LOG_ERROR(...) PNQ_LOG_EMIT_ERROR(__VA_ARGS__)
+#else
+#define PNQ_LOG_ERROR(...) PNQ_LOG_ELIDED(PNQ_LOG_AT_ERROR(__VA_ARGS__))
+#endif
+
+#if PNQ_LOG_ACTIVE_LEVEL <= PNQ_LOG_LEVEL_CRITICAL
+#define PNQ_LOG_CRITICAL(...) PNQ_LOG_EMIT_CRITICAL(__VA_ARGS__)
+#else
+#define PNQ_LOG_CRITICAL(...) PNQ_LOG_ELIDED(PNQ_LOG_AT_CRITICAL(__VA_ARGS__))
+#endif
+
+/// Rate-limited variants: at most per_second statements per second from this call site.
+/// Usage: PNQ_LOG_ERROR_RATELIMITED(10, "read('{}') failed", filename);
+#define PNQ_LOG_TRACE_RATELIMITED(per_second, ...) \
+    PNQ_LOG_RATELIMITED(PNQ_LOG_LEVEL_TRACE, PNQ_LOG_TRACE, per_second, PNQ_LOG_TRACE(__VA_ARGS__))
+#define PNQ_LOG_DEBUG_RATELIMITED(per_second, ...) \
+    PNQ_LOG_RATELIMITED(PNQ_LOG_LEVEL_DEBUG, PNQ_LOG_DEBUG, per_second, PNQ_LOG_DEBUG(__VA_ARGS__))
+#define PNQ_LOG_INFO_RATELIMITED(per_second, ...) \
+    PNQ_LOG_RATELIMITED(PNQ_LOG_LEVEL_INFO, PNQ_LOG_INFO, per_second, PNQ_LOG_INFO(__VA_ARGS__))
+#define PNQ_LOG_WARN_RATELIMITED(per_second, ...) \
+    PNQ_LOG_RATELIMITED(PNQ_LOG_LEVEL_WARN, PNQ_LOG_WARN, per_second, PNQ_LOG_WARN(__VA_ARGS__))
+#define PNQ_LOG_ERROR_RATELIMITED(per_second, ...) \
+    PNQ_LOG_RATELIMITED(PNQ_LOG_LEVEL_ERROR, PNQ_LOG_ERROR, per_second, PNQ_LOG_ERROR(__VA_ARGS__))
+#define PNQ_LOG_CRITICAL_RATELIMITED(per_second, ...) \
+    PNQ_LOG_RATELIMITED(PNQ_LOG_LEVEL_CRITICAL, PNQ_LOG_CRITICAL, per_second, PNQ_LOG_CRITICAL(__VA_ARGS__))
+
+/// Deduplicated variants: repeats of the last message from this call site are counted, not logged.
+/// Usage: PNQ_LOG_WARN_DEDUPLICATED("syntax error in line {}", line);
+#define PNQ_LOG_TRACE_DEDUPLICATED(...) PNQ_LOG_DEDUPLICATED(PNQ_LOG_LEVEL_TRACE, PNQ_LOG_TRACE, __VA_ARGS__)
+#define PNQ_LOG_DEBUG_DEDUPLICATED(...) PNQ_LOG_DEDUPLICATED(PNQ_LOG_LEVEL_DEBUG, PNQ_LOG_DEBUG, __VA_ARGS__)
+#define PNQ_LOG_INFO_DEDUPLICATED(...) PNQ_LOG_DEDUPLICATED(PNQ_LOG_LEVEL_INFO, PNQ_LOG_INFO, __VA_ARGS__)
+#define PNQ_LOG_WARN_DEDUPLICATED(...) PNQ_LOG_DEDUPLICATED(PNQ_LOG_LEVEL_WARN, PNQ_LOG_WARN, __VA_ARGS__)
+#define PNQ_LOG_ERROR_DEDUPLICATED(...) PNQ_LOG_DEDUPLICATED(PNQ_LOG_LEVEL_ERROR, PNQ_LOG_ERROR, __VA_ARGS__)
+#define PNQ_LOG_CRITICAL_DEDUPLICATED(...) PNQ_LOG_DEDUPLICATED(PNQ_LOG_LEVEL_CRITICAL, PNQ_LOG_CRITICAL, __VA_ARGS__)
+
+// PNQ_LOG_BINARY, which flush_suppressed() expands to
+#ifdef PNQ_USE_BINARY_LOG
+#include <pnq/binary_log.h>
+#endif
+
+namespace pnq::logging
+{
+    /// Report statements that rate-limited and deduplicated call sites suppressed and no later
+    /// statement reported, e.g. because the burst ended. stop_async_logging() calls it; long-running
+    /// programs can also call it from a timer.
+    inline void flush_suppressed()
+    {
+        struct Report
+        {
+            std::uint32_t count;
+            const char* file;
+            std::uint32_t line;
+            int level;
+        };
+
+        // Log outside the lock: a sink may log rate-limited statements itself
+        std::vector<Report> reports;
+        {
+            auto& registry = detail::suppressed_counts();
+            std::lock_guard lock{registry.mutex};
+            for (auto* site : registry.counts)
+            {
+                if (const auto count = site->take_suppressed())
+                    reports.push_back({count, site->file(), site->line(), site->level()});
+            }
+        }
+
+        for (const auto& report : reports)
+        {
+            switch (report.level)
+            {
+            case PNQ_LOG_LEVEL_TRACE:
+                PNQ_LOG_TRACE("{} similar messages were suppressed ({}:{})", report.count, report.file, report.line);
+                break;
+            case PNQ_LOG_LEVEL_DEBUG:
+                PNQ_LOG_DEBUG("{} similar messages were suppressed ({}:{})", report.count, report.file, report.line);
+                break;
+            case PNQ_LOG_LEVEL_INFO:
+                PNQ_LOG_INFO("{} similar messages were suppressed ({}:{})", report.count, report.file, report.line);
+                break;
+            case PNQ_LOG_LEVEL_WARN:
+                PNQ_LOG_WARN("{} similar messages were suppressed ({}:{})", report.count, report.file, report.line);
+                break;
+            case PNQ_LOG_LEVEL_ERROR:
+                PNQ_LOG_ERROR("{} similar messages were suppressed ({}:{})", report.count, report.file, report.line);
+                break;
+            default:
+                PNQ_LOG_CRITICAL("{} similar messages were suppressed ({}:{})", report.count, report.file, report.line);
+                break;
+            }
+        }
+    }
+}
@@ -1,12 +1,19 @@
 #pragma once
 
+#include <cerrno>
+#include <chrono>
 #include <filesystem>
 #include <format>
+#include <mutex>
 #include <string>
+#include <system_error>
 #include <vector>
 
+#include <pnq/platform.h>
 #include <pnq/log.h>
+#ifdef PNQ_PLATFORM_WINDOWS
 #include <pnq/windows_errors.h>
+#endif
 
 #ifdef PNQ_USE_QUILL
 
@@ -29,6 +36,29 @@ namespace pnq::logging
         critical
     };
 
+    /// What an asynchronous logger does when its queue is full.
+    enum class overflow_policy
+    {
+        /// Wait until the writer thread has made room (no message is lost)
+        block,
+
+        /// Discard the new message
+        drop,
+
+        /// Discard the oldest queued message to make room for the new one
+        overrun,
+    };
+
+    /// Options for initialize_async_logging().
+    struct async_options
+    {
+        /// Number of messages the queue holds
+        size_t queue_size{8192};
+
+        /// Behavior when the queue is full
+        overflow_policy overflow{overflow_policy::block};
+    };
+
     namespace detail
     {
         inline quill::LogLevel to_quill_level(level lvl)
@@ -46,10 +76,13 @@ namespace pnq::logging
         }
     }
 
+#ifdef PNQ_PLATFORM_WINDOWS
     /// Log a Windows error with context (simple string message).
     inline void report_windows_error(const char* context, DWORD error_code, std::string_view message)
     {
-        LOG_ERROR(default_logger(), "[{}] {}: {}", context, message,
+        if (!default_logger()->should_log_statement<quill::LogLevel::Error>())
+            return;
+        PNQ_LOG_ERROR("[{}] {}: {}", context, message,
             windows::hresult_as_string(static_cast<HRESULT>(error_code)));
     }
 
@@ -57,9 +90,30 @@ namespace pnq::logging
     template<typename... Args>
     inline void report_windows_error(const char* context, DWORD error_code, std::format_string<Args...> fmt, Args&&... args)
     {
-        LOG_ERROR(default_logger(), "[{}] {}: {}", context, std::format(fmt, std::forward<Args>(args)...),
+        if (!default_logger()->should_log_statement<quill::LogLevel::Error>())
+            return;
+        PNQ_LOG_ERROR("[{}] {}: {}", context, std::format(fmt, std::forward<Args>(args)...),
             windows::hresult_as_string(static_cast<HRESULT>(error_code)));
     }
+#endif
+
+    /// Log a POSIX errno value with context (simple string message).
+    inline void report_errno(const char* context, int error_code, std::string_view message)
+    {
+        if (!default_logger()->should_log_statement<quill::LogLevel::Error>())
+            return;
+        PNQ_LOG_ERROR("[{}] {}: {}", context, message, std::generic_category().message(error_code));
+    }
+
+    /// Log a POSIX errno value with context (format string with arguments).
+    template<typename... Args>
+    inline void report_errno(const char* context, int error_code, std::format_string<Args...> fmt, Args&&... args)
+    {
+        if (!default_logger()->should_log_statement<quill::LogLevel::Error>())
+            return;
+        PNQ_LOG_ERROR("[{}] {}: {}", context, std::format(fmt, std::forward<Args>(args)...),
+            std::generic_category().message(error_code));
+    }
 
     /// Initialize logging with Quill backend.
     /// @param app_name application name for the logger
@@ -96,6 +150,33 @@ namespace pnq::logging
         return logger;
     }
 
+    /// Initialize asynchronous logging.
+    /// Quill always formats and writes on its backend thread; its queue type is chosen at
+    /// compile time through quill::FrontendOptions, so options are ignored here.
+    /// @param app_name application name for the logger
+    /// @param enable_console if true, also log to stdout with colors
+    /// @param options queue options (unused with Quill)
+    /// @return pointer to the configured logger
+    inline quill::Logger* initialize_async_logging(std::string_view app_name, bool enable_console = false, const async_options& options = {})
+    {
+        (void)options;
+        return initialize_logging(app_name, enable_console);
+    }
+
+    /// Report pending suppressed counts (flush_suppressed()) and wait until all queued
+    /// messages have been written. Quill keeps its backend thread, so logging stays asynchronous.
+    inline void stop_async_logging()
+    {
+        flush_suppressed();
+        default_logger()->flush_log();
+    }
+
+    /// Set the runtime level of the default logger; PNQ_LOG_* statements below it skip their arguments.
+    inline void set_level(level lvl)
+    {
+        default_logger()->set_log_level(detail::to_quill_level(lvl));
+    }
+
     /// Add console sink to existing logger.
     inline void enable_console_logging(level lvl = level::info)
     {
@@ -156,9 +237,12 @@ namespace pnq::logging
 #else // spdlog (default)
 
 #include <spdlog/spdlog.h>
+#include <spdlog/async.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/rotating_file_sink.h>
+#ifdef PNQ_PLATFORM_WINDOWS
 #include <spdlog/sinks/msvc_sink.h>
+#endif
 
 namespace pnq::logging
 {
@@ -173,6 +257,29 @@ namespace pnq::logging
         critical
     };
 
+    /// What an asynchronous logger does when its queue is full.
+    enum class overflow_policy
+    {
+        /// Wait until the writer thread has made room (no message is lost)
+        block,
+
+        /// Discard the new message
+        drop,
+
+        /// Discard the oldest queued message to make room for the new one
+        overrun,
+    };
+
+    /// Options for initialize_async_logging().
+    struct async_options
+    {
+        /// Number of messages the queue holds
+        size_t queue_size{8192};
+
+        /// Behavior when the queue is full
+        overflow_policy overflow{overflow_policy::block};
+    };
+
     namespace detail
     {
         inline spdlog::level::level_enum to_spdlog_level(level lvl)
@@ -188,21 +295,104 @@ namespace pnq::logging
             default:              return spdlog::level::info;
             }
         }
+
+        inline spdlog::async_overflow_policy to_spdlog_policy(overflow_policy policy)
+        {
+            switch (policy)
+            {
+            case overflow_policy::block:   return spdlog::async_overflow_policy::block;
+#if SPDLOG_VERSION >= 11200
+            case overflow_policy::drop:    return spdlog::async_overflow_policy::discard_new;
+#else
+            // Older spdlog versions cannot discard new messages; losing the oldest is closest
+            case overflow_policy::drop:    return spdlog::async_overflow_policy::overrun_oldest;
+#endif
+            case overflow_policy::overrun: return spdlog::async_overflow_policy::overrun_oldest;
+            default:                       return spdlog::async_overflow_policy::block;
+            }
+        }
+
+        /// Sinks shared by initialize_logging() and initialize_async_logging().
+        inline std::vector<spdlog::sink_ptr> create_default_sinks(bool enable_console)
+        {
+            std::vector<spdlog::sink_ptr> sinks;
+
+#ifdef PNQ_PLATFORM_WINDOWS
+            auto msvc_sink = std::make_shared<spdlog::sinks::msvc_sink_mt>();
+            msvc_sink->set_level(spdlog::level::warn);
+            sinks.push_back(msvc_sink);
+#endif
+
+            if (enable_console)
+            {
+                auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+                console_sink->set_level(spdlog::level::info);
+                sinks.push_back(console_sink);
+            }
+            return sinks;
+        }
+
+        inline void install_default_logger(const std::shared_ptr<spdlog::logger>& logger)
+        {
+            logger->set_level(spdlog::level::debug);
+
+            spdlog::drop_all();
+            spdlog::set_default_logger(logger);
+        }
+
+        /// Keep a replaced default logger alive until exit. PNQ_LOG_* reaches the default logger
+        /// through spdlog::default_logger_raw(), so other threads may still be inside a call on it.
+        inline void retire_logger(std::shared_ptr<spdlog::logger> logger)
+        {
+            static std::mutex mutex;
+            static std::vector<std::shared_ptr<spdlog::logger>> retired;
+
+            std::lock_guard lock{mutex};
+            retired.push_back(std::move(logger));
+        }
     }
 
+#ifdef PNQ_PLATFORM_WINDOWS
     /// Log a Windows error with context (simple string message).
     inline void report_windows_error(const char* context, DWORD error_code, std::string_view message)
     {
-        spdlog::error("[{}] {}: {}", context, message, windows::hresult_as_string(static_cast<HRESULT>(error_code)));
+        // Skip formatting and the error text lookup if the message would be discarded
+        if (!spdlog::should_log(spdlog::level::err))
+            return;
+        PNQ_LOG_ERROR("[{}] {}: {}", context, message, windows::hresult_as_string(static_cast<HRESULT>(error_code)));
     }
 
     /// Log a Windows error with context (format string with arguments).
     template<typename... Args>
     inline void report_windows_error(const char* context, DWORD error_code, std::format_string<Args...> fmt, Args&&... args)
     {
-        spdlog::error("[{}] {}: {}", context, std::format(fmt, std::forward<Args>(args)...),
+        // Skip formatting and the error text lookup if the message would be discarded
+        if (!spdlog::should_log(spdlog::level::err))
+            return;
+        PNQ_LOG_ERROR("[{}] {}: {}", context, std::format(fmt, std::forward<Args>(args)...),
             windows::hresult_as_string(static_cast<HRESULT>(error_code)));
     }
+#endif
+
+    /// Log a POSIX errno value with context (simple string message).
+    inline void report_errno(const char* context, int error_code, std::string_view message)
+    {
+        // Skip formatting and the error text lookup if the message would be discarded
+        if (!spdlog::should_log(spdlog::level::err))
+            return;
+        PNQ_LOG_ERROR("[{}] {}: {}", context, message, std::generic_category().message(error_code));
+    }
+
+    /// Log a POSIX errno value with context (format string with arguments).
+    template<typename... Args>
+    inline void report_errno(const char* context, int error_code, std::format_string<Args...> fmt, Args&&... args)
+    {
+        // Skip formatting and the error text lookup if the message would be discarded
+        if (!spdlog::should_log(spdlog::level::err))
+            return;
+        PNQ_LOG_ERROR("[{}] {}: {}", context, std::format(fmt, std::forward<Args>(args)...),
+            std::generic_category().message(error_code));
+    }
 
     /// Initialize logging with MSVC debug output sink.
     /// @param app_name application name for the logger
@@ -210,26 +400,60 @@ namespace pnq::logging
     /// @return shared pointer to the configured logger
     inline std::shared_ptr<spdlog::logger> initialize_logging(std::string_view app_name, bool enable_console = false)
     {
-        std::vector<spdlog::sink_ptr> sinks;
+        auto sinks = detail::create_default_sinks(enable_console);
+        auto logger = std::make_shared<spdlog::logger>(std::string(app_name), sinks.begin(), sinks.end());
+        detail::install_default_logger(logger);
+        return logger;
+    }
 
-        auto msvc_sink = std::make_shared<spdlog::sinks::msvc_sink_mt>();
-        msvc_sink->set_level(spdlog::level::warn);
-        sinks.push_back(msvc_sink);
+    /// Initialize asynchronous logging with the same sinks as initialize_logging().
+    /// PNQ_LOG_* calls only queue the message; one writer thread formats it and writes to the sinks.
+    /// Call stop_async_logging() before exit so queued messages are written.
+    /// @param app_name application name for the logger
+    /// @param enable_console if true, also log to stdout with colors
+    /// @param options queue size and overflow policy
+    /// @return shared pointer to the configured logger
+    inline std::shared_ptr<spdlog::logger> initialize_async_logging(std::string_view app_name, bool enable_console = false, const async_options& options = {})
+    {
+        // Replaces the thread pool of any previous async logger, so drop those first
+        spdlog::drop_all();
+        spdlog::init_thread_pool(options.queue_size, 1);
 
-        if (enable_console)
-        {
-            auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
-            console_sink->set_level(spdlog::level::info);
-            sinks.push_back(console_sink);
-        }
+        auto sinks = detail::create_default_sinks(enable_console);
+        auto logger = std::make_shared<spdlog::async_logger>(std::string(app_name), sinks.begin(), sinks.end(),
+            spdlog::thread_pool(), detail::to_spdlog_policy(options.overflow));
+        detail::install_default_logger(logger);
+        return logger;
+    }
 
-        auto logger = std::make_shared<spdlog::logger>(std::string(app_name), sinks.begin(), sinks.end());
-        logger->set_level(spdlog::level::debug);
+    /// Report pending suppressed counts (flush_suppressed()), write all queued messages, stop the
+    /// writer thread and continue logging synchronously to the same sinks. The default logger
+    /// stays as it is if it is synchronous already.
+    /// Threads that are inside PNQ_LOG_* meanwhile don't crash: the async logger stays alive until
+    /// exit, and a message that reaches it after the writer thread is gone goes to spdlog's error
+    /// handler instead of the sinks.
+    inline void stop_async_logging()
+    {
+        flush_suppressed();
 
-        spdlog::drop_all();
+        auto async_logger = std::dynamic_pointer_cast<spdlog::async_logger>(spdlog::default_logger());
+        if (!async_logger)
+            return;
+
+        auto logger = std::make_shared<spdlog::logger>(async_logger->name(), async_logger->sinks().begin(), async_logger->sinks().end());
+        logger->set_level(async_logger->level());
         spdlog::set_default_logger(logger);
+        detail::retire_logger(std::move(async_logger));
 
-        return logger;
+        // Destroying the thread pool drains its queue and joins the writer thread
+        spdlog::details::registry::instance().set_tp(nullptr);
+        logger->flush();
+    }
+
+    /// Set the runtime level of the default logger; PNQ_LOG_* statements below it skip their arguments.
+    inline void set_level(level lvl)
+    {
+        spdlog::default_logger()->set_level(detail::to_spdlog_level(lvl));
     }
 
     /// Add console (stdout) sink to existing logger.
@@ -284,3 +508,26 @@ namespace pnq::logging
 }
 
 #endif
+
+/// Log errno with automatic context. POSIX counterpart of PNQ_LOG_LAST_ERROR.
+/// Preserves errno so callers can still check it after logging.
+/// Usage: PNQ_LOG_ERRNO("open('{}') failed", filename);
+#if PNQ_LOG_ACTIVE_LEVEL <= PNQ_LOG_LEVEL_ERROR
+#define PNQ_LOG_ERRNO(...) \
+    do { \
+        const int pnq__errno = errno; \
+        pnq::logging::report_errno(__func__, pnq__errno, __VA_ARGS__); \
+        errno = pnq__errno; \
+    } while (0)
+#else
+#define PNQ_LOG_ERRNO(...) PNQ_LOG_ELIDED(pnq::logging::report_errno(__func__, 0, __VA_ARGS__))
+#endif
+
+/// Rate-limited PNQ_LOG_ERRNO: at most per_second reports per second from this call site.
+#define PNQ_LOG_ERRNO_RATELIMITED(per_second, ...) \
+    do { \
+        const int pnq__errno_saved = errno; \
+        PNQ_LOG_RATELIMITED(PNQ_LOG_LEVEL_ERROR, PNQ_LOG_ERROR, per_second, \
+            pnq::logging::report_errno(__func__, pnq__errno_saved, __VA_ARGS__)); \
+        errno = pnq__errno_saved; \
+    } while (0)
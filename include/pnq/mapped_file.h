@@ -0,0 +1,282 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <pnq/platform.h>
+#include <pnq/memory_view.h>
+#include <pnq/logging.h>
+
+#ifdef PNQ_PLATFORM_WINDOWS
+#include <pnq/string.h>
+#include <pnq/win32/handle.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef PNQ_PLATFORM_LINUX
+#include <sys/vfs.h>
+#else
+#include <sys/mount.h>
+#endif
+#endif
+
+namespace pnq
+{
+    /// How a MappedFile maps its pages.
+    enum class map_mode
+    {
+        /// Pages are read-only; writing through data() is undefined behavior.
+        read_only,
+
+        /// Pages are private and writable; changes are never written back to the file.
+        copy_on_write,
+    };
+
+    /// Access pattern hints for MappedFile::advise.
+    enum class map_advice
+    {
+        normal,
+        sequential,
+        random,
+        will_need,
+        dont_need,
+    };
+
+    /// Read-only or copy-on-write memory mapping of a whole file.
+    /// Lets consumers work on file contents through a memory_view without copying them into a buffer first.
+    /// An I/O error while touching a mapped page raises EXCEPTION_IN_PAGE_ERROR (Windows) or
+    /// SIGBUS (POSIX) instead of failing a call; see is_local().
+    class MappedFile final
+    {
+    public:
+        MappedFile() = default;
+
+        ~MappedFile()
+        {
+            close();
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        MappedFile(MappedFile &&) = delete;
+        MappedFile &operator=(MappedFile &&) = delete;
+
+        /// Map an existing file.
+        /// Empty files succeed with an empty view (they cannot be mapped).
+        /// @param filename path to file
+        /// @param mode read-only or copy-on-write
+        /// @return true if successful
+        bool open(std::string_view filename, map_mode mode = map_mode::read_only)
+        {
+            close();
+            m_mode = mode;
+
+#ifdef PNQ_PLATFORM_WINDOWS
+            win32::Handle file{::CreateFileW(string::encode_as_utf16(filename).c_str(),
+                GENERIC_READ,
+                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                nullptr,
+                OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL,
+                nullptr)};
+            if (!file.is_valid())
+            {
+                PNQ_LOG_LAST_ERROR("CreateFile('{}') failed", filename);
+                return false;
+            }
+
+            LARGE_INTEGER file_size{0};
+            if (!::GetFileSizeEx(file, &file_size))
+            {
+                PNQ_LOG_LAST_ERROR("GetFileSizeEx('{}') failed", filename);
+                return false;
+            }
+            if (file_size.QuadPart == 0)
+                return true;
+
+            // The view keeps the mapping alive, so neither handle is needed afterwards
+            win32::Handle mapping{::CreateFileMappingW(file,
+                nullptr,
+                mode == map_mode::copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY,
+                0,
+                0,
+                nullptr)};
+            if (!mapping.is_valid())
+            {
+                PNQ_LOG_LAST_ERROR("CreateFileMapping('{}') failed", filename);
+                return false;
+            }
+
+            void *address = ::MapViewOfFile(mapping, mode == map_mode::copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+            if (!address)
+            {
+                PNQ_LOG_LAST_ERROR("MapViewOfFile('{}') failed", filename);
+                return false;
+            }
+            const auto size = static_cast<size_t>(file_size.QuadPart);
+#else
+            const std::string path{filename};
+            const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                PNQ_LOG_ERRNO("open('{}') failed", filename);
+                return false;
+            }
+
+            struct stat st{};
+            if (::fstat(fd, &st) != 0)
+            {
+                PNQ_LOG_ERRNO("fstat('{}') failed", filename);
+                ::close(fd);
+                return false;
+            }
+            if (st.st_size == 0)
+            {
+                ::close(fd);
+                return true;
+            }
+
+            const int protection = mode == map_mode::copy_on_write ? (PROT_READ | PROT_WRITE) : PROT_READ;
+            void *address = ::mmap(nullptr, static_cast<size_t>(st.st_size), protection, MAP_PRIVATE, fd, 0);
+
+            // The mapping keeps its own reference to the file
+            ::close(fd);
+            if (address == MAP_FAILED)
+            {
+                PNQ_LOG_ERRNO("mmap('{}') failed", filename);
+                return false;
+            }
+            const auto size = static_cast<size_t>(st.st_size);
+#endif
+            m_data = static_cast<std::uint8_t *>(address);
+            m_size = size;
+            return true;
+        }
+
+        /// Check if a file lives on a local fixed disk, where mapping it is safe as long as
+        /// nobody truncates it. Network shares and removable media can vanish under a mapping.
+        /// @param filename path to file
+        /// @return true if local; false if not or unknown
+        static bool is_local(std::string_view filename)
+        {
+#ifdef PNQ_PLATFORM_WINDOWS
+            wchar_t volume[MAX_PATH];
+            if (!::GetVolumePathNameW(string::encode_as_utf16(filename).c_str(), volume, MAX_PATH))
+                return false;
+
+            const auto type = ::GetDriveTypeW(volume);
+            return type == DRIVE_FIXED || type == DRIVE_RAMDISK;
+#else
+            const std::string path{filename};
+            struct statfs info{};
+            if (::statfs(path.c_str(), &info) != 0)
+                return false;
+#ifdef PNQ_PLATFORM_LINUX
+            switch (static_cast<unsigned long>(info.f_type))
+            {
+            case 0x6969:     // NFS
+            case 0x517B:     // SMB
+            case 0xFF534D42: // CIFS
+            case 0xFE534D42: // SMB2
+            case 0x65735546: // FUSE
+            case 0x01021997: // 9P
+            case 0x00C36400: // Ceph
+            case 0x5346414F: // AFS
+                return false;
+            default:
+                return true;
+            }
+#else
+            return (info.f_flags & MNT_LOCAL) != 0;
+#endif
+#endif
+        }
+
+        /// Unmap the file.
+        void close()
+        {
+            if (!m_data)
+                return;
+
+#ifdef PNQ_PLATFORM_WINDOWS
+            if (!::UnmapViewOfFile(m_data))
+                PNQ_LOG_LAST_ERROR("UnmapViewOfFile failed");
+#else
+            if (::munmap(m_data, m_size) != 0)
+                PNQ_LOG_ERRNO("munmap failed");
+#endif
+            m_data = nullptr;
+            m_size = 0;
+        }
+
+        /// Check if a non-empty file is mapped.
+        bool is_mapped() const
+        {
+            return m_data != nullptr;
+        }
+
+        /// Get pointer to the mapped bytes (nullptr for empty files).
+        const std::uint8_t *data() const { return m_data; }
+
+        /// Get writable pointer to the mapped bytes; nullptr unless mapped copy-on-write.
+        std::uint8_t *mutable_data() { return m_mode == map_mode::copy_on_write ? m_data : nullptr; }
+
+        /// Get size of the mapping in bytes.
+        size_t size() const { return m_size; }
+
+        /// View the mapped bytes. Valid until close() or destruction.
+        memory_view view() const { return {m_data, m_size}; }
+
+        /// View the mapped bytes as text. Valid until close() or destruction.
+        std::string_view text() const { return {reinterpret_cast<const char *>(m_data), m_size}; }
+
+        /// Hint the expected access pattern for the whole mapping (madvise / PrefetchVirtualMemory).
+        /// Hints without an equivalent on the platform are ignored.
+        /// Note that dont_need drops private copy-on-write changes on POSIX.
+        /// @return true if the hint was accepted or ignored
+        bool advise(map_advice advice) const
+        {
+            if (!m_data)
+                return true;
+
+#ifdef PNQ_PLATFORM_WINDOWS
+            if (advice != map_advice::will_need)
+                return true;
+
+            WIN32_MEMORY_RANGE_ENTRY range{m_data, m_size};
+            if (!::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0))
+            {
+                PNQ_LOG_LAST_ERROR("PrefetchVirtualMemory failed");
+                return false;
+            }
+            return true;
+#else
+            int native = MADV_NORMAL;
+            switch (advice)
+            {
+            case map_advice::normal:     native = MADV_NORMAL; break;
+            case map_advice::sequential: native = MADV_SEQUENTIAL; break;
+            case map_advice::random:     native = MADV_RANDOM; break;
+            case map_advice::will_need:  native = MADV_WILLNEED; break;
+            case map_advice::dont_need:  native = MADV_DONTNEED; break;
+            }
+
+            if (::madvise(m_data, m_size, native) != 0)
+            {
+                PNQ_LOG_ERRNO("madvise failed");
+                return false;
+            }
+            return true;
+#endif
+        }
+
+    private:
+        std::uint8_t *m_data{nullptr};
+        size_t m_size{0};
+        map_mode m_mode{map_mode::read_only};
+    };
+} // namespace pnq
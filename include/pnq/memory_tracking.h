@@ -0,0 +1,234 @@
+#pragma once
+
+/// @file pnq/memory_tracking.h
+/// @brief Allocation counters per thread, per scope and per type.
+///
+/// Built with PNQ_TRACK_ALLOCATIONS, pnq counts the allocations of its own heavy types
+/// (key_entry, value, string::Writer buffers). Everything else is counted once the global
+/// operator new/delete hooks are installed by including <pnq/memory_tracking_hooks.h> in
+/// exactly one source file of the program.
+///
+/// @code
+/// pnq::memory::AllocationScope scope;
+/// parser.parse_text(text);
+/// REQUIRE(scope.stats().allocations <= budget);
+/// REQUIRE(scope.stats(pnq::memory::category::value).allocations == value_count);
+/// @endcode
+///
+/// Counters are kept per thread and are not synchronized: a scope sees the allocations of its
+/// own thread only, and memory freed by another thread is counted there.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#if defined(PNQ_TRACK_ALLOCATIONS) && defined(PNQ_USE_MEMORY_DEBUGGING)
+#error "PNQ_TRACK_ALLOCATIONS and PNQ_USE_MEMORY_DEBUGGING cannot be combined"
+#endif
+
+namespace pnq::memory
+{
+    /// What an allocation was made for.
+    enum class category : std::uint8_t
+    {
+        /// Anything not listed below (only seen with the global hooks installed)
+        other,
+        key_entry,
+        value,
+
+        /// Dynamic buffers of string::Writer
+        writer,
+    };
+
+    inline constexpr size_t category_count = 4;
+
+    /// Allocation counters over some time span.
+    struct Stats
+    {
+        std::uint64_t allocations{0};
+        std::uint64_t deallocations{0};
+        std::uint64_t bytes_allocated{0};
+        std::uint64_t bytes_freed{0};
+
+        /// Highest live byte count, relative to the start of the span (all categories together)
+        std::uint64_t peak_live_bytes{0};
+
+        /// Bytes allocated and not yet freed during the span (negative if more was freed).
+        std::int64_t live_bytes() const
+        {
+            return static_cast<std::int64_t>(bytes_allocated) - static_cast<std::int64_t>(bytes_freed);
+        }
+    };
+
+    namespace detail
+    {
+        struct Counters
+        {
+            std::uint64_t allocations;
+            std::uint64_t deallocations;
+            std::uint64_t bytes_allocated;
+            std::uint64_t bytes_freed;
+        };
+
+        /// Trivial, so it can be used from operator new at any point of a thread's life.
+        struct ThreadState
+        {
+            Counters types[category_count];
+            std::int64_t live;
+            std::int64_t peak;
+        };
+
+        inline thread_local constinit ThreadState t_state{};
+
+        inline void record_allocation(size_t bytes, category type) noexcept
+        {
+            auto& state = t_state;
+            auto& counters = state.types[static_cast<size_t>(type)];
+            ++counters.allocations;
+            counters.bytes_allocated += bytes;
+            state.live += static_cast<std::int64_t>(bytes);
+            if (state.live > state.peak)
+                state.peak = state.live;
+        }
+
+        inline void record_free(size_t bytes, category type) noexcept
+        {
+            auto& state = t_state;
+            auto& counters = state.types[static_cast<size_t>(type)];
+            ++counters.deallocations;
+            counters.bytes_freed += bytes;
+            state.live -= static_cast<std::int64_t>(bytes);
+        }
+
+        inline Stats difference(const Counters& now, const Counters& start)
+        {
+            return {
+                now.allocations - start.allocations,
+                now.deallocations - start.deallocations,
+                now.bytes_allocated - start.bytes_allocated,
+                now.bytes_freed - start.bytes_freed,
+                0,
+            };
+        }
+
+        inline Counters sum(const ThreadState& state)
+        {
+            Counters total{};
+            for (const auto& counters : state.types)
+            {
+                total.allocations += counters.allocations;
+                total.deallocations += counters.deallocations;
+                total.bytes_allocated += counters.bytes_allocated;
+                total.bytes_freed += counters.bytes_freed;
+            }
+            return total;
+        }
+
+        inline bool& hooks_installed_flag()
+        {
+            static bool installed = false;
+            return installed;
+        }
+    }
+
+    /// Check if the global operator new/delete hooks are part of the program.
+    inline bool hooks_installed()
+    {
+        return detail::hooks_installed_flag();
+    }
+
+    /// Allocate memory counted as type (what PNQ_TRACK_ALLOCATIONS_AS classes use).
+    inline void* allocate(size_t size, category type)
+    {
+        void* p = std::malloc(size ? size : 1);
+        if (!p)
+            throw std::bad_alloc{};
+        detail::record_allocation(size, type);
+        return p;
+    }
+
+    /// Free memory from allocate().
+    inline void deallocate(void* p, size_t size, category type) noexcept
+    {
+        if (!p)
+            return;
+        detail::record_free(size, type);
+        std::free(p);
+    }
+
+    /// Counters of the calling thread since it started.
+    inline Stats thread_stats()
+    {
+        const auto& state = detail::t_state;
+        auto result = detail::difference(detail::sum(state), {});
+        result.peak_live_bytes = state.peak > 0 ? static_cast<std::uint64_t>(state.peak) : 0;
+        return result;
+    }
+
+    /// Counts the allocations of the calling thread from construction on. Scopes can be nested.
+    class AllocationScope final
+    {
+    public:
+        AllocationScope() noexcept
+            : m_start{detail::t_state},
+              m_outer_peak{detail::t_state.peak}
+        {
+            // Measure the peak of this scope; the destructor merges it back
+            detail::t_state.peak = detail::t_state.live;
+        }
+
+        ~AllocationScope()
+        {
+            if (m_outer_peak > detail::t_state.peak)
+                detail::t_state.peak = m_outer_peak;
+        }
+
+        AllocationScope(const AllocationScope&) = delete;
+        AllocationScope& operator=(const AllocationScope&) = delete;
+        AllocationScope(AllocationScope&&) = delete;
+        AllocationScope& operator=(AllocationScope&&) = delete;
+
+        /// Counters of all categories since construction.
+        Stats stats() const
+        {
+            auto result = detail::difference(detail::sum(detail::t_state), detail::sum(m_start));
+            result.peak_live_bytes = peak();
+            return result;
+        }
+
+        /// Counters of one category since construction.
+        Stats stats(category type) const
+        {
+            const auto index = static_cast<size_t>(type);
+            auto result = detail::difference(detail::t_state.types[index], m_start.types[index]);
+            result.peak_live_bytes = peak();
+            return result;
+        }
+
+    private:
+        std::uint64_t peak() const
+        {
+            const auto peak = detail::t_state.peak - m_start.live;
+            return peak > 0 ? static_cast<std::uint64_t>(peak) : 0;
+        }
+
+        const detail::ThreadState m_start;
+        const std::int64_t m_outer_peak;
+    };
+}
+
+#ifdef PNQ_TRACK_ALLOCATIONS
+/// Inside a class: allocate instances through pnq::memory::allocate() as type.
+#define PNQ_TRACK_ALLOCATIONS_AS(type) \
+    static void* operator new(std::size_t size) { return ::pnq::memory::allocate(size, type); } \
+    static void operator delete(void* p, std::size_t size) noexcept { ::pnq::memory::deallocate(p, size, type); }
+
+/// Count memory that a class manages itself (e.g. with malloc/realloc).
+#define PNQ_TRACK_ALLOCATION(type, bytes) ::pnq::memory::detail::record_allocation(bytes, type)
+#define PNQ_TRACK_FREE(type, bytes) ::pnq::memory::detail::record_free(bytes, type)
+#else
+#define PNQ_TRACK_ALLOCATIONS_AS(type)
+#define PNQ_TRACK_ALLOCATION(type, bytes) ((void)0)
+#define PNQ_TRACK_FREE(type, bytes) ((void)0)
+#endif
@@ -0,0 +1,131 @@
+#pragma once
+
+/// @file pnq/memory_tracking_hooks.h
+/// @brief Global operator new/delete that feed pnq::memory's counters.
+///
+/// Include in exactly ONE source file of a program built with PNQ_TRACK_ALLOCATIONS; without
+/// it, this header is empty. The replacements allocate with malloc and count the usable size
+/// of each block, so allocation and free always agree on the byte count.
+
+#include <pnq/memory_tracking.h>
+
+#ifdef PNQ_TRACK_ALLOCATIONS
+
+#if defined(_WIN32)
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+namespace pnq::memory::detail
+{
+    inline size_t usable_size(void* p, size_t alignment) noexcept
+    {
+#if defined(_WIN32)
+        return alignment ? _aligned_msize(p, alignment, 0) : _msize(p);
+#elif defined(__APPLE__)
+        (void)alignment;
+        return malloc_size(p);
+#else
+        (void)alignment;
+        return malloc_usable_size(p);
+#endif
+    }
+
+    inline void* hook_allocate(size_t size, size_t alignment = 0) noexcept
+    {
+        if (!size)
+            size = 1;
+#if defined(_WIN32)
+        void* p = alignment ? _aligned_malloc(size, alignment) : std::malloc(size);
+#else
+        void* p = alignment ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment) : std::malloc(size);
+#endif
+        if (p)
+            record_allocation(usable_size(p, alignment), category::other);
+        return p;
+    }
+
+    inline void hook_free(void* p, size_t alignment = 0) noexcept
+    {
+        if (!p)
+            return;
+        record_free(usable_size(p, alignment), category::other);
+#if defined(_WIN32)
+        if (alignment)
+        {
+            _aligned_free(p);
+            return;
+        }
+#endif
+        std::free(p);
+    }
+
+    inline void* hook_allocate_or_throw(size_t size, size_t alignment = 0)
+    {
+        void* p = hook_allocate(size, alignment);
+        if (!p)
+            throw std::bad_alloc{};
+        return p;
+    }
+
+    inline const bool hooks_registered = (hooks_installed_flag() = true);
+}
+
+void* operator new(std::size_t size) { return pnq::memory::detail::hook_allocate_or_throw(size); }
+void* operator new[](std::size_t size) { return pnq::memory::detail::hook_allocate_or_throw(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return pnq::memory::detail::hook_allocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return pnq::memory::detail::hook_allocate(size); }
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return pnq::memory::detail::hook_allocate_or_throw(size, static_cast<size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return pnq::memory::detail::hook_allocate_or_throw(size, static_cast<size_t>(alignment));
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return pnq::memory::detail::hook_allocate(size, static_cast<size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return pnq::memory::detail::hook_allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept { pnq::memory::detail::hook_free(p); }
+void operator delete[](void* p) noexcept { pnq::memory::detail::hook_free(p); }
+void operator delete(void* p, std::size_t) noexcept { pnq::memory::detail::hook_free(p); }
+void operator delete[](void* p, std::size_t) noexcept { pnq::memory::detail::hook_free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { pnq::memory::detail::hook_free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { pnq::memory::detail::hook_free(p); }
+
+void operator delete(void* p, std::align_val_t alignment) noexcept
+{
+    pnq::memory::detail::hook_free(p, static_cast<size_t>(alignment));
+}
+void operator delete[](void* p, std::align_val_t alignment) noexcept
+{
+    pnq::memory::detail::hook_free(p, static_cast<size_t>(alignment));
+}
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+    pnq::memory::detail::hook_free(p, static_cast<size_t>(alignment));
+}
+void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+    pnq::memory::detail::hook_free(p, static_cast<size_t>(alignment));
+}
+void operator delete(void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    pnq::memory::detail::hook_free(p, static_cast<size_t>(alignment));
+}
+void operator delete[](void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    pnq::memory::detail::hook_free(p, static_cast<size_t>(alignment));
+}
+
+#endif // PNQ_TRACK_ALLOCATIONS
@@ -1,5 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -60,39 +67,358 @@ namespace pnq
             };
         }
 
-        /// Normalize a path pattern with variable substitution.
-        /// Expands %VAR% patterns using provided vars, builtins (CD, APPDIR, WINDIR, SYSDIR),
-        /// and environment variables (in that priority order).
-        /// Also normalizes path separators to platform native (backslash on Windows, forward slash elsewhere).
-        /// @param path_pattern path to normalize
-        /// @param vars variable map for substitution (highest priority)
-        /// @return normalized path with variables expanded
-        inline std::string normalize(std::string_view path_pattern, const std::unordered_map<std::string, std::string> &vars)
+        /// Single-pass path normalizer.
+        ///
+        /// Expands %VAR% patterns (provided vars, then the builtins CD, APPDIR, WINDIR and SYSDIR,
+        /// then environment variables), converts separators to the platform separator, collapses
+        /// duplicate separators and resolves "." and ".." while copying the input once.
+        /// ".." never removes the root ("C:\\", "C:", a leading separator, or UNC "\\\\server\\share");
+        /// leading ".." components of relative paths are kept. A trailing separator is dropped
+        /// ("C:\\dir\\" becomes "C:\\dir") unless it is part of the root ("C:\\" stays "C:\\").
+        /// A path that cancels out completely ("a\\..") is the current directory ".".
+        /// Drive-relative paths stay relative ("C:a\\..\\b" becomes "C:b"), but a component appended
+        /// to a bare drive starts at its root (appending "dir" to "C:" gives "C:\\dir").
+        /// Text after a "\\\\?\\" or "\\\\.\\" prefix is copied verbatim: Windows does not parse those paths.
+        /// The result lives in an inline buffer (or one passed by the caller) and only moves to the
+        /// heap if it does not fit.
+        class Normalizer final
         {
-            // Merge user vars with builtins (user vars take priority)
-            auto merged = get_builtin_vars();
-            for (const auto &[k, v] : vars)
+        public:
+            Normalizer() = default;
+
+            /// @param vars variable map for substitution (highest priority); must outlive the normalizer
+            explicit Normalizer(const std::unordered_map<std::string, std::string> &vars)
+                : m_vars{&vars}
             {
-                merged[k] = v;
             }
 
-            // Expand variables
-            std::string result = string::Expander{merged, true}.expand(path_pattern);
+            /// Write into a caller-supplied buffer instead of the inline one.
+            /// @param buffer initial storage; must outlive the normalizer
+            /// @param vars optional variable map for substitution
+            explicit Normalizer(std::span<char> buffer, const std::unordered_map<std::string, std::string> *vars = nullptr)
+                : m_data{buffer.data()},
+                  m_capacity{buffer.size()},
+                  m_vars{vars}
+            {
+            }
+
+            PNQ_DECLARE_NON_COPYABLE(Normalizer)
+
+            /// Append a path component; it is joined to the path so far with a separator.
+            /// @return reference to this for chaining
+            Normalizer &append(std::string_view component)
+            {
+                const char *text{component.data()};
+                const char *end{text + component.size()};
+                const char *literal{text};
+
+                while (text < end)
+                {
+                    if (*text != '%')
+                    {
+                        ++text;
+                        continue;
+                    }
+                    feed({literal, text});
+                    text = expand(text + 1, end);
+                    literal = text;
+                }
+                feed({literal, end});
+
+                if (!m_verbatim)
+                    finish_segment();
+                m_separator_pending = !m_leading;
+                return *this;
+            }
+
+            /// View the normalized path. Valid until the next append(), clear() or destruction.
+            std::string_view view() const
+            {
+                // Everything cancelled out ("a\..") - that is still the current directory
+                if (m_size == 0 && m_consumed)
+                    return ".";
+                return {m_data, m_size};
+            }
+
+            /// Get the normalized path as a string.
+            std::string str() const
+            {
+                return std::string{view()};
+            }
+
+            /// Start over with an empty path, keeping the buffer.
+            void clear()
+            {
+                m_size = 0;
+                m_root = 0;
+                m_segment_start = 0;
+                m_unc_segments = 0;
+                m_leading = true;
+                m_separator_pending = false;
+                m_consumed = false;
+                m_verbatim = false;
+                m_previous = 0;
+            }
+
+        private:
+            static constexpr size_t inline_capacity = 260;
+
+            static bool is_separator(char c)
+            {
+                return c == '\\' || c == '/';
+            }
+
+            /// Process literal text (no variable expansion).
+            void feed(std::string_view text)
+            {
+                for (const char c : text)
+                {
+                    m_consumed = true;
+                    if (m_verbatim)
+                        on_verbatim(c);
+                    else if (is_separator(c))
+                        on_separator();
+                    else
+                        on_char(c);
+                    m_previous = c;
+                }
+            }
+
+            void on_separator()
+            {
+                // Up to two leading separators form the root (\\server\share or \dir)
+                if (m_leading)
+                {
+                    if (m_size < 2)
+                    {
+                        push(separator());
+                        m_root = m_size;
+                        m_segment_start = m_size;
+                    }
+                    return;
+                }
+                // "C:" directly followed by a separator is the root of an absolute path: keep the separator
+                if (m_size == 2 && m_root == 2 && m_previous == ':')
+                {
+                    push(separator());
+                    m_root = m_size;
+                    m_segment_start = m_size;
+                    return;
+                }
+                // "\\?\" and "\\.\" prefixes: the rest is passed to the system unparsed
+                if (m_unc_segments == 2 && m_size == 3 && (m_data[2] == '?' || m_data[2] == '.'))
+                {
+                    push(separator());
+                    m_root = m_size;
+                    m_verbatim = true;
+                    return;
+                }
+                finish_segment();
+                // Back at a drive-relative root ("C:a\.."): the next segment follows "C:" directly
+                m_separator_pending = !(m_size == m_root && m_root == 2 && m_data[1] == ':');
+            }
+
+            void on_verbatim(char c)
+            {
+                if (m_separator_pending)
+                {
+                    m_separator_pending = false;
+                    if (!is_separator(m_data[m_size - 1]))
+                        push(separator());
+                }
+                push(c);
+            }
+
+            void on_char(char c)
+            {
+                if (m_leading)
+                {
+                    m_leading = false;
+                    if (m_size == 2)
+                        m_unc_segments = 2;
+                    m_segment_start = m_size;
+                }
+                if (m_separator_pending)
+                {
+                    m_separator_pending = false;
+                    if (m_size && m_data[m_size - 1] != separator())
+                        push(separator());
+                    m_segment_start = m_size;
+                }
+                push(c);
+
+                // A drive letter is a root of its own, also when the path goes on without a separator ("C:dir")
+                if (c == ':' && m_size == 2 && m_root == 0 && is_drive_letter(m_data[0]))
+                {
+                    m_root = m_size;
+                    m_segment_start = m_size;
+                }
+            }
+
+            static bool is_drive_letter(char c)
+            {
+                return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+            }
+
+            /// Resolve the segment just completed: drop ".", apply "..", track the root.
+            void finish_segment()
+            {
+                const std::string_view segment{m_data + m_segment_start, m_size - m_segment_start};
+                if (segment.empty())
+                    return;
+
+                // Previous segment, between the root and the separator before this one
+                size_t previous_end = m_segment_start;
+                if (previous_end > m_root && m_data[previous_end - 1] == separator())
+                    --previous_end;
+                size_t previous_start = previous_end;
+                while (previous_start > m_root && m_data[previous_start - 1] != separator())
+                    --previous_start;
+                const std::string_view previous{m_data + previous_start, previous_end - previous_start};
+
+                if (segment == ".")
+                {
+                    m_size = previous_end;
+                }
+                else if (segment == "..")
+                {
+                    // Nothing to go up to in a relative path (including "C:dir"): keep it
+                    const bool relative = m_root == 0 || m_data[m_root - 1] == ':';
+                    if (previous.empty() ? relative : previous == "..")
+                    {
+                        m_segment_start = m_size;
+                        return;
+                    }
+
+                    m_size = previous_start;
+                    if (m_size > m_root && m_data[m_size - 1] == separator())
+                        --m_size;
+                }
+                else if (m_unc_segments)
+                {
+                    --m_unc_segments;
+                    m_root = m_size;
+                }
+                m_segment_start = m_size;
+            }
+
+            /// Expand a %VAR% pattern; text points after the opening %.
+            /// @return pointer to next character after the pattern
+            const char *expand(const char *text, const char *end)
+            {
+                if (text >= end)
+                {
+                    feed("%");
+                    return text;
+                }
+
+                // %% escape sequence
+                if (*text == '%')
+                {
+                    feed("%");
+                    return text + 1;
+                }
+
+                // Variable names don't span lines
+                const char *name_start{text};
+                while (text < end && *text != '%' && *text != '\n' && *text != '\r')
+                    ++text;
+
+                if (text >= end || *text != '%')
+                {
+                    feed("%");
+                    return name_start;
+                }
+
+                const std::string_view name{name_start, text};
+                std::string value;
+                if (lookup(name, value))
+                {
+                    feed(value);
+                }
+                else
+                {
+                    feed("%");
+                    feed(name);
+                    feed("%");
+                }
+                return text + 1;
+            }
+
+            /// Look up a variable; builtins are only evaluated when referenced.
+            bool lookup(std::string_view name, std::string &value) const
+            {
+                if (m_vars)
+                {
+                    const auto item{m_vars->find(std::string{name})};
+                    if (item != m_vars->end())
+                    {
+                        value = item->second;
+                        return true;
+                    }
+                }
+
+                if (name == "CD")
+                    value = directory::current();
+                else if (name == "APPDIR")
+                    value = directory::application();
+                else if (name == "WINDIR")
+                    value = directory::windows();
+                else if (name == "SYSDIR")
+                    value = directory::system();
+                else
+                    return environment_variables::get(name, value);
+                return true;
+            }
 
-            // Normalize path separators to platform native
-            for (char &c : result)
+            void push(char c)
             {
-                if (c == other_separator())
-                    c = separator();
+                if (m_size == m_capacity)
+                {
+                    const size_t capacity = m_capacity ? 2 * m_capacity : inline_capacity;
+                    auto heap = std::make_unique<char[]>(capacity);
+                    std::memcpy(heap.get(), m_data, m_size);
+                    m_heap = std::move(heap);
+                    m_data = m_heap.get();
+                    m_capacity = capacity;
+                }
+                m_data[m_size++] = c;
             }
 
-            return result;
+            char m_inline[inline_capacity];
+            char *m_data{m_inline};
+            size_t m_capacity{inline_capacity};
+            std::unique_ptr<char[]> m_heap;
+            const std::unordered_map<std::string, std::string> *m_vars{nullptr};
+            size_t m_size{0};
+            size_t m_root{0};
+            size_t m_segment_start{0};
+            int m_unc_segments{0};
+            bool m_leading{true};
+            bool m_separator_pending{false};
+            bool m_consumed{false};
+            bool m_verbatim{false};
+            char m_previous{0};
+        };
+
+        /// Normalize a path pattern with variable substitution.
+        /// Expands %VAR% patterns using provided vars, builtins (CD, APPDIR, WINDIR, SYSDIR),
+        /// and environment variables (in that priority order).
+        /// Also normalizes path separators to platform native (backslash on Windows, forward slash elsewhere),
+        /// collapses duplicate separators, drops a trailing separator unless it belongs to the root
+        /// and resolves "." and ".." (see Normalizer).
+        /// @param path_pattern path to normalize
+        /// @param vars variable map for substitution (highest priority)
+        /// @return normalized path with variables expanded
+        inline std::string normalize(std::string_view path_pattern, const std::unordered_map<std::string, std::string> &vars)
+        {
+            return Normalizer{vars}.append(path_pattern).str();
         }
 
         /// Normalize a path pattern using builtins and environment variables.
         inline std::string normalize(std::string_view path_pattern)
         {
-            return normalize(path_pattern, {});
+            return Normalizer{}.append(path_pattern).str();
         }
 
         /// Helper class for combining path components.
@@ -105,33 +431,19 @@ namespace pnq
             /// Add a path component, handling ".." navigation.
             void push_component(std::string_view component)
             {
-                const auto normalized_component{path::normalize(component)};
-                for (const auto &subcomponent : string::split(normalized_component, path::separator_string()))
-                {
-                    if (subcomponent == "..")
-                    {
-                        if (!m_components.empty())
-                        {
-                            m_components.pop_back();
-                        }
-                    }
-                    else
-                    {
-                        m_components.push_back(subcomponent);
-                    }
-                }
+                m_normalizer.append(component);
             }
 
             /// Get the combined path as a string.
             auto as_string() const
             {
-                return string::join(m_components, path::separator_string());
+                return m_normalizer.str();
             }
 
         private:
             PNQ_DECLARE_NON_COPYABLE(PathCombiner)
 
-            std::vector<std::string> m_components;
+            Normalizer m_normalizer;
         };
 
         inline void combine_internal_do_not_use_directly(PathCombiner &)
@@ -266,6 +578,243 @@ namespace pnq
             return find_filename(name, result, true);
         }
 
+        /// Cached replacement for find_filename / find_executable when many names are resolved.
+        ///
+        /// The search directories (application, current, system and Windows directory, then PATH)
+        /// are listed once into a case-insensitive name index, so a lookup is one hash probe per
+        /// PATHEXT candidate instead of one GetFileAttributes call per directory and candidate.
+        /// Directories whose last-write time changed are listed again, checked at most once per
+        /// revalidation interval. The directory list itself (including PATH, PATHEXT and the
+        /// current directory) is captured by the constructor and by refresh().
+        /// The order matches find_filename, except that a bare name is not tried relative to the
+        /// current directory before everything else: the application directory always wins, so a
+        /// file planted in the current directory can't shadow one shipped with the application.
+        /// Names with a directory part are passed on to find_filename. Thread-safe.
+        class PathResolver final
+        {
+        public:
+            /// @param revalidate_interval minimum time between directory time stamp checks (0 = every lookup)
+            explicit PathResolver(std::chrono::milliseconds revalidate_interval = std::chrono::seconds{2})
+                : m_revalidate_interval{revalidate_interval}
+            {
+                refresh();
+            }
+
+            PNQ_DECLARE_NON_COPYABLE(PathResolver)
+
+            /// Search for a file in standard locations and PATH (see path::find_filename).
+            /// @param name filename to find
+            /// @param result receives the full path if found
+            /// @param is_executable if true, try PATHEXT extensions
+            /// @return true if found
+            bool find_filename(std::string_view name, std::string &result, bool is_executable)
+            {
+                if (name.find_first_of("\\/:") != std::string_view::npos)
+                    return path::find_filename(name, result, is_executable);
+
+                std::lock_guard lock{m_mutex};
+
+                const auto now = std::chrono::steady_clock::now();
+                if (now - m_last_validated >= m_revalidate_interval)
+                {
+                    revalidate_locked();
+                    m_last_validated = now;
+                }
+
+                uint32_t best = UINT32_MAX;
+                std::string best_name;
+                const auto probe = [&](std::string_view candidate)
+                {
+                    const auto it = m_index.find(candidate);
+                    if (it != m_index.end() && it->second < best)
+                    {
+                        best = it->second;
+                        best_name = candidate;
+                    }
+                };
+
+                probe(name);
+                if (is_executable)
+                {
+                    for (const auto &extension : m_extensions)
+                        probe(change_extension(name, extension));
+                }
+
+                if (best == UINT32_MAX)
+                    return false;
+
+                result = m_directories[best].path;
+                result += separator();
+                result += best_name;
+                return true;
+            }
+
+            /// Search for an executable in standard locations and PATH.
+            /// Adds .exe extension if none provided.
+            bool find_executable(std::string_view name, std::string &result)
+            {
+                if (file::get_extension(name).empty())
+                {
+                    std::string combined_filename{name};
+                    combined_filename += ".exe";
+                    return find_filename(combined_filename, result, true);
+                }
+                return find_filename(name, result, true);
+            }
+
+            /// Re-read PATH, PATHEXT and the standard directories and list all of them again.
+            void refresh()
+            {
+                std::lock_guard lock{m_mutex};
+
+                std::vector<std::string> candidates{directory::application(), directory::current(), directory::system(), directory::windows()};
+                std::string path;
+                if (environment_variables::get("PATH", path))
+                {
+                    for (const auto &path_element : string::split(path, ";"))
+                        candidates.push_back(path_element);
+                }
+                else
+                {
+                    PNQ_LOG_ERROR("Didn't get the PATH variable");
+                }
+
+                std::string pathext{".EXE;.BAT;.CMD"};
+                environment_variables::get("PATHEXT", pathext);
+                m_extensions = string::split(pathext, ";");
+
+                m_directories.clear();
+                for (const auto &candidate : candidates)
+                {
+                    if (candidate.empty())
+                        continue;
+
+                    auto normalized = combine(candidate);
+                    const auto duplicate = std::find_if(m_directories.begin(), m_directories.end(),
+                        [&](const Directory &d) { return string::equals_nocase(d.path, normalized); });
+                    if (duplicate != m_directories.end())
+                        continue;
+
+                    auto &entry = m_directories.emplace_back();
+                    entry.path = std::move(normalized);
+                    list_directory(entry);
+                }
+
+                rebuild_index();
+                m_last_validated = std::chrono::steady_clock::now();
+            }
+
+            /// List directories whose last-write time changed since they were last listed.
+            void revalidate()
+            {
+                std::lock_guard lock{m_mutex};
+                revalidate_locked();
+                m_last_validated = std::chrono::steady_clock::now();
+            }
+
+            /// Set the minimum time between directory time stamp checks (0 = every lookup).
+            void set_revalidate_interval(std::chrono::milliseconds interval)
+            {
+                std::lock_guard lock{m_mutex};
+                m_revalidate_interval = interval;
+            }
+
+            /// Get the number of distinct names in the index.
+            size_t size() const
+            {
+                std::lock_guard lock{m_mutex};
+                return m_index.size();
+            }
+
+        private:
+            struct Directory
+            {
+                std::string path;
+                std::vector<std::string> names;
+                FILETIME last_write{};
+                bool exists{false};
+            };
+
+            static bool get_last_write(const std::string &directory, FILETIME &last_write)
+            {
+                WIN32_FILE_ATTRIBUTE_DATA data{};
+                if (!::GetFileAttributesExW(string::encode_as_utf16(directory).c_str(), GetFileExInfoStandard, &data))
+                    return false;
+                last_write = data.ftLastWriteTime;
+                return true;
+            }
+
+            static void list_directory(Directory &directory)
+            {
+                directory.names.clear();
+
+                // Take the time stamp first, so changes made while listing trigger another listing
+                directory.exists = get_last_write(directory.path, directory.last_write);
+                if (!directory.exists)
+                    return;
+
+                WIN32_FIND_DATAW data;
+                const auto pattern = string::encode_as_utf16(directory.path + separator_string() + "*");
+                const auto handle = ::FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+                if (handle == INVALID_HANDLE_VALUE)
+                {
+                    if (GetLastError() != ERROR_FILE_NOT_FOUND && GetLastError() != ERROR_PATH_NOT_FOUND)
+                        PNQ_LOG_LAST_ERROR("FindFirstFileExW('{}') failed", directory.path);
+                    return;
+                }
+
+                do
+                {
+                    if (wcscmp(data.cFileName, L".") == 0 || wcscmp(data.cFileName, L"..") == 0)
+                        continue;
+                    directory.names.push_back(string::encode_as_utf8(data.cFileName));
+                } while (::FindNextFileW(handle, &data));
+
+                ::FindClose(handle);
+            }
+
+            void revalidate_locked()
+            {
+                bool changed = false;
+                for (auto &directory : m_directories)
+                {
+                    FILETIME last_write{};
+                    const bool exists = get_last_write(directory.path, last_write);
+                    if (exists == directory.exists && ::CompareFileTime(&last_write, &directory.last_write) == 0)
+                        continue;
+
+                    list_directory(directory);
+                    changed = true;
+                }
+
+                if (changed)
+                    rebuild_index();
+            }
+
+            /// Map each name to the first directory that contains it.
+            void rebuild_index()
+            {
+                size_t total = 0;
+                for (const auto &directory : m_directories)
+                    total += directory.names.size();
+
+                m_index.clear();
+                m_index.reserve(total);
+                for (uint32_t i = 0; i < m_directories.size(); ++i)
+                {
+                    for (const auto &name : m_directories[i].names)
+                        m_index.try_emplace(name, i);
+                }
+            }
+
+            std::vector<Directory> m_directories;
+            std::vector<std::string> m_extensions;
+            std::unordered_map<std::string_view, uint32_t, string::nocase_hash, string::nocase_equal> m_index;
+            std::chrono::milliseconds m_revalidate_interval;
+            std::chrono::steady_clock::time_point m_last_validated;
+            mutable std::mutex m_mutex;
+        };
+
         /// Get a known folder path by FOLDERID.
         /// @param folder_id KNOWNFOLDERID (e.g. FOLDERID_RoamingAppData, FOLDERID_LocalAppData)
         /// @return path to the known folder, or empty path on failure
@@ -35,6 +35,9 @@
 #include <unordered_set>
 #include <vector>
 
+// PNQ_LOG_ACTIVE_LEVEL for the error logging macros below
+#include <pnq/log.h>
+
 #ifdef PNQ_USE_MEMORY_DEBUGGING
 #define PNQ_NEW new ( _NORMAL_BLOCK , __FILE__ , __LINE__ ) 
 #else
@@ -51,18 +54,37 @@
 
 /// Log a Windows error with automatic context. Accepts format string with arguments.
 /// Usage: PNQ_LOG_WIN_ERROR(GetLastError(), "CreateFile('{}') failed", filename);
+#if PNQ_LOG_ACTIVE_LEVEL <= PNQ_LOG_LEVEL_ERROR
 #define PNQ_LOG_WIN_ERROR(error_code, ...) \
     pnq::logging::report_windows_error(PNQ_FUNCTION_CONTEXT, error_code, __VA_ARGS__)
+#else
+#define PNQ_LOG_WIN_ERROR(error_code, ...) \
+    PNQ_LOG_ELIDED(pnq::logging::report_windows_error(PNQ_FUNCTION_CONTEXT, error_code, __VA_ARGS__))
+#endif
 
 /// Log GetLastError() with automatic context. Most common case.
 /// Preserves the error code so callers can still check GetLastError() after logging.
 /// Usage: PNQ_LOG_LAST_ERROR("CreateFile('{}') failed", filename);
+#if PNQ_LOG_ACTIVE_LEVEL <= PNQ_LOG_LEVEL_ERROR
 #define PNQ_LOG_LAST_ERROR(...) \
     do { \
         DWORD pnq__last_error = GetLastError(); \
         pnq::logging::report_windows_error(PNQ_FUNCTION_CONTEXT, pnq__last_error, __VA_ARGS__); \
         SetLastError(pnq__last_error); \
     } while (0)
+#else
+#define PNQ_LOG_LAST_ERROR(...) \
+    PNQ_LOG_ELIDED(pnq::logging::report_windows_error(PNQ_FUNCTION_CONTEXT, 0, __VA_ARGS__))
+#endif
+
+/// Rate-limited PNQ_LOG_LAST_ERROR: at most per_second reports per second from this call site.
+#define PNQ_LOG_LAST_ERROR_RATELIMITED(per_second, ...) \
+    do { \
+        DWORD pnq__last_error_saved = GetLastError(); \
+        PNQ_LOG_RATELIMITED(PNQ_LOG_LEVEL_ERROR, PNQ_LOG_ERROR, per_second, \
+            pnq::logging::report_windows_error(PNQ_FUNCTION_CONTEXT, pnq__last_error_saved, __VA_ARGS__)); \
+        SetLastError(pnq__last_error_saved); \
+    } while (0)
 
 /// This macro can be used on classes that should not enable a copy / move constructor / assignment operator
 #define PNQ_DECLARE_NON_COPYABLE(__CLASSNAME__) \
@@ -84,17 +106,24 @@ namespace pnq
 
 #include <pnq/app_init.h>
 #include <pnq/binary_file.h>
+#include <pnq/bounded_queue.h>
+#include <pnq/mapped_file.h>
 #include <pnq/console.h>
+#include <pnq/console_queue.h>
 #include <pnq/directory.h>
 #include <pnq/ref_counted.h>
 #include <pnq/environment_variables.h>
 #include <pnq/file.h>
+#include <pnq/memory_tracking.h>
 #include <pnq/memory_view.h>
 #include <pnq/path.h>
+#include <pnq/profile.h>
 #include <pnq/string.h>
 #include <pnq/string_expander.h>
 #include <pnq/string_writer.h>
+#include <pnq/sync.h>
 #include <pnq/text_file.h>
+#include <pnq/thread_pool.h>
 #include <pnq/version.h>
 #include <pnq/windows_errors.h>
 #include <pnq/wstring.h>
@@ -0,0 +1,396 @@
+#pragma once
+
+/// @file pnq/profile.h
+/// @brief Scoped profiling zones, exported as Chrome trace JSON.
+///
+/// Zones are only compiled in with PNQ_ENABLE_PROFILING; otherwise PNQ_PROFILE_ZONE expands
+/// to nothing. Even then, zones record nothing until profile::start() is called:
+///
+/// @code
+/// void import(std::string_view filename)
+/// {
+///     PNQ_PROFILE_ZONE("import");
+///     ...
+/// }
+///
+/// pnq::profile::start();
+/// import("big.reg");
+/// pnq::profile::write_chrome_trace("import.json");    // open in chrome://tracing or ui.perfetto.dev
+/// @endcode
+///
+/// Time comes from the TSC on x86/x64 (define PNQ_PROFILE_STEADY_CLOCK to use std::chrono
+/// instead); ticks are converted to microseconds only on export.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if !defined(PNQ_PROFILE_STEADY_CLOCK) && (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__))
+#define PNQ_PROFILE_USE_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+#include <pnq/log.h>
+
+namespace pnq::profile
+{
+    /// Read the profiling clock (unit depends on the platform; see ticks_per_microsecond()).
+    inline std::uint64_t ticks() noexcept
+    {
+#ifdef PNQ_PROFILE_USE_TSC
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    /// One completed zone.
+    struct Event
+    {
+        /// Zone name; must have static storage duration (a literal or __func__)
+        const char* name;
+        std::uint64_t start;
+        std::uint64_t end;
+    };
+
+    namespace detail
+    {
+        /// Events of one thread: append-only chunks, written by the owning thread only.
+        /// Readers see every event whose count was published before they looked.
+        class ThreadBuffer final
+        {
+        public:
+            ThreadBuffer(std::uint32_t thread, std::uint64_t generation)
+                : m_thread{thread}
+                , m_generation{generation}
+            {
+            }
+
+            ~ThreadBuffer()
+            {
+                auto* chunk = m_first.next.load(std::memory_order_relaxed);
+                while (chunk)
+                {
+                    auto* next = chunk->next.load(std::memory_order_relaxed);
+                    delete chunk;
+                    chunk = next;
+                }
+            }
+
+            ThreadBuffer(const ThreadBuffer&) = delete;
+            ThreadBuffer& operator=(const ThreadBuffer&) = delete;
+            ThreadBuffer(ThreadBuffer&&) = delete;
+            ThreadBuffer& operator=(ThreadBuffer&&) = delete;
+
+            /// Append an event (owning thread only).
+            void record(const Event& event)
+            {
+                auto count = m_current->count.load(std::memory_order_relaxed);
+                if (count == Chunk::capacity)
+                {
+                    auto* chunk = new Chunk;
+                    m_current->next.store(chunk, std::memory_order_release);
+                    m_current = chunk;
+                    count = 0;
+                }
+                m_current->events[count] = event;
+                m_current->count.store(count + 1, std::memory_order_release);
+            }
+
+            /// Visit all published events (any thread).
+            template <typename F>
+            void for_each(F&& callback) const
+            {
+                for (const Chunk* chunk = &m_first; chunk; chunk = chunk->next.load(std::memory_order_acquire))
+                {
+                    const auto count = chunk->count.load(std::memory_order_acquire);
+                    for (size_t i = 0; i < count; ++i)
+                        callback(chunk->events[i]);
+                }
+            }
+
+            std::uint32_t thread() const { return m_thread; }
+
+            /// Value of State's generation when the buffer was created; clear() starts a new one
+            std::uint64_t generation() const { return m_generation; }
+
+            /// Name shown for the thread in the trace; guarded by the State mutex
+            std::string name;
+
+        private:
+            struct Chunk
+            {
+                static constexpr size_t capacity = 1024;
+
+                Event events[capacity];
+                std::atomic<size_t> count{0};
+                std::atomic<Chunk*> next{nullptr};
+            };
+
+            const std::uint32_t m_thread;
+            const std::uint64_t m_generation;
+            Chunk m_first;
+            Chunk* m_current{&m_first};
+        };
+
+        /// Process-wide profiler state.
+        class State final
+        {
+        public:
+            static State& instance()
+            {
+                static State state;
+                return state;
+            }
+
+            bool is_enabled() const
+            {
+                return m_enabled.load(std::memory_order_relaxed);
+            }
+
+            void set_enabled(bool enabled)
+            {
+                m_enabled.store(enabled, std::memory_order_relaxed);
+            }
+
+            /// Buffer of the calling thread, created on first use and after clear().
+            ThreadBuffer& thread_buffer()
+            {
+                // Shared with the registry, so events survive the end of the thread
+                thread_local std::shared_ptr<ThreadBuffer> buffer;
+                if (!buffer || buffer->generation() != m_generation.load(std::memory_order_acquire))
+                {
+                    // Only this thread writes to the old buffer, and clear() took it out of the
+                    // registry, so replacing it here frees it; the thread keeps its ID and name
+                    std::lock_guard lock{m_mutex};
+                    auto fresh = std::make_shared<ThreadBuffer>(buffer ? buffer->thread() : ++m_next_thread,
+                        m_generation.load(std::memory_order_relaxed));
+                    if (buffer)
+                        fresh->name = std::move(buffer->name);
+                    buffer = std::move(fresh);
+                    m_buffers.push_back(buffer);
+                }
+                return *buffer;
+            }
+
+            void clear()
+            {
+                std::lock_guard lock{m_mutex};
+                m_buffers.clear();
+                m_generation.fetch_add(1, std::memory_order_release);
+            }
+
+            void set_thread_name(std::string_view name)
+            {
+                auto& buffer = thread_buffer();
+                std::lock_guard lock{m_mutex};
+                buffer.name = name;
+            }
+
+            bool write_chrome_trace(std::string_view filename)
+            {
+                const auto u8 = std::u8string_view{reinterpret_cast<const char8_t*>(filename.data()), filename.size()};
+                std::ofstream file{std::filesystem::path{u8}, std::ios::binary | std::ios::trunc};
+                if (!file)
+                {
+                    PNQ_LOG_ERROR("Unable to create trace file '{}'", filename);
+                    return false;
+                }
+
+                const double scale = 1.0 / ticks_per_microsecond();
+                std::string output{"{\"displayTimeUnit\":\"ns\",\"traceEvents\":["};
+                bool first = true;
+                const auto separator = [&] {
+                    if (!first)
+                        output += ",\n";
+                    first = false;
+                };
+
+                std::lock_guard lock{m_mutex};
+                for (const auto& buffer : m_buffers)
+                {
+                    if (!buffer->name.empty())
+                    {
+                        separator();
+                        output += std::format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":")", buffer->thread());
+                        append_escaped(output, buffer->name);
+                        output += "\"}}";
+                    }
+
+                    buffer->for_each([&](const Event& event) {
+                        separator();
+                        output += "{\"name\":\"";
+                        append_escaped(output, event.name);
+                        std::format_to(std::back_inserter(output), R"(","cat":"pnq","ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f}}})",
+                            buffer->thread(),
+                            static_cast<double>(static_cast<std::int64_t>(event.start - m_origin)) * scale,
+                            static_cast<double>(event.end - event.start) * scale);
+
+                        if (output.size() >= 64 * 1024)
+                        {
+                            file.write(output.data(), static_cast<std::streamsize>(output.size()));
+                            output.clear();
+                        }
+                    });
+                }
+                output += "]}\n";
+                file.write(output.data(), static_cast<std::streamsize>(output.size()));
+
+                if (!file.flush())
+                {
+                    PNQ_LOG_ERROR("Unable to write trace file '{}'", filename);
+                    return false;
+                }
+                return true;
+            }
+
+            /// Calibrate ticks against steady_clock over the lifetime of the profiler so far.
+            double ticks_per_microsecond() const
+            {
+#ifdef PNQ_PROFILE_USE_TSC
+                const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_origin_time).count();
+                const auto ticks_elapsed = static_cast<double>(profile::ticks() - m_origin);
+                if (elapsed <= 0 || ticks_elapsed <= 0)
+                    return 1.0;
+                return ticks_elapsed / elapsed;
+#else
+                using period = std::chrono::steady_clock::period;
+                return static_cast<double>(period::den) / (static_cast<double>(period::num) * 1'000'000.0);
+#endif
+            }
+
+        private:
+            State() = default;
+
+            static void append_escaped(std::string& output, std::string_view text)
+            {
+                for (const char c : text)
+                {
+                    if (c == '"' || c == '\\')
+                    {
+                        output += '\\';
+                        output += c;
+                    }
+                    else if (static_cast<unsigned char>(c) < 0x20)
+                        std::format_to(std::back_inserter(output), "\\u{:04x}", static_cast<int>(c));
+                    else
+                        output += c;
+                }
+            }
+
+            std::atomic<bool> m_enabled{false};
+            std::atomic<std::uint64_t> m_generation{0};
+            const std::chrono::steady_clock::time_point m_origin_time{std::chrono::steady_clock::now()};
+            const std::uint64_t m_origin{profile::ticks()};
+
+            /// Guards everything below
+            std::mutex m_mutex;
+            std::vector<std::shared_ptr<ThreadBuffer>> m_buffers;
+            std::uint32_t m_next_thread{0};
+        };
+    }
+
+    // =========================================================================
+    // Public API
+    // =========================================================================
+
+    /// Start recording zones. Events are kept in memory until clear() or the end of the process.
+    inline void start()
+    {
+        detail::State::instance().set_enabled(true);
+    }
+
+    /// Stop recording zones; recorded events stay available for export.
+    inline void stop()
+    {
+        detail::State::instance().set_enabled(false);
+    }
+
+    /// Discard all recorded events, e.g. after exporting them.
+    /// Ended threads' events are freed right away; a running thread's are freed when it
+    /// records its next zone or ends. Thread names are kept.
+    inline void clear()
+    {
+        detail::State::instance().clear();
+    }
+
+    /// Check if zones are being recorded.
+    inline bool is_enabled()
+    {
+        return detail::State::instance().is_enabled();
+    }
+
+    /// Name the calling thread in exported traces.
+    inline void set_thread_name(std::string_view name)
+    {
+        detail::State::instance().set_thread_name(name);
+    }
+
+    /// Ticks per microsecond of the profiling clock.
+    inline double ticks_per_microsecond()
+    {
+        return detail::State::instance().ticks_per_microsecond();
+    }
+
+    /// Write all events recorded so far as Chrome trace JSON (also read by Perfetto).
+    /// Can be called while other threads keep recording.
+    /// @return true if successful
+    inline bool write_chrome_trace(std::string_view filename)
+    {
+        return detail::State::instance().write_chrome_trace(filename);
+    }
+
+    /// Records the time from construction to destruction as an event, if profiling is enabled.
+    /// Usually created through PNQ_PROFILE_ZONE.
+    class Zone final
+    {
+    public:
+        /// @param name zone name with static storage duration
+        explicit Zone(const char* name) noexcept
+            : m_name{detail::State::instance().is_enabled() ? name : nullptr},
+              m_start{m_name ? ticks() : 0}
+        {
+        }
+
+        ~Zone()
+        {
+            if (m_name)
+                detail::State::instance().thread_buffer().record({m_name, m_start, ticks()});
+        }
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+        Zone(Zone&&) = delete;
+        Zone& operator=(Zone&&) = delete;
+
+    private:
+        const char* const m_name;
+        const std::uint64_t m_start;
+    };
+}
+
+#define PNQ_PROFILE_CONCAT_IMPL(a, b) a##b
+#define PNQ_PROFILE_CONCAT(a, b) PNQ_PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef PNQ_ENABLE_PROFILING
+/// Profile the rest of the enclosing scope under name (a string literal).
+#define PNQ_PROFILE_ZONE(name) const ::pnq::profile::Zone PNQ_PROFILE_CONCAT(pnq__zone_, __COUNTER__){name}
+#else
+#define PNQ_PROFILE_ZONE(name) ((void)0)
+#endif
+
+/// Profile the rest of the enclosing function under its name.
+#define PNQ_PROFILE_FUNCTION() PNQ_PROFILE_ZONE(__func__)
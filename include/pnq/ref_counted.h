@@ -1,7 +1,16 @@
 #pragma once
 
 #include <atomic>
+#include <cassert>
+#include <compare>
+#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <initializer_list>
 
@@ -17,7 +26,7 @@
 namespace pnq
 {
     /// Interface for reference-counted objects.
-    /// Provides COM-style AddRef/Release semantics with thread-safe reference counting.
+    /// Provides COM-style AddRef/Release semantics; implementations choose a counting policy.
     struct IRefCounted
     {
         IRefCounted() = default;
@@ -28,10 +37,10 @@ namespace pnq
         IRefCounted(IRefCounted &&) = default;
         IRefCounted &operator=(IRefCounted &&) = default;
 
-        /// Increment the reference count (thread-safe).
+        /// Increment the reference count.
         virtual void retain(REFCOUNT_DEBUG_SPEC) const = 0;
 
-        /// Decrement the reference count (thread-safe).
+        /// Decrement the reference count.
         /// Object is deleted when count reaches zero.
         virtual void release(REFCOUNT_DEBUG_SPEC) const = 0;
 
@@ -39,9 +48,76 @@ namespace pnq
         virtual void clear() = 0;
     };
 
+    /// Counting policies for RefCounted and BasicRefCountImpl.
+    /// A policy provides a counter type constructed with the initial count,
+    /// with increment() and decrement() (which returns true when the count reaches zero).
+    namespace refcount
+    {
+        /// Thread-safe counting.
+        /// Increments are relaxed; the decrement is acq_rel so that everything done
+        /// through other references happens-before the delete (as in std::shared_ptr).
+        struct atomic
+        {
+            class counter
+            {
+            public:
+                explicit counter(int initial) noexcept
+                    : m_count{initial}
+                {
+                }
+
+                void increment() noexcept
+                {
+                    m_count.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                bool decrement() noexcept
+                {
+                    return m_count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+                }
+
+            private:
+                std::atomic<int> m_count;
+            };
+        };
+
+        /// Plain integer counting for object graphs owned by a single thread.
+        /// Debug builds assert that every retain/release happens on the creating thread.
+        struct single_thread
+        {
+            class counter
+            {
+            public:
+                explicit counter(int initial) noexcept
+                    : m_count{initial}
+                {
+                }
+
+                void increment() noexcept
+                {
+                    assert(m_owner == std::this_thread::get_id() && "single_thread refcount used from another thread");
+                    ++m_count;
+                }
+
+                bool decrement() noexcept
+                {
+                    assert(m_owner == std::this_thread::get_id() && "single_thread refcount used from another thread");
+                    return --m_count == 0;
+                }
+
+            private:
+                int m_count;
+#ifndef NDEBUG
+                std::thread::id m_owner{std::this_thread::get_id()};
+#endif
+            };
+        };
+    } // namespace refcount
+
     /// Mixin template that adds reference counting to a base class.
     /// @tparam T base class that inherits from IRefCounted
-    template <typename T> class RefCounted : public T
+    /// @tparam Policy counting policy (refcount::atomic or refcount::single_thread)
+    template <typename T, typename Policy = refcount::atomic> class RefCounted : public T
     {
     public:
         RefCounted()
@@ -51,12 +127,12 @@ namespace pnq
 
         void retain(REFCOUNT_DEBUG_SPEC) const override final
         {
-            ++m_refCount;
+            m_refCount.increment();
         }
 
         void release(REFCOUNT_DEBUG_SPEC) const override final
         {
-            if (--m_refCount == 0)
+            if (m_refCount.decrement())
                 delete this;
         }
 
@@ -65,27 +141,28 @@ namespace pnq
         }
 
     private:
-        mutable std::atomic<int> m_refCount;
+        mutable typename Policy::counter m_refCount;
     };
 
     /// Concrete base class with reference counting built-in.
     /// Derive from this when you don't need the mixin pattern.
-    class RefCountImpl : public IRefCounted
+    /// @tparam Policy counting policy (refcount::atomic or refcount::single_thread)
+    template <typename Policy> class BasicRefCountImpl : public IRefCounted
     {
     public:
-        RefCountImpl()
+        BasicRefCountImpl()
             : m_refCount{1}
         {
         }
 
         void retain(REFCOUNT_DEBUG_SPEC) const override final
         {
-            ++m_refCount;
+            m_refCount.increment();
         }
 
         void release(REFCOUNT_DEBUG_SPEC) const override final
         {
-            if (--m_refCount == 0)
+            if (m_refCount.decrement())
                 delete this;
         }
 
@@ -94,8 +171,14 @@ namespace pnq
         }
 
     private:
-        mutable std::atomic<int> m_refCount;
+        mutable typename Policy::counter m_refCount;
     };
+
+    /// Thread-safe reference counted base class.
+    using RefCountImpl = BasicRefCountImpl<refcount::atomic>;
+
+    /// Reference counted base class for objects that never leave their creating thread.
+    using SingleThreadRefCountImpl = BasicRefCountImpl<refcount::single_thread>;
 } // namespace pnq
 
 #define PNQ_ADDREF(p) do { if (p) (p)->retain(REFCOUNT_DEBUG_ARGS); } while(0)
@@ -103,107 +186,335 @@ namespace pnq
 
 namespace pnq
 {
-    /// Vector that automatically manages ref-counted pointers.
-    /// Releases all elements on destruction, retains on copy.
-    /// @tparam T pointer type to a class derived from IRefCounted
-    template <typename T> class RefCountedVector final
+    /// Tag: ref_ptr takes over a reference the caller already owns (e.g. from PNQ_NEW).
+    struct adopt_ref_t
+    {
+        explicit adopt_ref_t() = default;
+    };
+    inline constexpr adopt_ref_t adopt_ref{};
+
+    /// Tag: ref_ptr takes a new reference of its own.
+    struct retain_ref_t
+    {
+        explicit retain_ref_t() = default;
+    };
+    inline constexpr retain_ref_t retain_ref{};
+
+    /// Intrusive smart pointer for IRefCounted objects.
+    /// Copies retain, moves transfer the reference without touching the counter.
+    /// For final classes retain/release are called non-virtually.
+    /// @tparam T class derived from IRefCounted
+    template <typename T> class ref_ptr final
     {
     public:
-        RefCountedVector() = default;
+        ref_ptr() noexcept = default;
 
-        RefCountedVector(std::initializer_list<T> init)
-            : m_items(init)
+        ref_ptr(std::nullptr_t) noexcept
+        {
+        }
+
+        /// Take over an existing reference.
+        ref_ptr(T *p, adopt_ref_t) noexcept
+            : m_p{p}
+        {
+        }
+
+        /// Take a new reference.
+        ref_ptr(T *p, retain_ref_t) noexcept
+            : m_p{p}
+        {
+            add_ref(m_p);
+        }
+
+        ref_ptr(const ref_ptr &other) noexcept
+            : m_p{other.m_p}
+        {
+            add_ref(m_p);
+        }
+
+        ref_ptr(ref_ptr &&other) noexcept
+            : m_p{std::exchange(other.m_p, nullptr)}
+        {
+        }
+
+        template <typename U>
+            requires std::is_convertible_v<U *, T *>
+        ref_ptr(const ref_ptr<U> &other) noexcept
+            : m_p{other.get()}
+        {
+            add_ref(m_p);
+        }
+
+        template <typename U>
+            requires std::is_convertible_v<U *, T *>
+        ref_ptr(ref_ptr<U> &&other) noexcept
+            : m_p{other.detach()}
         {
-            for (auto p : m_items)
-                PNQ_ADDREF(p);
         }
 
-        ~RefCountedVector()
+        ~ref_ptr()
         {
-            for (auto p : m_items)
-                PNQ_RELEASE(p);
+            drop_ref(m_p);
         }
 
-        RefCountedVector(const RefCountedVector& other)
-            : m_items(other.m_items)
+        ref_ptr &operator=(const ref_ptr &other) noexcept
         {
-            for (auto p : m_items)
-                PNQ_ADDREF(p);
+            // Retain first, so self-assignment cannot drop the last reference
+            add_ref(other.m_p);
+            drop_ref(std::exchange(m_p, other.m_p));
+            return *this;
         }
 
-        RefCountedVector& operator=(const RefCountedVector& other)
+        ref_ptr &operator=(ref_ptr &&other) noexcept
         {
             if (this != &other)
+                drop_ref(std::exchange(m_p, std::exchange(other.m_p, nullptr)));
+            return *this;
+        }
+
+        ref_ptr &operator=(std::nullptr_t) noexcept
+        {
+            reset();
+            return *this;
+        }
+
+        T *get() const noexcept { return m_p; }
+        T &operator*() const noexcept { return *m_p; }
+        T *operator->() const noexcept { return m_p; }
+        explicit operator bool() const noexcept { return m_p != nullptr; }
+
+        /// Give up ownership without releasing; the caller now owns the reference.
+        [[nodiscard]] T *detach() noexcept
+        {
+            return std::exchange(m_p, nullptr);
+        }
+
+        /// Get a new reference for APIs that return owned raw pointers.
+        [[nodiscard]] T *share() const noexcept
+        {
+            add_ref(m_p);
+            return m_p;
+        }
+
+        /// Release the current object (if any).
+        void reset() noexcept
+        {
+            drop_ref(std::exchange(m_p, nullptr));
+        }
+
+        /// Release the current object and adopt p.
+        void reset(T *p, adopt_ref_t) noexcept
+        {
+            drop_ref(std::exchange(m_p, p));
+        }
+
+        void swap(ref_ptr &other) noexcept
+        {
+            std::swap(m_p, other.m_p);
+        }
+
+        friend bool operator==(const ref_ptr &a, const ref_ptr &b) noexcept { return a.m_p == b.m_p; }
+        friend bool operator==(const ref_ptr &a, std::nullptr_t) noexcept { return a.m_p == nullptr; }
+        friend bool operator==(const ref_ptr &a, const T *b) noexcept { return a.m_p == b; }
+        friend auto operator<=>(const ref_ptr &a, const ref_ptr &b) noexcept { return std::compare_three_way{}(a.m_p, b.m_p); }
+
+    private:
+        static void add_ref(T *p) noexcept
+        {
+            if (!p)
+                return;
+            if constexpr (std::is_final_v<T>)
+                p->T::retain(REFCOUNT_DEBUG_ARGS);
+            else
+                p->retain(REFCOUNT_DEBUG_ARGS);
+        }
+
+        static void drop_ref(T *p) noexcept
+        {
+            if (!p)
+                return;
+            if constexpr (std::is_final_v<T>)
+                p->T::release(REFCOUNT_DEBUG_ARGS);
+            else
+                p->release(REFCOUNT_DEBUG_ARGS);
+        }
+
+        T *m_p{nullptr};
+    };
+
+    /// Deletes retired objects on a background thread.
+    /// Dropping the last reference to a large object graph then neither blocks the caller
+    /// nor runs its destructors on the caller's stack.
+    class Reclaimer final
+    {
+    public:
+        Reclaimer()
+            : m_thread{[this] { run(); }}
+        {
+        }
+
+        /// Deletes everything still queued, then stops the thread.
+        ~Reclaimer()
+        {
             {
-                for (auto p : m_items)
-                    PNQ_RELEASE(p);
-                m_items = other.m_items;
-                for (auto p : m_items)
-                    PNQ_ADDREF(p);
+                std::lock_guard lock{m_mutex};
+                m_stopping = true;
             }
-            return *this;
+            m_changed.notify_all();
+            m_thread.join();
         }
 
-        RefCountedVector(RefCountedVector&& other) noexcept
-            : m_items(std::move(other.m_items))
+        Reclaimer(const Reclaimer &) = delete;
+        Reclaimer &operator=(const Reclaimer &) = delete;
+        Reclaimer(Reclaimer &&) = delete;
+        Reclaimer &operator=(Reclaimer &&) = delete;
+
+        /// Queue an object whose reference count has dropped to zero for deletion.
+        void retire(const IRefCounted *object)
         {
+            {
+                std::lock_guard lock{m_mutex};
+                m_retired.push_back(object);
+            }
+            m_changed.notify_all();
         }
 
-        RefCountedVector& operator=(RefCountedVector&& other) noexcept
+        /// Wait until every object retired so far has been deleted.
+        void drain()
         {
-            if (this != &other)
+            std::unique_lock lock{m_mutex};
+            m_changed.wait(lock, [this] { return m_retired.empty() && !m_busy; });
+        }
+
+        /// Process-wide reclaimer, started on first use.
+        static Reclaimer &background()
+        {
+            static Reclaimer instance;
+            return instance;
+        }
+
+    private:
+        void run()
+        {
+            std::unique_lock lock{m_mutex};
+            for (;;)
             {
-                for (auto p : m_items)
-                    PNQ_RELEASE(p);
-                m_items = std::move(other.m_items);
+                m_changed.wait(lock, [this] { return m_stopping || !m_retired.empty(); });
+                if (m_retired.empty())
+                    return;
+
+                auto batch = std::move(m_retired);
+                m_retired.clear();
+                m_busy = true;
+
+                lock.unlock();
+                for (const auto *object : batch)
+                    delete object;
+                lock.lock();
+
+                m_busy = false;
+                m_changed.notify_all();
             }
-            return *this;
+        }
+
+        std::mutex m_mutex;
+        std::condition_variable m_changed;
+        std::vector<const IRefCounted *> m_retired;
+        bool m_busy{false};
+        bool m_stopping{false};
+        std::thread m_thread;
+    };
+
+    /// Create a ref-counted object owned by a ref_ptr.
+    template <typename T, typename... Args> ref_ptr<T> make_ref(Args &&...args)
+    {
+        return ref_ptr<T>{new T(std::forward<Args>(args)...), adopt_ref};
+    }
+
+    /// Vector that automatically manages ref-counted pointers.
+    /// Releases all elements on destruction, retains on copy.
+    /// @tparam T pointer type to a class derived from IRefCounted
+    template <typename T> class RefCountedVector final
+    {
+        using element_type = std::remove_pointer_t<T>;
+        using storage = std::vector<ref_ptr<element_type>>;
+
+    public:
+        /// Iterator yielding the raw pointers (the vector keeps the references).
+        template <typename It> class raw_iterator
+        {
+        public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T *;
+            using reference = T;
+
+            raw_iterator() = default;
+            explicit raw_iterator(It it) : m_it{it} {}
+
+            T operator*() const { return m_it->get(); }
+            raw_iterator &operator++() { ++m_it; return *this; }
+            raw_iterator operator++(int) { auto tmp = *this; ++m_it; return tmp; }
+            raw_iterator &operator--() { --m_it; return *this; }
+            raw_iterator operator--(int) { auto tmp = *this; --m_it; return tmp; }
+            bool operator==(const raw_iterator &other) const { return m_it == other.m_it; }
+
+        private:
+            It m_it{};
+        };
+
+        using const_iterator = raw_iterator<typename storage::const_iterator>;
+
+        RefCountedVector() = default;
+
+        RefCountedVector(std::initializer_list<T> init)
+        {
+            m_items.reserve(init.size());
+            for (auto p : init)
+                m_items.emplace_back(p, retain_ref);
         }
 
         /// Add element (retains it).
         void push_back(T p)
         {
-            PNQ_ADDREF(p);
-            m_items.push_back(p);
+            m_items.emplace_back(p, retain_ref);
+        }
+
+        /// Add element, taking over the reference held by p.
+        void push_back(ref_ptr<element_type> p)
+        {
+            m_items.push_back(std::move(p));
         }
 
         /// Remove last element (releases it).
         void pop_back()
         {
             if (!m_items.empty())
-            {
-                PNQ_RELEASE(m_items.back());
                 m_items.pop_back();
-            }
         }
 
         /// Clear all elements (releases each).
         void clear()
         {
-            for (auto p : m_items)
-                PNQ_RELEASE(p);
             m_items.clear();
         }
 
         /// Access element by index (no bounds check).
-        T operator[](size_t i) const { return m_items[i]; }
+        T operator[](size_t i) const { return m_items[i].get(); }
 
         /// Access element by index with bounds check.
-        T at(size_t i) const { return m_items.at(i); }
+        T at(size_t i) const { return m_items.at(i).get(); }
 
         size_t size() const { return m_items.size(); }
         bool empty() const { return m_items.empty(); }
 
-        auto begin() { return m_items.begin(); }
-        auto end() { return m_items.end(); }
-        auto begin() const { return m_items.begin(); }
-        auto end() const { return m_items.end(); }
-        auto rbegin() { return m_items.rbegin(); }
-        auto rend() { return m_items.rend(); }
-        auto rbegin() const { return m_items.rbegin(); }
-        auto rend() const { return m_items.rend(); }
+        const_iterator begin() const { return const_iterator{m_items.begin()}; }
+        const_iterator end() const { return const_iterator{m_items.end()}; }
+        auto rbegin() const { return std::make_reverse_iterator(end()); }
+        auto rend() const { return std::make_reverse_iterator(begin()); }
 
     private:
-        std::vector<T> m_items;
+        storage m_items;
     };
 } // namespace pnq
@@ -9,6 +9,7 @@
 #include <pnq/string_writer.h>
 #include <pnq/text_file.h>
 #include <pnq/logging.h>
+#include <pnq/profile.h>
 
 #ifdef PNQ_PLATFORM_WINDOWS
 #include <pnq/regis3/key.h>
@@ -112,6 +113,7 @@ namespace pnq
             /// @return true if successful
             bool perform_export(const key_entry* key, export_options options = export_options::none) override
             {
+                PNQ_PROFILE_ZONE("regis3::regfile_export");
                 string::Writer output;
 
                 // Write header
@@ -127,6 +129,7 @@ namespace pnq
                 // Write to file if filename was provided
                 if (!m_filename.empty())
                 {
+                    PNQ_PROFILE_ZONE("regis3::write_file");
                     return write_file();
                 }
 
@@ -335,6 +338,7 @@ namespace pnq
             /// @return true if all operations succeeded
             bool perform_export(const key_entry* root, export_options options = export_options::none) override
             {
+                PNQ_PROFILE_ZONE("regis3::registry_export");
                 return export_recursive(root, has_flag(options, export_options::no_empty_keys));
             }
 
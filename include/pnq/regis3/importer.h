@@ -40,13 +40,7 @@ namespace pnq
         public:
             PNQ_DECLARE_NON_COPYABLE(regfile_importer)
 
-            virtual ~regfile_importer()
-            {
-                if (m_result)
-                {
-                    PNQ_RELEASE(m_result);
-                }
-            }
+            virtual ~regfile_importer() = default;
 
             /// Import the .REG file content.
             /// @return Root key entry (caller must release), or nullptr on failure
@@ -57,28 +51,22 @@ namespace pnq
                     if (!m_parser.parse_text(m_content))
                         return nullptr;
 
-                    m_result = m_parser.get_result();
+                    m_result = m_parser.result();
                 }
-
-                if (m_result)
-                {
-                    PNQ_ADDREF(m_result);
-                }
-                return m_result;
+                return m_result.share();
             }
 
         protected:
             regfile_importer(std::string_view content, std::string_view expected_header, import_options options)
                 : m_content{content},
-                  m_parser{expected_header, options},
-                  m_result{nullptr}
+                  m_parser{expected_header, options}
             {
             }
 
         private:
             std::string m_content;
             regfile_parser m_parser;
-            key_entry* m_result;
+            ref_ptr<key_entry> m_result;
         };
 
         // =====================================================================
@@ -180,17 +168,8 @@ namespace pnq
             /// Create importer for the given registry path.
             /// @param root_path Full registry path (e.g., "HKEY_CURRENT_USER\\Software\\MyApp")
             explicit registry_importer(std::string_view root_path)
-                : m_root_path{root_path},
-                  m_result{nullptr}
-            {
-            }
-
-            ~registry_importer()
+                : m_root_path{root_path}
             {
-                if (m_result)
-                {
-                    PNQ_RELEASE(m_result);
-                }
             }
 
             /// Import from the live registry.
@@ -199,27 +178,24 @@ namespace pnq
             {
                 if (m_result)
                 {
-                    PNQ_ADDREF(m_result);
-                    return m_result;
+                    return m_result.share();
                 }
 
                 // Create root entry
-                m_result = PNQ_NEW key_entry{nullptr, m_root_path};
+                m_result = make_ref<key_entry>(nullptr, m_root_path);
 
                 // Open the registry key
                 key reg_key{m_root_path};
                 if (!reg_key.open_for_reading())
                 {
                     // Key doesn't exist - return empty tree
-                    PNQ_ADDREF(m_result);
-                    return m_result;
+                    return m_result.share();
                 }
 
                 // Import recursively
-                import_recursive(m_result, reg_key);
+                import_recursive(m_result.get(), reg_key);
 
-                PNQ_ADDREF(m_result);
-                return m_result;
+                return m_result.share();
             }
 
         private:
@@ -256,7 +232,7 @@ namespace pnq
             }
 
             std::string m_root_path;
-            key_entry* m_result;
+            ref_ptr<key_entry> m_result;
         };
 
     } // namespace regis3
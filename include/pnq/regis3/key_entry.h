@@ -5,6 +5,7 @@
 
 #include <pnq/regis3/types.h>
 #include <pnq/regis3/value.h>
+#include <pnq/memory_tracking.h>
 #include <pnq/ref_counted.h>
 #include <pnq/string.h>
 #include <pnq/pnq.h>
@@ -14,6 +15,13 @@
 #include <algorithm>
 #include <cassert>
 
+/// Reference counting policy of regis3::key_entry.
+/// Define as pnq::refcount::single_thread when trees are built and consumed on one thread
+/// to avoid atomic operations on every clone and merge.
+#ifndef PNQ_REGIS3_REFCOUNT_POLICY
+#define PNQ_REGIS3_REFCOUNT_POLICY pnq::refcount::atomic
+#endif
+
 namespace pnq
 {
     namespace regis3
@@ -21,43 +29,48 @@ namespace pnq
         /// In-memory representation of a registry key.
         ///
         /// Forms a tree structure with parent/child relationships.
-        /// Uses reference counting for memory management.
         /// Keys and values are stored case-insensitively (lowercase keys).
-        class key_entry final : public RefCountImpl
+        ///
+        /// Reference counting is per tree: retaining any key retains the whole tree, so a key
+        /// can be kept while the rest of the tree (which get_path() needs) stays alive.
+        /// A key constructed with a parent becomes that parent's subkey and lives until the
+        /// tree is destroyed, even if it is later replaced by a subkey of the same name. The tree is destroyed without recursion when the last reference
+        /// is released, optionally on a Reclaimer thread (see set_reclaimer()).
+        class key_entry final : public IRefCounted
         {
         public:
-            /// Default constructor creates an unnamed root key.
+            /// Default constructor creates an unnamed root key with reference count 1.
             key_entry()
                 : m_parent{nullptr},
+                  m_root{this},
                   m_default_value{nullptr},
                   m_remove_flag{false}
             {
             }
 
             /// Construct a named key with parent.
+            /// The key is added to the parent's subkeys and the caller receives one reference to
+            /// the tree. A subkey of the same name is detached from the parent but not destroyed:
+            /// pointers to it stay valid until the tree is destroyed.
             /// @param parent Parent key (may be nullptr for root)
             /// @param name Key name (stored as-is, lookups are case-insensitive)
             key_entry(key_entry* parent, std::string_view name)
-                : m_parent{parent},
-                  m_name{name},
-                  m_default_value{nullptr},
-                  m_remove_flag{false}
+                : key_entry{parent, name, child_tag{}}
             {
                 if (m_parent)
                 {
-                    m_parent->retain();
+                    auto& slot = m_parent->m_keys[string::lowercase(m_name)];
+                    if (slot)
+                    {
+                        m_root->m_detached.push_back(slot);
+                    }
+                    slot = this;
+                    retain();
                 }
             }
 
             ~key_entry()
             {
-                // Release parent reference
-                if (m_parent)
-                {
-                    m_parent->release();
-                    m_parent = nullptr;
-                }
-
                 // Clean up values
                 for (auto& [key, val] : m_values)
                 {
@@ -68,15 +81,59 @@ namespace pnq
                 delete m_default_value;
                 m_default_value = nullptr;
 
-                // Release child key references
+                // Delete subkeys with an explicit work list instead of recursion,
+                // so deep trees cannot overflow the stack
+                std::vector<key_entry*> pending{std::move(m_detached)};
                 for (auto& [key, child] : m_keys)
                 {
-                    child->release();
+                    pending.push_back(child);
                 }
                 m_keys.clear();
+
+                while (!pending.empty())
+                {
+                    key_entry* k = pending.back();
+                    pending.pop_back();
+                    for (auto& [key, child] : k->m_keys)
+                    {
+                        pending.push_back(child);
+                    }
+                    k->m_keys.clear();
+                    delete k;
+                }
+            }
+
+            /// Retain the tree this key belongs to.
+            void retain(REFCOUNT_DEBUG_SPEC) const override
+            {
+                m_root->m_refCount.increment();
+            }
+
+            /// Release the tree this key belongs to; the last release destroys it.
+            void release(REFCOUNT_DEBUG_SPEC) const override
+            {
+                if (!m_root->m_refCount.decrement())
+                    return;
+
+                if (m_root->m_reclaimer)
+                    m_root->m_reclaimer->retire(m_root);
+                else
+                    delete m_root;
+            }
+
+            void clear() override
+            {
+            }
+
+            /// Destroy this tree on a background thread when its last reference is released.
+            /// @param reclaimer Reclaimer to hand the tree to (e.g. &Reclaimer::background()), or nullptr
+            void set_reclaimer(Reclaimer* reclaimer)
+            {
+                m_root->m_reclaimer = reclaimer;
             }
 
             PNQ_DECLARE_NON_COPYABLE(key_entry)
+            PNQ_TRACK_ALLOCATIONS_AS(memory::category::key_entry)
 
             // =================================================================
             // Accessors
@@ -182,8 +239,8 @@ namespace pnq
                     }
                     else
                     {
-                        subkey = PNQ_NEW key_entry(result, token);
-                        result->m_keys[key] = subkey;
+                        subkey = PNQ_NEW key_entry(result, token, child_tag{});
+                        subkey->attach();
                     }
 
                     assert(subkey->m_parent == result);
@@ -229,31 +286,17 @@ namespace pnq
             // =================================================================
 
             /// Create a deep copy of this key entry.
-            /// @param new_parent Parent for the cloned key
-            /// @return New key_entry with reference count of 1
+            /// If new_parent already has a subkey of the same name, the copy is merged into it:
+            /// values of the copy replace values of the same name, other content is kept.
+            /// @param new_parent Parent for the cloned key (it becomes a subkey of new_parent)
+            /// @return Cloned (or merged) key_entry; the caller owns one reference to its tree
             key_entry* clone(key_entry* new_parent) const
             {
-                key_entry* result = PNQ_NEW key_entry(new_parent, m_name);
-                result->m_remove_flag = m_remove_flag;
-
-                // Clone subkeys
-                for (const auto& [key, child] : m_keys)
-                {
-                    result->m_keys[key] = child->clone(result);
-                }
-
-                // Clone values
-                for (const auto& [key, val] : m_values)
-                {
-                    result->m_values[key] = PNQ_NEW value(*val);
-                }
-
-                // Clone default value
-                if (m_default_value)
+                key_entry* result = clone_into(new_parent);
+                if (new_parent)
                 {
-                    result->m_default_value = PNQ_NEW value(*m_default_value);
+                    result->retain();
                 }
-
                 return result;
             }
 
@@ -262,23 +305,30 @@ namespace pnq
             // =================================================================
 
             /// Create or find a key for adding content.
-            /// Used when building diff/merge output.
+            /// Used when building diff/merge output. Subkeys of add_this are merged into
+            /// existing subkeys of the same name, so no key in this tree is destroyed.
             /// @param add_this Source key to copy content from
             /// @return Key entry in this tree at the same path
             key_entry* ask_to_add_key(const key_entry* add_this)
             {
                 key_entry* key = find_or_create_key(add_this->get_path());
 
+                // Adding a key to itself changes nothing
+                if (key == add_this)
+                {
+                    return key;
+                }
+
                 // Copy subkeys
                 for (const auto& [subkey_name, subkey] : add_this->m_keys)
                 {
-                    key_entry* cloned = subkey->clone(key);
-                    key->m_keys[subkey_name] = cloned;
+                    subkey->clone_into(key);
                 }
 
                 // Copy values
                 for (const auto& [val_name, val] : add_this->m_values)
                 {
+                    delete key->m_values[val_name];  // safe even if nullptr
                     key->m_values[val_name] = PNQ_NEW value(*val);
                 }
 
@@ -384,9 +434,132 @@ namespace pnq
             friend class registry_exporter;
             friend class registry_importer;
 
+            struct child_tag
+            {
+            };
+
+            /// Construct a key of parent's tree without handing out a reference.
+            /// It is not a subkey of parent until attach() is called.
+            key_entry(key_entry* parent, std::string_view name, child_tag)
+                : m_parent{parent},
+                  m_root{parent ? parent->m_root : this},
+                  m_name{name},
+                  m_default_value{nullptr},
+                  m_remove_flag{false}
+            {
+            }
+
+            /// Add this key to its parent's subkeys.
+            /// If the parent has a subkey of the same name, this key's content is merged into it
+            /// and this key is deleted.
+            /// @return the key that is now the parent's subkey
+            key_entry* attach()
+            {
+                auto& slot = m_parent->m_keys[string::lowercase(m_name)];
+                if (!slot)
+                {
+                    slot = this;
+                    return this;
+                }
+
+                key_entry* existing = slot;
+                merge_into(existing);
+                return existing;
+            }
+
+            /// Move content into target (a key of the same name) without recursion, then delete this key.
+            /// Values replace values of the same name; subkeys are merged into subkeys of the same name.
+            void merge_into(key_entry* target)
+            {
+                std::vector<std::pair<key_entry*, key_entry*>> pending{{this, target}};
+                while (!pending.empty())
+                {
+                    const auto [source, dest] = pending.back();
+                    pending.pop_back();
+
+                    dest->m_remove_flag = source->m_remove_flag;
+
+                    for (auto& [key, val] : source->m_values)
+                    {
+                        auto& slot = dest->m_values[key];
+                        delete slot;  // safe even if nullptr
+                        slot = val;
+                    }
+                    source->m_values.clear();
+
+                    if (source->m_default_value)
+                    {
+                        delete dest->m_default_value;
+                        dest->m_default_value = source->m_default_value;
+                        source->m_default_value = nullptr;
+                    }
+
+                    for (auto& [key, child] : source->m_keys)
+                    {
+                        auto& slot = dest->m_keys[key];
+                        if (slot)
+                        {
+                            pending.emplace_back(child, slot);
+                        }
+                        else
+                        {
+                            child->m_parent = dest;
+                            slot = child;
+                        }
+                    }
+                    source->m_keys.clear();
+
+                    // Children still pending are separate objects, so this only frees the node
+                    delete source;
+                }
+            }
+
+            /// Deep copy into parent without recursion.
+            /// @return the copy (or the subkey it was merged into); borrowed if parent is set,
+            ///         else a new root with reference count 1
+            key_entry* clone_into(key_entry* parent) const
+            {
+                key_entry* result = PNQ_NEW key_entry(parent, m_name, child_tag{});
+
+                std::vector<std::pair<const key_entry*, key_entry*>> pending{{this, result}};
+                while (!pending.empty())
+                {
+                    const auto [source, target] = pending.back();
+                    pending.pop_back();
+
+                    target->m_remove_flag = source->m_remove_flag;
+
+                    for (const auto& [key, val] : source->m_values)
+                    {
+                        target->m_values[key] = PNQ_NEW value(*val);
+                    }
+                    if (source->m_default_value)
+                    {
+                        target->m_default_value = PNQ_NEW value(*source->m_default_value);
+                    }
+
+                    for (const auto& [key, child] : source->m_keys)
+                    {
+                        key_entry* copy = PNQ_NEW key_entry(target, child->m_name, child_tag{});
+                        target->m_keys[key] = copy;
+                        pending.emplace_back(child, copy);
+                    }
+                }
+
+                // Attach last: the subkey this merges into may contain the source
+                if (parent)
+                {
+                    result = result->attach();
+                }
+                return result;
+            }
+
             /// Parent key (nullptr for root).
             key_entry* m_parent;
 
+            /// Root of the tree; holds the reference count for all keys in it.
+            key_entry* m_root;
+
             /// Key name (not the full path).
             std::string m_name;
 
@@ -401,6 +574,15 @@ namespace pnq
 
             /// Flag indicating this key should be removed.
             bool m_remove_flag;
+
+            /// Reference count of the tree (only used on the root).
+            mutable PNQ_REGIS3_REFCOUNT_POLICY::counter m_refCount{1};
+
+            /// Reclaimer that destroys the tree (only used on the root).
+            Reclaimer* m_reclaimer{nullptr};
+
+            /// Subkeys replaced by a key constructed with the same name (only used on the root).
+            std::vector<key_entry*> m_detached;
         };
 
     } // namespace regis3
@@ -10,6 +10,7 @@
 #include <pnq/string_writer.h>
 #include <pnq/text_file.h>
 #include <pnq/pnq.h>
+#include <pnq/profile.h>
 
 #include <functional>
 #include <vector>
@@ -75,6 +76,7 @@ namespace pnq
             /// @return true if parsing succeeded
             bool parse_file(std::string_view filename)
             {
+                PNQ_PROFILE_ZONE("regis3::parse_file");
                 m_last_known_filename = filename;
                 std::string content = text_file::read_auto(filename);
                 return parse_text_impl(content);
@@ -138,7 +140,7 @@ namespace pnq
                     output.append(' ');
                 output.append("^\r\n");
 
-                PNQ_LOG_ERROR("{}", output.as_string());
+                PNQ_LOG_ERROR_RATELIMITED(10, "{}", output.as_string());
                 m_syntax_error_raised = true;
                 return false;
             }
@@ -180,6 +182,7 @@ namespace pnq
         private:
             bool parse_text_impl(std::string_view text)
             {
+                PNQ_PROFILE_ZONE("regis3::parse");
                 m_current_text = text.data();
                 m_line = 1;
                 m_column = 1;
@@ -187,6 +190,7 @@ namespace pnq
                 m_syntax_error_raised = false;
                 m_current_state = m_initial_state;
                 m_buffer.clear();
+                PNQ_LOG_TRACE("regis3 parser: {} bytes from '{}'", text.size(), m_last_known_filename);
 
                 const char* ptr = text.data();
                 const char* end = ptr + text.size();
@@ -250,31 +254,24 @@ namespace pnq
                   m_options{options},
                   m_header_id{expected_header},
                   m_number_of_closing_brackets_expected{0},
-                  m_result{PNQ_NEW key_entry()},
+                  m_result{PNQ_NEW key_entry(), adopt_ref},
                   m_current_key{nullptr},
                   m_current_value{nullptr},
                   m_current_data_kind{REG_TYPE_UNKNOWN}
             {
             }
 
-            ~regfile_parser()
-            {
-                if (m_result)
-                {
-                    m_result->release();
-                    m_result = nullptr;
-                }
-            }
-
             /// Get the parsed result.
             /// Caller receives ownership (reference count is incremented).
             /// @return Root key_entry of parsed content
             key_entry* get_result() const
             {
-                if (m_result)
-                {
-                    m_result->retain();
-                }
+                return m_result.share();
+            }
+
+            /// Get the parsed result as a shared reference.
+            const ref_ptr<key_entry>& result() const
+            {
                 return m_result;
             }
 
@@ -288,11 +285,7 @@ namespace pnq
                        m_result->values().empty() &&
                        m_result->default_value() == nullptr)
                 {
-                    auto it = m_result->keys().begin();
-                    key_entry* child = it->second;
-                    child->retain();
-                    m_result->release();
-                    m_result = child;
+                    m_result = ref_ptr<key_entry>{m_result->keys().begin()->second, retain_ref};
                 }
                 return true;
             }
@@ -502,6 +495,7 @@ namespace pnq
                 if (c == '"')
                 {
                     m_current_value = m_current_key->find_or_create_value(buffer_as_string());
+                    PNQ_LOG_TRACE("regis3 parser: line {}: value '{}'", m_line, m_current_value->name());
                     return set_current_state(&regfile_parser::state_expect_equal_sign);
                 }
                 else if (c == '\\')
@@ -689,6 +683,7 @@ namespace pnq
                     if (m_number_of_closing_brackets_expected == 0)
                     {
                         m_current_key = m_result->find_or_create_key(buffer_as_string());
+                        PNQ_LOG_TRACE("regis3 parser: line {}: key [{}]", m_line, m_current_key->get_path());
                         return set_current_state(&regfile_parser::state_expect_carriage_return);
                     }
                     else
@@ -777,7 +772,7 @@ namespace pnq
             import_options m_options;
             std::string m_header_id;
             int32_t m_number_of_closing_brackets_expected;
-            key_entry* m_result;
+            ref_ptr<key_entry> m_result;
             key_entry* m_current_key;
             value* m_current_value;
             uint32_t m_current_data_kind;
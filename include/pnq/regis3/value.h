@@ -5,6 +5,7 @@
 
 #include <pnq/regis3/types.h>
 #include <pnq/unicode.h>
+#include <pnq/memory_tracking.h>
 
 #include <cassert>
 #include <cstring>
@@ -58,6 +59,8 @@ namespace pnq
             /// Copy constructor.
             value(const value& other) = default;
 
+            PNQ_TRACK_ALLOCATIONS_AS(memory::category::value)
+
             /// Copy assignment.
             value& operator=(const value& other) = default;
 
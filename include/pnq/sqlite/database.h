@@ -167,7 +167,7 @@ namespace pnq
                 output.append("): ");
                 output.append(message);
                 m_last_error = output;
-                PNQ_LOG_ERROR("{}", output);
+                PNQ_LOG_ERROR_RATELIMITED(10, "{}", output);
                 return false;
             }
 
@@ -14,6 +14,7 @@
 #include <vector>
 
 #include <pnq/log.h>
+#include <pnq/profile.h>
 #include <pnq/sqlite/database.h>
 
 namespace pnq
@@ -269,6 +270,7 @@ namespace pnq
             /// Execute statement (for INSERT/UPDATE/DELETE or SELECT with results).
             bool execute()
             {
+                PNQ_PROFILE_ZONE("sqlite::Statement::execute");
                 m_done = false;
                 for (;;)
                 {
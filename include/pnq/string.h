@@ -5,14 +5,20 @@
 #include <vector>
 #include <charconv>
 #include <cctype>
+#include <cassert>
 #include <cstring>
 #include <type_traits>
 
 #ifdef PNQ_PLATFORM_WINDOWS
 #include <Windows.h>
 #else
+#include <strings.h>
+#include <cwchar>
+#include <cwctype>
+#ifdef PNQ_PLATFORM_MACOS
 #include <CoreFoundation/CoreFoundation.h>
 #endif
+#endif
 
 namespace pnq
 {
@@ -20,6 +26,97 @@ namespace pnq
     {
         constexpr std::string_view newline = "\r\n";
 
+        namespace detail
+        {
+            /// Compare at most count characters, ignoring (ASCII) case.
+            inline int compare_nocase(const char *a, const char *b, size_t count)
+            {
+#ifdef PNQ_PLATFORM_WINDOWS
+                return _strnicmp(a, b, count);
+#else
+                return ::strncasecmp(a, b, count);
+#endif
+            }
+
+            /// Compare at most count wide characters, ignoring case.
+            inline int compare_nocase(const wchar_t *a, const wchar_t *b, size_t count)
+            {
+#ifdef PNQ_PLATFORM_WINDOWS
+                return _wcsnicmp(a, b, count);
+#else
+                return ::wcsncasecmp(a, b, count);
+#endif
+            }
+
+#ifndef PNQ_PLATFORM_WINDOWS
+            /// Decode the UTF-8 sequence at text[i] and advance i past it.
+            /// @return false (and i advanced by one byte) for an invalid sequence
+            inline bool decode_utf8(std::string_view text, size_t &i, char32_t &code)
+            {
+                const auto lead = static_cast<unsigned char>(text[i]);
+                const size_t length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+                code = length == 1 ? lead : length == 2 ? lead & 0x1F : length == 3 ? lead & 0x0F : lead & 0x07;
+                bool valid = length && i + length <= text.size();
+                for (size_t k = 1; valid && k < length; ++k)
+                {
+                    const auto next = static_cast<unsigned char>(text[i + k]);
+                    valid = (next & 0xC0) == 0x80;
+                    code = (code << 6) | (next & 0x3F);
+                }
+                i += valid ? length : 1;
+                return valid;
+            }
+
+            /// Append code as UTF-8.
+            inline void append_utf8(std::string &result, char32_t code)
+            {
+                if (code < 0x80)
+                {
+                    result.push_back(static_cast<char>(code));
+                }
+                else if (code < 0x800)
+                {
+                    result.push_back(static_cast<char>(0xC0 | (code >> 6)));
+                    result.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                }
+                else if (code < 0x10000)
+                {
+                    result.push_back(static_cast<char>(0xE0 | (code >> 12)));
+                    result.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                    result.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                }
+                else
+                {
+                    result.push_back(static_cast<char>(0xF0 | (code >> 18)));
+                    result.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+                    result.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                    result.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                }
+            }
+#endif
+
+#ifdef PNQ_PLATFORM_LINUX
+            /// Map each code point of a UTF-8 string with towupper/towlower (current C locale).
+            /// Invalid sequences are copied unchanged.
+            inline std::string map_utf8(std::string_view text, std::wint_t (*map)(std::wint_t))
+            {
+                std::string result;
+                result.reserve(text.size());
+                size_t i = 0;
+                while (i < text.size())
+                {
+                    const size_t start = i;
+                    char32_t code;
+                    if (decode_utf8(text, i, code))
+                        append_utf8(result, static_cast<char32_t>(map(static_cast<std::wint_t>(code))));
+                    else
+                        result.push_back(text[start]);
+                }
+                return result;
+            }
+#endif
+        } // namespace detail
+
         /// Check if a C string is null or empty.
         inline bool is_empty(const char *p)
         {
@@ -107,7 +204,7 @@ namespace pnq
         {
             if (a.size() != b.size())
                 return false;
-            return _wcsnicmp(a.data(), b.data(), a.size()) == 0;
+            return detail::compare_nocase(a.data(), b.data(), a.size()) == 0;
         }
 
         /// Case-insensitive comparison of strings.
@@ -118,9 +215,46 @@ namespace pnq
         {
             if (a.size() != b.size())
                 return false;
-            return _strnicmp(a.data(), b.data(), a.size()) == 0;
+            return detail::compare_nocase(a.data(), b.data(), a.size()) == 0;
+        }
+
+        /// Case-insensitive (ASCII) FNV-1a hash, consistent with equals_nocase.
+        /// @param text string to hash
+        /// @return hash value
+        inline size_t hash_nocase(std::string_view text)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            for (const char c : text)
+            {
+                const auto u = static_cast<unsigned char>(c);
+                hash ^= (u >= 'A' && u <= 'Z') ? (u | 0x20) : u;
+                hash *= 1099511628211ull;
+            }
+            return static_cast<size_t>(hash);
         }
 
+        /// Transparent case-insensitive hash for unordered containers keyed by strings.
+        struct nocase_hash
+        {
+            using is_transparent = void;
+
+            size_t operator()(std::string_view text) const
+            {
+                return hash_nocase(text);
+            }
+        };
+
+        /// Transparent case-insensitive equality for unordered containers keyed by strings.
+        struct nocase_equal
+        {
+            using is_transparent = void;
+
+            bool operator()(std::string_view a, std::string_view b) const
+            {
+                return equals_nocase(a, b);
+            }
+        };
+
         /// Case-insensitive find (like std::string::find but ignores case).
         /// @param haystack string to search in
         /// @param needle string to search for
@@ -135,7 +269,7 @@ namespace pnq
 
             for (size_t i = start_pos; i <= haystack.size() - needle.size(); ++i)
             {
-                if (_strnicmp(haystack.data() + i, needle.data(), needle.size()) == 0)
+                if (detail::compare_nocase(haystack.data() + i, needle.data(), needle.size()) == 0)
                     return i;
             }
             return std::string::npos;
@@ -307,6 +441,8 @@ namespace pnq
             std::string result(utf8_len, '\0');
             WideCharToMultiByte(CP_UTF8, 0, upper.data(), result_len, result.data(), utf8_len, nullptr, nullptr);
             return result;
+#elif defined(PNQ_PLATFORM_LINUX)
+            return detail::map_utf8(text, std::towupper);
 #else
             CFStringRef cfstr = CFStringCreateWithBytes(nullptr, (const UInt8 *)text.data(), text.size(), kCFStringEncodingUTF8, false);
             if (!cfstr)
@@ -379,6 +515,8 @@ namespace pnq
             std::string result(utf8_len, '\0');
             WideCharToMultiByte(CP_UTF8, 0, lower.data(), result_len, result.data(), utf8_len, nullptr, nullptr);
             return result;
+#elif defined(PNQ_PLATFORM_LINUX)
+            return detail::map_utf8(text, std::towlower);
 #else
             CFStringRef cfstr = CFStringCreateWithBytes(nullptr, (const UInt8 *)text.data(), text.size(), kCFStringEncodingUTF8, false);
             if (!cfstr)
@@ -459,6 +597,7 @@ namespace pnq
             return result;
         }
 
+#ifdef PNQ_PLATFORM_WINDOWS
         /// UTF-16 to UTF-8 conversion using Windows API.
         /// @param string_to_encode the UTF-16 string to encode
         /// @return the UTF-8 encoded string
@@ -568,6 +707,58 @@ namespace pnq
 
             return result;
         }
+#else
+        /// wchar_t (UTF-32 off Windows) to UTF-8 conversion.
+        /// @param string_to_encode the wide string to encode
+        /// @return the UTF-8 encoded string
+        inline std::string encode_as_utf8(std::wstring_view string_to_encode)
+        {
+            std::string result;
+            result.reserve(string_to_encode.size());
+            for (const wchar_t c : string_to_encode)
+                detail::append_utf8(result, static_cast<char32_t>(c));
+            return result;
+        }
+
+        /// UTF-16 to UTF-8 conversion; unpaired surrogates become U+FFFD.
+        /// @param string_to_encode the UTF-16 string to encode
+        /// @return the UTF-8 encoded string
+        inline std::string encode_as_utf8(std::u16string_view string_to_encode)
+        {
+            std::string result;
+            result.reserve(string_to_encode.size());
+            for (size_t i = 0; i < string_to_encode.size(); ++i)
+            {
+                char32_t code = string_to_encode[i];
+                if (code >= 0xD800 && code <= 0xDBFF && i + 1 < string_to_encode.size() &&
+                    string_to_encode[i + 1] >= 0xDC00 && string_to_encode[i + 1] <= 0xDFFF)
+                {
+                    code = 0x10000 + ((code - 0xD800) << 10) + (string_to_encode[++i] - 0xDC00);
+                }
+                else if (code >= 0xD800 && code <= 0xDFFF)
+                {
+                    code = 0xFFFD;
+                }
+                detail::append_utf8(result, code);
+            }
+            return result;
+        }
+
+        /// UTF-8 to wchar_t (UTF-32 off Windows) conversion; keeps the Windows name so callers are portable.
+        /// Invalid sequences become U+FFFD.
+        inline std::wstring encode_as_utf16(std::string_view utf8_encoded_text)
+        {
+            std::wstring result;
+            result.reserve(utf8_encoded_text.size());
+            size_t i = 0;
+            while (i < utf8_encoded_text.size())
+            {
+                char32_t code;
+                result.push_back(detail::decode_utf8(utf8_encoded_text, i, code) ? static_cast<wchar_t>(code) : L'\uFFFD');
+            }
+            return result;
+        }
+#endif
 
         /// Escape a string for JSON output (includes surrounding quotes).
         inline std::string escape_json_string(std::string_view input)
@@ -647,7 +838,7 @@ namespace pnq
                 return true;
             if (a.size() < b.size())
                 return false;
-            return _strnicmp(a.data(), b.data(), b.size()) == 0;
+            return detail::compare_nocase(a.data(), b.data(), b.size()) == 0;
         }
 
         /// Parse hex string to uint32_t.
@@ -791,12 +982,14 @@ namespace pnq
             return slice(input.c_str(), start_index, stop_index);
         }
 
+#ifdef PNQ_PLATFORM_WINDOWS
         /// Convert from one codepage to UTF-8.
         inline std::string encode_as_utf8(std::string_view input_data, UINT input_codepage)
         {
             std::wstring wide = encode_as_utf16(input_data, input_codepage);
             return encode_as_utf8(wide);
         }
+#endif
 
     } // namespace string
 } // namespace pnq
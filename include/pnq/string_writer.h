@@ -1,5 +1,11 @@
 #pragma once
 
+#include <pnq/memory_tracking.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
 namespace pnq
 {
     namespace string
@@ -55,6 +61,7 @@ namespace pnq
                 assert(this != &source);
                 if (m_dynamic_buffer)
                 {
+                    PNQ_TRACK_FREE(memory::category::writer, m_dynamic_size);
                     free(m_dynamic_buffer);
                 }
 
@@ -104,7 +111,7 @@ namespace pnq
                 constexpr unsigned NIBBLES_PER_DWORD = 8;
                 constexpr unsigned DWORDS_PER_LINE = 5;
                 constexpr unsigned BYTES_PER_LINE = DWORDS_PER_LINE * 4;
-#ifdef _M_X64
+#if defined(_M_X64) || defined(__LP64__)
                 constexpr unsigned START_OF_DWORDS = 17; // first 8 chars are the address, followed by a single blank
                 constexpr unsigned START_OF_CTEXT = 17 + (DWORDS_PER_LINE * (NIBBLES_PER_DWORD + 1)) - 1;
 #else
@@ -130,10 +137,13 @@ namespace pnq
                 size_t bytesRemaining = size;
                 for (size_t line = 0; line < lines; ++line)
                 {
-#ifdef _M_X64
+#if defined(_M_X64)
                     static_cast<void>(sprintf_s(output, "%016p", address));
-#else
+#elif defined(_MSC_VER)
                     sprintf_s(output, "%08p", address);
+#else
+                    std::snprintf(output, sizeof(output), "%0*jX", static_cast<int>(START_OF_DWORDS - 1),
+                                  static_cast<std::uintmax_t>(reinterpret_cast<std::uintptr_t>(address)));
 #endif
                     memset(output + START_OF_DWORDS - 1, ' ', sizeof(output) - 1 - START_OF_DWORDS);
                     output[START_OF_DWORDS - 1] = ':';
@@ -193,6 +203,8 @@ namespace pnq
                     if (!np)
                         return false;
 
+                    PNQ_TRACK_FREE(memory::category::writer, m_dynamic_size);
+                    PNQ_TRACK_ALLOCATION(memory::category::writer, m_dynamic_size * 2);
                     m_dynamic_buffer = np;
                     m_dynamic_size *= 2;
                     m_dynamic_buffer[m_write_position++] = c;
@@ -202,6 +214,7 @@ namespace pnq
                 if (!np)
                     return false;
 
+                PNQ_TRACK_ALLOCATION(memory::category::writer, std::size(m_builtin_buffer) * 2);
                 memcpy(np, m_builtin_buffer, m_write_position);
                 m_dynamic_buffer = np;
                 m_dynamic_size = std::size(m_builtin_buffer) * 2;
@@ -309,6 +322,7 @@ namespace pnq
             {
                 if (m_dynamic_buffer)
                 {
+                    PNQ_TRACK_FREE(memory::category::writer, m_dynamic_size);
                     free(m_dynamic_buffer);
                     m_dynamic_buffer = nullptr;
                     m_dynamic_size = 0;
@@ -377,6 +391,8 @@ namespace pnq
                     if (!np)
                         return nullptr;
 
+                    PNQ_TRACK_FREE(memory::category::writer, m_dynamic_size);
+                    PNQ_TRACK_ALLOCATION(memory::category::writer, size_needed);
                     m_dynamic_buffer = np;
                     m_dynamic_size = size_needed;
                     return m_dynamic_buffer + m_write_position;
@@ -390,6 +406,7 @@ namespace pnq
                 if (!np)
                     return nullptr;
 
+                PNQ_TRACK_ALLOCATION(memory::category::writer, size_needed);
                 memcpy(np, m_builtin_buffer, m_write_position);
                 m_dynamic_buffer = np;
                 m_dynamic_size = size_needed;
@@ -411,6 +428,7 @@ namespace pnq
                     if (!m_dynamic_buffer)
                         return false;
 
+                    PNQ_TRACK_ALLOCATION(memory::category::writer, objectSrc.m_dynamic_size);
                     // but we need to copy only the used bytes
                     memcpy(m_dynamic_buffer, objectSrc.m_dynamic_buffer, objectSrc.m_write_position);
 
@@ -0,0 +1,455 @@
+#pragma once
+
+/// @file pnq/sync.h
+/// @brief Portable lightweight synchronization: mutex, auto-reset event, semaphore, reader/writer lock.
+///
+/// All primitives are a single 32-bit word (plus a waiter count) that threads park on with
+/// WaitOnAddress on Windows and futex on Linux; uncontended operations never enter the
+/// kernel. On other platforms they fall back to std::atomic::wait, and timed waits poll.
+///
+/// Unlike win32::CriticalSection and win32::EventSemaphore they are not recursive and cannot
+/// be shared between processes.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+
+#include <pnq/platform.h>
+
+#ifdef PNQ_PLATFORM_WINDOWS
+#include <Windows.h>
+#elif defined(PNQ_PLATFORM_LINUX)
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <thread>
+#endif
+
+#if defined(PNQ_ARCH_X64) || defined(PNQ_ARCH_X86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+#endif
+
+namespace pnq
+{
+    namespace sync
+    {
+        namespace detail
+        {
+            /// Tell the CPU we are spinning (lets the sibling hyperthread run).
+            inline void cpu_relax() noexcept
+            {
+#if defined(PNQ_ARCH_X64) || defined(PNQ_ARCH_X86)
+                _mm_pause();
+#elif defined(PNQ_ARCH_ARM64) && defined(_MSC_VER)
+                __yield();
+#elif defined(PNQ_ARCH_ARM64)
+                asm volatile("yield");
+#endif
+            }
+
+            /// Spin iterations before a contended lock parks the thread.
+            inline constexpr int spin_count = 100;
+
+            /// Sleep while word == expected, or until woken or timed out.
+            /// May return spuriously; callers re-check their condition.
+            /// @param timeout_ms relative timeout, negative for none
+            /// @return false if the timeout expired
+            inline bool wait(const std::atomic<std::uint32_t>& word, std::uint32_t expected, std::int64_t timeout_ms = -1) noexcept
+            {
+#ifdef PNQ_PLATFORM_WINDOWS
+                const DWORD timeout = timeout_ms < 0 ? INFINITE : static_cast<DWORD>(timeout_ms);
+                if (::WaitOnAddress(const_cast<std::atomic<std::uint32_t>*>(&word), &expected, sizeof(expected), timeout))
+                    return true;
+                return ::GetLastError() != ERROR_TIMEOUT;
+#elif defined(PNQ_PLATFORM_LINUX)
+                timespec ts{};
+                if (timeout_ms >= 0)
+                {
+                    ts.tv_sec = static_cast<time_t>(timeout_ms / 1000);
+                    ts.tv_nsec = static_cast<long>((timeout_ms % 1000) * 1'000'000);
+                }
+                const auto result = ::syscall(SYS_futex, &word, FUTEX_WAIT_PRIVATE, expected, timeout_ms < 0 ? nullptr : &ts, nullptr, 0);
+                return result == 0 || errno != ETIMEDOUT;
+#else
+                if (timeout_ms < 0)
+                {
+                    word.wait(expected, std::memory_order_acquire);
+                    return true;
+                }
+                if (word.load(std::memory_order_acquire) != expected)
+                    return true;
+                std::this_thread::sleep_for(std::chrono::milliseconds{std::min<std::int64_t>(timeout_ms, 1)});
+                return timeout_ms > 1;
+#endif
+            }
+
+            inline void wake_one(std::atomic<std::uint32_t>& word) noexcept
+            {
+#ifdef PNQ_PLATFORM_WINDOWS
+                ::WakeByAddressSingle(&word);
+#elif defined(PNQ_PLATFORM_LINUX)
+                ::syscall(SYS_futex, &word, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+                word.notify_one();
+#endif
+            }
+
+            inline void wake_all(std::atomic<std::uint32_t>& word) noexcept
+            {
+#ifdef PNQ_PLATFORM_WINDOWS
+                ::WakeByAddressAll(&word);
+#elif defined(PNQ_PLATFORM_LINUX)
+                ::syscall(SYS_futex, &word, FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#else
+                word.notify_all();
+#endif
+            }
+
+            /// Milliseconds left until deadline (0 once it has passed).
+            inline std::int64_t remaining_ms(std::chrono::steady_clock::time_point deadline)
+            {
+                const auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+                return left > 0 ? left : 0;
+            }
+        }
+
+        /// Non-recursive mutex that spins briefly before it parks.
+        /// Meets the Lockable requirements, so std::lock_guard and std::unique_lock work.
+        class Mutex final
+        {
+        public:
+            Mutex() = default;
+            ~Mutex() = default;
+
+            Mutex(const Mutex&) = delete;
+            Mutex& operator=(const Mutex&) = delete;
+            Mutex(Mutex&&) = delete;
+            Mutex& operator=(Mutex&&) = delete;
+
+            /// Acquires this mutex
+            void acquire()
+            {
+                std::uint32_t state = unlocked;
+                if (m_state.compare_exchange_strong(state, locked, std::memory_order_acquire, std::memory_order_relaxed))
+                    return;
+                acquire_contended();
+            }
+
+            /// Attempts to acquire this mutex without waiting.
+            /// @return true if it succeeds, false if it fails
+            bool try_acquire()
+            {
+                std::uint32_t state = unlocked;
+                return m_state.compare_exchange_strong(state, locked, std::memory_order_acquire, std::memory_order_relaxed);
+            }
+
+            /// Releases this mutex
+            void release()
+            {
+                if (m_state.exchange(unlocked, std::memory_order_release) == contended)
+                    detail::wake_one(m_state);
+            }
+
+            void lock() { acquire(); }
+            bool try_lock() { return try_acquire(); }
+            void unlock() { release(); }
+
+        private:
+            // "Futexes Are Tricky" (Drepper): the third state tells release() whether anyone sleeps
+            static constexpr std::uint32_t unlocked = 0;
+            static constexpr std::uint32_t locked = 1;
+            static constexpr std::uint32_t contended = 2;
+
+            void acquire_contended()
+            {
+                for (int i = 0; i < detail::spin_count; ++i)
+                {
+                    std::uint32_t state = m_state.load(std::memory_order_relaxed);
+                    if (state == unlocked &&
+                        m_state.compare_exchange_weak(state, locked, std::memory_order_acquire, std::memory_order_relaxed))
+                        return;
+                    if (state == contended)
+                        break;
+                    detail::cpu_relax();
+                }
+
+                // From here on we may have been a sleeper, so release() must always wake
+                while (m_state.exchange(contended, std::memory_order_acquire) != unlocked)
+                    detail::wait(m_state, contended);
+            }
+
+            std::atomic<std::uint32_t> m_state{unlocked};
+        };
+
+        /// Auto-reset event: set() releases exactly one waiter, or the next one to arrive.
+        class Event final
+        {
+        public:
+            /// @param initially_set start in the signaled state
+            explicit Event(bool initially_set = false)
+                : m_state{initially_set ? 1u : 0u}
+            {
+            }
+
+            ~Event() = default;
+
+            Event(const Event&) = delete;
+            Event& operator=(const Event&) = delete;
+            Event(Event&&) = delete;
+            Event& operator=(Event&&) = delete;
+
+            /// Wait until the event is set, and reset it.
+            bool wait()
+            {
+                while (!try_consume())
+                    park(-1);
+                return true;
+            }
+
+            /// Wait until the event is set, and reset it.
+            /// @return false if the timeout expired first
+            bool wait_with_timeout(std::chrono::milliseconds timespan)
+            {
+                const auto deadline = std::chrono::steady_clock::now() + timespan;
+                while (!try_consume())
+                {
+                    const auto left = detail::remaining_ms(deadline);
+                    if (!left)
+                        return false;
+                    park(left);
+                }
+                return true;
+            }
+
+            /// Resets this event
+            void reset()
+            {
+                m_state.store(0, std::memory_order_relaxed);
+            }
+
+            /// Sets this event
+            void set()
+            {
+                if (m_state.exchange(1, std::memory_order_seq_cst) == 0 && m_waiters.load(std::memory_order_seq_cst))
+                    detail::wake_one(m_state);
+            }
+
+        private:
+            bool try_consume()
+            {
+                return m_state.exchange(0, std::memory_order_acquire) == 1;
+            }
+
+            void park(std::int64_t timeout_ms)
+            {
+                m_waiters.fetch_add(1, std::memory_order_seq_cst);
+                detail::wait(m_state, 0, timeout_ms);
+                m_waiters.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            std::atomic<std::uint32_t> m_state;
+            std::atomic<std::uint32_t> m_waiters{0};
+        };
+
+        /// Counting semaphore.
+        class Semaphore final
+        {
+        public:
+            explicit Semaphore(std::uint32_t initial_count = 0)
+                : m_count{initial_count}
+            {
+            }
+
+            ~Semaphore() = default;
+
+            Semaphore(const Semaphore&) = delete;
+            Semaphore& operator=(const Semaphore&) = delete;
+            Semaphore(Semaphore&&) = delete;
+            Semaphore& operator=(Semaphore&&) = delete;
+
+            /// Wait until the count is positive, then decrement it.
+            void acquire()
+            {
+                // No spinning: a semaphore usually hands work to a thread that has to run first
+                while (!try_acquire())
+                    park(-1);
+            }
+
+            /// Decrement the count if it is positive.
+            /// @return true if it succeeds, false if it fails
+            bool try_acquire()
+            {
+                auto count = m_count.load(std::memory_order_relaxed);
+                while (count)
+                {
+                    if (m_count.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed))
+                        return true;
+                }
+                return false;
+            }
+
+            /// @return false if the timeout expired before the count could be decremented
+            bool try_acquire_for(std::chrono::milliseconds timespan)
+            {
+                const auto deadline = std::chrono::steady_clock::now() + timespan;
+                while (!try_acquire())
+                {
+                    const auto left = detail::remaining_ms(deadline);
+                    if (!left)
+                        return false;
+                    park(left);
+                }
+                return true;
+            }
+
+            /// Increment the count by update and wake as many waiters.
+            void release(std::uint32_t update = 1)
+            {
+                m_count.fetch_add(update, std::memory_order_seq_cst);
+                if (!m_waiters.load(std::memory_order_seq_cst))
+                    return;
+                if (update == 1)
+                    detail::wake_one(m_count);
+                else
+                    detail::wake_all(m_count);
+            }
+
+        private:
+            void park(std::int64_t timeout_ms)
+            {
+                m_waiters.fetch_add(1, std::memory_order_seq_cst);
+                detail::wait(m_count, 0, timeout_ms);
+                m_waiters.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            std::atomic<std::uint32_t> m_count;
+            std::atomic<std::uint32_t> m_waiters{0};
+        };
+
+        /// Non-recursive reader/writer lock that prefers writers: once a writer waits, new
+        /// readers queue behind it. Meets the SharedLockable requirements, so std::shared_lock
+        /// and std::unique_lock work.
+        class SharedMutex final
+        {
+        public:
+            SharedMutex() = default;
+            ~SharedMutex() = default;
+
+            SharedMutex(const SharedMutex&) = delete;
+            SharedMutex& operator=(const SharedMutex&) = delete;
+            SharedMutex(SharedMutex&&) = delete;
+            SharedMutex& operator=(SharedMutex&&) = delete;
+
+            /// Acquire exclusive (write) access
+            void lock()
+            {
+                for (int i = 0;; ++i)
+                {
+                    auto state = m_state.load(std::memory_order_relaxed);
+                    if (!(state & (writer | reader_mask)))
+                    {
+                        // Also clears writer_waiting: other waiting writers set it again when they retry
+                        if (m_state.compare_exchange_weak(state, writer, std::memory_order_acquire, std::memory_order_relaxed))
+                            return;
+                        continue;
+                    }
+                    if (!(state & writer_waiting))
+                    {
+                        if (!m_state.compare_exchange_weak(state, state | writer_waiting, std::memory_order_relaxed))
+                            continue;
+                        state |= writer_waiting;
+                    }
+                    if (i < detail::spin_count)
+                        detail::cpu_relax();
+                    else
+                        park(state);
+                }
+            }
+
+            bool try_lock()
+            {
+                auto state = m_state.load(std::memory_order_relaxed);
+                return !(state & (writer | reader_mask)) &&
+                    m_state.compare_exchange_strong(state, writer, std::memory_order_acquire, std::memory_order_relaxed);
+            }
+
+            void unlock()
+            {
+                m_state.store(0, std::memory_order_seq_cst);
+                wake();
+            }
+
+            /// Acquire shared (read) access
+            void lock_shared()
+            {
+                for (int i = 0;; ++i)
+                {
+                    auto state = m_state.load(std::memory_order_relaxed);
+                    if (!(state & (writer | writer_waiting)))
+                    {
+                        if (m_state.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                            return;
+                        continue;
+                    }
+                    if (i < detail::spin_count)
+                        detail::cpu_relax();
+                    else
+                        park(state);
+                }
+            }
+
+            bool try_lock_shared()
+            {
+                auto state = m_state.load(std::memory_order_relaxed);
+                while (!(state & (writer | writer_waiting)))
+                {
+                    if (m_state.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                        return true;
+                }
+                return false;
+            }
+
+            void unlock_shared()
+            {
+                const auto state = m_state.fetch_sub(1, std::memory_order_seq_cst);
+
+                // Only the last reader can let a writer in
+                if ((state & reader_mask) == 1 && (state & writer_waiting))
+                    wake();
+            }
+
+        private:
+            static constexpr std::uint32_t writer = 0x80000000u;
+            static constexpr std::uint32_t writer_waiting = 0x40000000u;
+            static constexpr std::uint32_t reader_mask = 0x3FFFFFFFu;
+
+            void park(std::uint32_t state)
+            {
+                m_waiters.fetch_add(1, std::memory_order_seq_cst);
+                if (m_state.load(std::memory_order_seq_cst) == state)
+                    detail::wait(m_state, state);
+                m_waiters.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            /// Readers and writers wait for different changes of the word, so wake everyone
+            void wake()
+            {
+                if (m_waiters.load(std::memory_order_seq_cst))
+                    detail::wake_all(m_state);
+            }
+
+            std::atomic<std::uint32_t> m_state{0};
+            std::atomic<std::uint32_t> m_waiters{0};
+        };
+    }
+}
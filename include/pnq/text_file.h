@@ -3,6 +3,7 @@
 #include <string>
 #include <pnq/platform.h>
 #include <pnq/binary_file.h>
+#include <pnq/mapped_file.h>
 #include <pnq/string.h>
 
 #ifdef PNQ_PLATFORM_WINDOWS
@@ -16,6 +17,9 @@ namespace pnq
         constexpr uint8_t UTF16LE_BOM[] = {0xFF, 0xFE};
         constexpr uint8_t UTF8_BOM[] = {0xEF, 0xBB, 0xBF};
 
+        /// Smallest file read_auto() maps instead of reading; below it the mapping costs more than the copy.
+        constexpr size_t map_threshold = 256 * 1024;
+
         /// Get the platform-native line ending.
         constexpr const char* line_ending()
         {
@@ -33,20 +37,18 @@ namespace pnq
             std::string result;
             result.reserve(text.size());
 
-            for (size_t i = 0; i < text.size(); ++i)
+            // Copy whole runs between carriage returns instead of one char at a time
+            size_t start = 0;
+            for (size_t pos = text.find('\r'); pos != std::string_view::npos; pos = text.find('\r', start))
             {
-                if (text[i] == '\r')
-                {
-                    result += '\n';
-                    // Skip following \n if present (CRLF -> LF)
-                    if (i + 1 < text.size() && text[i + 1] == '\n')
-                        ++i;
-                }
-                else
-                {
-                    result += text[i];
-                }
+                result.append(text, start, pos - start);
+                result += '\n';
+                start = pos + 1;
+                // Skip following \n if present (CRLF -> LF)
+                if (start < text.size() && text[start] == '\n')
+                    ++start;
             }
+            result.append(text, start);
             return result;
         }
 
@@ -71,37 +73,71 @@ namespace pnq
 #endif
         }
 
-        /// Read a text file, auto-detecting encoding via BOM.
-        /// Converts UTF-16LE to UTF-8 if needed. Files without BOM are assumed UTF-8.
-        /// Line endings are normalized to LF (\n).
-        /// @param filename path to the file
+        /// Decode raw text file contents, auto-detecting encoding via BOM.
+        /// Converts UTF-16LE to UTF-8 if needed. Data without BOM is assumed UTF-8.
+        /// UTF-8 input is copied exactly once, straight from data into the result.
+        /// @param data raw file contents
         /// @param normalize_lines if true (default), normalize line endings to LF
-        /// @return file contents as UTF-8 string, or empty on failure
-        inline std::string read_auto(std::string_view filename, bool normalize_lines = true)
+        /// @return contents as UTF-8 string
+        inline std::string decode(const memory_view &data, bool normalize_lines = true)
         {
-            bytes data;
-            if (!BinaryFile::read(filename, data))
-                return {};
-
-            std::string result;
+            std::string_view utf8;
+            std::string converted;
             if (data.size() >= 3 && memcmp(data.data(), UTF8_BOM, 3) == 0)
             {
                 // UTF-8 with BOM - skip BOM
-                result = std::string(reinterpret_cast<const char *>(data.data() + 3), data.size() - 3);
+                utf8 = std::string_view(reinterpret_cast<const char *>(data.data() + 3), data.size() - 3);
             }
             else if (data.size() >= 2 && memcmp(data.data(), UTF16LE_BOM, 2) == 0)
             {
                 // UTF-16LE - convert to UTF-8
-                std::wstring_view wide(reinterpret_cast<const wchar_t *>(data.data() + 2), (data.size() - 2) / sizeof(wchar_t));
-                result = string::encode_as_utf8(wide);
+                std::basic_string_view<char16> wide(reinterpret_cast<const char16 *>(data.data() + 2), (data.size() - 2) / sizeof(char16));
+                converted = string::encode_as_utf8(wide);
+                if (!normalize_lines)
+                    return converted;
+                utf8 = converted;
             }
             else
             {
                 // No BOM - assume UTF-8
-                result = std::string(reinterpret_cast<const char *>(data.data()), data.size());
+                utf8 = std::string_view(reinterpret_cast<const char *>(data.data()), data.size());
             }
 
-            return normalize_lines ? normalize_line_endings(result) : result;
+            return normalize_lines ? normalize_line_endings(utf8) : std::string(utf8);
+        }
+
+        /// Read a text file, auto-detecting encoding via BOM.
+        /// Converts UTF-16LE to UTF-8 if needed. Files without BOM are assumed UTF-8.
+        /// Line endings are normalized to LF (\n).
+        /// Files of at least map_threshold bytes on a local disk are memory-mapped and decoded in
+        /// place; others are read into a buffer, so a failing network share or removable drive
+        /// makes the call fail instead of faulting on a mapped page.
+        /// @param filename path to the file
+        /// @param normalize_lines if true (default), normalize line endings to LF
+        /// @return file contents as UTF-8 string, or empty on failure
+        inline std::string read_auto(std::string_view filename, bool normalize_lines = true)
+        {
+            BinaryFile input;
+            if (!input.open_for_reading(filename, file_options::sequential))
+                return {};
+
+            const auto size = static_cast<size_t>(input.get_file_size());
+            if (size >= map_threshold && MappedFile::is_local(filename))
+            {
+                MappedFile file;
+                if (file.open(filename))
+                {
+                    file.advise(map_advice::sequential);
+                    return decode(file.view(), normalize_lines);
+                }
+            }
+
+            bytes data(size);
+            size_t bytes_read = 0;
+            if (!input.read_at(0, data.data(), size, bytes_read))
+                return {};
+            data.resize(bytes_read);
+            return decode(memory_view{data}, normalize_lines);
         }
 
         /// Create a UTF-8 encoded text file, optionally including a BOM.
@@ -116,17 +152,19 @@ namespace pnq
             if (!output.create_for_writing(filename))
                 return false;
 
-            if (include_bom)
-            {
-                output.write({UTF8_BOM, std::size(UTF8_BOM)});
-            }
-
+            std::string converted;
             if (use_platform_line_endings)
             {
-                std::string converted = to_platform_line_endings(text);
-                return output.write(std::string_view{converted});
+                converted = to_platform_line_endings(text);
+                text = converted;
             }
-            return output.write(text);
+
+            // BOM and text go out in a single gather write
+            const memory_view fragments[] = {
+                memory_view{UTF8_BOM, include_bom ? std::size(UTF8_BOM) : 0},
+                memory_view{text},
+            };
+            return output.write(std::span<const memory_view>{fragments});
         }
 
 #ifdef PNQ_PLATFORM_WINDOWS
@@ -160,11 +198,11 @@ namespace pnq
             if (!output.create_for_writing(filename))
                 return false;
 
-            if (include_bom)
-            {
-                output.write({UTF16LE_BOM, std::size(UTF16LE_BOM)});
-            }
-            return output.write(memory_view{reinterpret_cast<const BYTE *>(text.data()), text.length() * sizeof(WCHAR)});
+            const memory_view fragments[] = {
+                memory_view{UTF16LE_BOM, include_bom ? std::size(UTF16LE_BOM) : 0},
+                memory_view{reinterpret_cast<const BYTE *>(text.data()), text.length() * sizeof(WCHAR)},
+            };
+            return output.write(std::span<const memory_view>{fragments});
         }
 #endif // PNQ_PLATFORM_WINDOWS
     } // namespace text_file
@@ -0,0 +1,465 @@
+#pragma once
+
+/// @file pnq/thread_pool.h
+/// @brief Portable work-stealing thread pool, task groups and parallel loops.
+///
+/// @code
+/// auto& pool = pnq::ThreadPool::shared();
+///
+/// pnq::parallel_for(pool, size_t{0}, files.size(), [&](size_t i) {
+///     results[i] = parse(files[i]);
+/// });
+///
+/// const auto total = pnq::parallel_reduce(pool, size_t{0}, keys.size(), size_t{0},
+///     [&](size_t i) { return keys[i]->values().size(); },
+///     std::plus<>{});
+/// @endcode
+///
+/// Each worker owns a deque: it pushes and pops its own tasks at the back and, when that runs
+/// dry, steals from the front of the other workers' deques. Tasks submitted from outside the
+/// pool go to a shared injection queue. A thread waiting for a TaskGroup runs queued tasks
+/// instead of blocking, so parallel loops can be nested.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <pnq/log.h>
+
+namespace pnq
+{
+    /// Fixed-size pool of worker threads with per-worker deques and work stealing.
+    class ThreadPool final
+    {
+    public:
+        using Task = std::function<void()>;
+
+        /// @param thread_count number of workers; 0 means one per hardware thread
+        explicit ThreadPool(size_t thread_count = 0)
+        {
+            if (!thread_count)
+                thread_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+            m_workers.reserve(thread_count);
+            for (size_t i = 0; i < thread_count; ++i)
+                m_workers.push_back(std::make_unique<Worker>());
+
+            // Start only once all deques exist: workers steal from each other right away
+            for (size_t i = 0; i < thread_count; ++i)
+                m_workers[i]->thread = std::thread{[this, i] { run(i); }};
+        }
+
+        /// Runs all queued tasks, then joins the workers.
+        ~ThreadPool()
+        {
+            m_stopping.store(true, std::memory_order_seq_cst);
+            signal();
+            for (auto& worker : m_workers)
+                worker->thread.join();
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ThreadPool(ThreadPool&&) = delete;
+        ThreadPool& operator=(ThreadPool&&) = delete;
+
+        /// Pool shared by pnq's parallel modes and by callers that don't need their own.
+        static ThreadPool& shared()
+        {
+            static ThreadPool pool;
+            return pool;
+        }
+
+        /// Number of worker threads.
+        size_t size() const
+        {
+            return m_workers.size();
+        }
+
+        /// Check if the calling thread is one of this pool's workers.
+        bool is_worker_thread() const
+        {
+            return current_worker() != nullptr;
+        }
+
+        /// Queue a task. Exceptions escaping it are logged and dropped; use a TaskGroup to
+        /// get them back.
+        void submit(Task task)
+        {
+            if (auto* worker = current_worker())
+            {
+                std::lock_guard lock{worker->mutex};
+                worker->tasks.push_back(std::move(task));
+            }
+            else
+            {
+                std::lock_guard lock{m_injection_mutex};
+                m_injection.push_back(std::move(task));
+            }
+            signal();
+        }
+
+        /// Run one queued task on the calling thread.
+        /// @return true if a task was run, false if all queues were empty
+        bool run_one()
+        {
+            Task task;
+            if (!take(task))
+                return false;
+
+            try
+            {
+                task();
+            }
+            catch (const std::exception& e)
+            {
+                PNQ_LOG_ERROR("Unhandled exception in thread pool task: {}", e.what());
+            }
+            catch (...)
+            {
+                PNQ_LOG_ERROR("Unhandled exception in thread pool task");
+            }
+            return true;
+        }
+
+    private:
+        friend class TaskGroup;
+
+        /// Run queued tasks until done() returns true; sleep while there is nothing to run.
+        /// done() is only re-checked after a submit() or notify_waiters(), so whatever makes
+        /// it true must call one of them.
+        template <typename Predicate>
+        void help_until(Predicate&& done)
+        {
+            while (!done())
+            {
+                if (run_one())
+                    continue;
+
+                m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+                const auto epoch = m_epoch.load(std::memory_order_seq_cst);
+                if (!done() && !has_work())
+                    m_epoch.wait(epoch, std::memory_order_seq_cst);
+                m_sleeping.fetch_sub(1, std::memory_order_seq_cst);
+            }
+        }
+
+        /// Wake threads sleeping in help_until() so they re-check their condition.
+        void notify_waiters()
+        {
+            signal();
+        }
+
+        /// Padded so that workers locking their own deque don't share cache lines.
+        struct alignas(64) Worker
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+            std::thread thread;
+        };
+
+        struct CurrentWorker
+        {
+            const ThreadPool* pool;
+            Worker* worker;
+            size_t index;
+        };
+
+        static CurrentWorker& current()
+        {
+            thread_local CurrentWorker current{nullptr, nullptr, 0};
+            return current;
+        }
+
+        Worker* current_worker() const
+        {
+            const auto& cw = current();
+            return cw.pool == this ? cw.worker : nullptr;
+        }
+
+        void run(size_t index)
+        {
+            current() = {this, m_workers[index].get(), index};
+            help_until([this] {
+                // Only stop once the queues are drained
+                return m_stopping.load(std::memory_order_seq_cst) && !has_work();
+            });
+        }
+
+        /// Own deque (newest first), then the injection queue, then steal (oldest first).
+        bool take(Task& task)
+        {
+            const auto& cw = current();
+            const bool is_own = cw.pool == this;
+            if (is_own)
+            {
+                std::lock_guard lock{cw.worker->mutex};
+                if (!cw.worker->tasks.empty())
+                {
+                    task = std::move(cw.worker->tasks.back());
+                    cw.worker->tasks.pop_back();
+                    return true;
+                }
+            }
+
+            {
+                std::lock_guard lock{m_injection_mutex};
+                if (!m_injection.empty())
+                {
+                    task = std::move(m_injection.front());
+                    m_injection.pop_front();
+                    return true;
+                }
+            }
+
+            const size_t count = m_workers.size();
+            const size_t first = is_own ? cw.index + 1 : 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto& victim = *m_workers[(first + i) % count];
+                if (&victim == cw.worker)
+                    continue;
+
+                std::lock_guard lock{victim.mutex};
+                if (!victim.tasks.empty())
+                {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool has_work()
+        {
+            {
+                std::lock_guard lock{m_injection_mutex};
+                if (!m_injection.empty())
+                    return true;
+            }
+            for (auto& worker : m_workers)
+            {
+                std::lock_guard lock{worker->mutex};
+                if (!worker->tasks.empty())
+                    return true;
+            }
+            return false;
+        }
+
+        void signal()
+        {
+            m_epoch.fetch_add(1, std::memory_order_seq_cst);
+            if (m_sleeping.load(std::memory_order_seq_cst))
+                m_epoch.notify_all();
+        }
+
+        std::vector<std::unique_ptr<Worker>> m_workers;
+        std::mutex m_injection_mutex;
+        std::deque<Task> m_injection;
+
+        /// Bumped on every submit() and notify_waiters(); sleepers wait for it to change
+        std::atomic<std::uint32_t> m_epoch{0};
+        std::atomic<std::uint32_t> m_sleeping{0};
+        std::atomic<bool> m_stopping{false};
+    };
+
+    /// Set of tasks that can be waited for and cancelled together.
+    ///
+    /// The first exception thrown by a task cancels the group and is rethrown by wait().
+    class TaskGroup final
+    {
+    public:
+        explicit TaskGroup(ThreadPool& pool = ThreadPool::shared())
+            : m_pool{pool}
+        {
+        }
+
+        /// Waits for outstanding tasks; their exceptions are dropped.
+        ~TaskGroup()
+        {
+            m_pool.help_until([this] { return is_done(); });
+        }
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+        TaskGroup(TaskGroup&&) = delete;
+        TaskGroup& operator=(TaskGroup&&) = delete;
+
+        /// Queue a task. It is skipped if the group is cancelled before it starts.
+        template <typename F>
+        void run(F&& task)
+        {
+            m_pending.fetch_add(1, std::memory_order_relaxed);
+            m_pool.submit([this, task = std::forward<F>(task)]() mutable {
+                if (!is_cancelled())
+                {
+                    try
+                    {
+                        task();
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard lock{m_mutex};
+                        if (!m_exception)
+                            m_exception = std::current_exception();
+                        cancel();
+                    }
+                }
+                // The group may be gone as soon as the count reaches zero
+                auto& pool = m_pool;
+                if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    pool.notify_waiters();
+            });
+        }
+
+        /// Skip all tasks of this group that have not started yet.
+        /// Running tasks can poll is_cancelled() to stop early.
+        void cancel()
+        {
+            m_cancelled.store(true, std::memory_order_relaxed);
+        }
+
+        bool is_cancelled() const
+        {
+            return m_cancelled.load(std::memory_order_relaxed);
+        }
+
+        /// Wait for all tasks, running queued tasks of the pool on this thread meanwhile.
+        /// Rethrows the first exception thrown by a task.
+        /// @return true if the group ran to completion, false if it was cancelled
+        bool wait()
+        {
+            m_pool.help_until([this] { return is_done(); });
+
+            std::exception_ptr exception;
+            {
+                std::lock_guard lock{m_mutex};
+                exception = std::exchange(m_exception, nullptr);
+            }
+            if (exception)
+                std::rethrow_exception(exception);
+            return !is_cancelled();
+        }
+
+    private:
+        bool is_done() const
+        {
+            return m_pending.load(std::memory_order_acquire) == 0;
+        }
+
+        ThreadPool& m_pool;
+        std::atomic<size_t> m_pending{0};
+        std::atomic<bool> m_cancelled{false};
+        std::mutex m_mutex;
+        std::exception_ptr m_exception;
+    };
+
+    namespace detail
+    {
+        /// Split [first, last) into chunks of at least grain indices, a few per worker.
+        template <typename Index>
+        Index parallel_chunk_size(const ThreadPool& pool, Index first, Index last, size_t grain)
+        {
+            const auto count = static_cast<size_t>(last - first);
+            const auto chunks = std::max<size_t>(1, pool.size() * 4);
+            return static_cast<Index>(std::max<size_t>({1, grain, (count + chunks - 1) / chunks}));
+        }
+    }
+
+    /// Call body(i) for every i in [first, last), in parallel.
+    ///
+    /// If body returns bool, returning false stops the loop: iterations that have not started
+    /// are skipped.
+    /// @param grain minimum number of indices per task (0 chooses automatically)
+    /// @return false if the loop was stopped by body
+    template <typename Index, typename Body>
+        requires std::is_integral_v<Index>
+    bool parallel_for(ThreadPool& pool, Index first, Index last, Body&& body, size_t grain = 0)
+    {
+        if (first >= last)
+            return true;
+
+        const auto chunk = detail::parallel_chunk_size(pool, first, last, grain);
+        TaskGroup group{pool};
+        for (Index begin = first; begin < last;)
+        {
+            const Index end = (last - begin > chunk) ? static_cast<Index>(begin + chunk) : last;
+            group.run([&group, &body, begin, end] {
+                for (Index i = begin; i < end && !group.is_cancelled(); ++i)
+                {
+                    if constexpr (std::is_same_v<std::invoke_result_t<Body&, Index>, bool>)
+                    {
+                        if (!body(i))
+                            group.cancel();
+                    }
+                    else
+                    {
+                        body(i);
+                    }
+                }
+            });
+            begin = end;
+        }
+        return group.wait();
+    }
+
+    /// Call body(element) for every element of a random-access range, in parallel.
+    /// @see parallel_for
+    template <typename Range, typename Body>
+    bool parallel_for_each(ThreadPool& pool, Range&& range, Body&& body, size_t grain = 0)
+    {
+        auto begin = std::begin(range);
+        const auto count = static_cast<size_t>(std::end(range) - begin);
+        return parallel_for(pool, size_t{0}, count, [&](size_t i) { return body(begin[i]); }, grain);
+    }
+
+    /// Combine transform(i) for every i in [first, last) with reduce, in parallel.
+    ///
+    /// reduce must be associative; it need not be commutative, since chunk results are combined
+    /// in index order. The result is therefore the same for every pool size as long as reduce
+    /// is exact (for floating point it can differ in the last bits).
+    /// @param identity neutral element of reduce
+    template <typename Index, typename T, typename Transform, typename Reduce>
+        requires std::is_integral_v<Index>
+    T parallel_reduce(ThreadPool& pool, Index first, Index last, T identity, Transform&& transform, Reduce&& reduce,
+        size_t grain = 0)
+    {
+        if (first >= last)
+            return identity;
+
+        const auto chunk = detail::parallel_chunk_size(pool, first, last, grain);
+        const auto chunk_count = (static_cast<size_t>(last - first) + static_cast<size_t>(chunk) - 1) / static_cast<size_t>(chunk);
+        std::vector<T> partial(chunk_count, identity);
+
+        TaskGroup group{pool};
+        for (size_t c = 0; c < chunk_count; ++c)
+        {
+            group.run([&, c] {
+                const Index begin = static_cast<Index>(first + static_cast<Index>(c) * chunk);
+                const Index end = (last - begin > chunk) ? static_cast<Index>(begin + chunk) : last;
+                T result = identity;
+                for (Index i = begin; i < end; ++i)
+                    result = reduce(std::move(result), transform(i));
+                partial[c] = std::move(result);
+            });
+        }
+        group.wait();
+
+        T result = std::move(identity);
+        for (auto& value : partial)
+            result = reduce(std::move(result), std::move(value));
+        return result;
+    }
+}
@@ -0,0 +1,95 @@
+// Built with PNQ_USE_BINARY_LOG, so PNQ_LOG_* statements go through pnq::logging::binary.
+#include <catch2/catch_test_macros.hpp>
+#include <pnq/pnq.h>
+#include <pnq/binary_log_decoder.h>
+
+#include <sstream>
+
+#ifndef PNQ_USE_QUILL
+#include <spdlog/sinks/ostream_sink.h>
+#endif
+
+#ifndef PNQ_USE_BINARY_LOG
+#error "test_binary_log.cpp needs PNQ_USE_BINARY_LOG"
+#endif
+
+TEST_CASE("PNQ_LOG_* through the binary logger", "[logging]") {
+    namespace logging = pnq::logging;
+    namespace binary = pnq::logging::binary;
+
+    wchar_t temp_path[MAX_PATH];
+    GetTempPathW(MAX_PATH, temp_path);
+    std::string filename = pnq::string::encode_as_utf8(std::wstring{temp_path} + L"pnq_test_binary_macros.blog");
+
+    logging::initialize_logging("pnq_binary_log_tests");
+    REQUIRE(binary::start(filename, 4096));
+
+    SECTION("statements are recorded and follow logging::set_level") {
+        PNQ_LOG_INFO("recorded {} {}", 1, "info");
+        logging::set_level(logging::level::warn);
+        PNQ_LOG_INFO("below the level {}", 2);
+        PNQ_LOG_WARN("recorded {} {}", 3, "warning");
+        logging::set_level(logging::level::debug);
+        PNQ_LOG_DEBUG("recorded {} {}", 4, "debug");
+        binary::stop();
+
+        std::vector<std::string> texts;
+        REQUIRE(binary::decode(filename, [&](const binary::Message& message) { texts.push_back(message.text); }));
+        REQUIRE(texts == std::vector<std::string>{"recorded 1 info", "recorded 3 warning", "recorded 4 debug"});
+    }
+
+#ifndef PNQ_USE_QUILL
+    SECTION("a full ring does not block after stop") {
+        // Count what reaches the regular backend once the binary logger is stopped
+        std::ostringstream output;
+        auto sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(output);
+        sink->set_formatter(std::make_unique<spdlog::pattern_formatter>("%v", spdlog::pattern_time_type::local, "\n"));
+        spdlog::set_default_logger(std::make_shared<spdlog::logger>("pnq_binary_log_tests", sink));
+
+        constexpr int thread_count = 4;
+        constexpr int message_count = 2000;
+        const auto dropped_before = binary::dropped();
+        std::atomic<int> started{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < thread_count; ++t) {
+            threads.emplace_back([t, &started] {
+                for (int i = 0; i < message_count; ++i) {
+                    PNQ_LOG_INFO("thread {} message {} {}", t, i, std::string(100, 'x'));
+                    if (i == 0)
+                        ++started;
+                }
+            });
+        }
+        // Stop while the threads are logging
+        while (started < thread_count)
+            std::this_thread::yield();
+        binary::stop();
+        for (auto& thread : threads)
+            thread.join();
+
+        // Every statement went into the file, was dropped, or went to the regular backend
+        size_t recorded = 0;
+        std::uint64_t reported = 0;
+        REQUIRE(binary::decode(filename, [&](const binary::Message& message) {
+            if (message.text.ends_with(" statements dropped"))
+                reported += std::stoull(message.text);
+            else
+                ++recorded;
+        }));
+        const auto dropped = binary::dropped() - dropped_before;
+        REQUIRE(reported == dropped);
+
+        size_t forwarded = 0;
+        std::istringstream lines{output.str()};
+        for (std::string line; std::getline(lines, line);)
+            if (line.starts_with("thread "))
+                ++forwarded;
+        REQUIRE(recorded + dropped + forwarded == thread_count * message_count);
+
+        logging::initialize_logging("pnq_binary_log_tests");
+    }
+#endif
+
+    binary::stop();
+    pnq::file::remove(filename);
+}
@@ -0,0 +1,379 @@
+// Tests for the portable concurrency headers; built into the Windows and the POSIX test runners.
+#include <catch2/catch_test_macros.hpp>
+#include <pnq/bounded_queue.h>
+#include <pnq/sync.h>
+#include <pnq/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("ThreadPool", "[thread_pool]") {
+    pnq::ThreadPool pool{4};
+    REQUIRE(pool.size() == 4);
+    REQUIRE_FALSE(pool.is_worker_thread());
+
+    SECTION("parallel_for visits every index once") {
+        std::vector<std::atomic<int>> hits(10007);
+        REQUIRE(pnq::parallel_for(pool, size_t{0}, hits.size(), [&](size_t i) { hits[i]++; }));
+        REQUIRE(std::all_of(hits.begin(), hits.end(), [](const auto& hit) { return hit == 1; }));
+    }
+
+    SECTION("parallel_for stops when body returns false") {
+        std::atomic<int> calls{0};
+        REQUIRE_FALSE(pnq::parallel_for(pool, 0, 100000, [&](int i) {
+            calls++;
+            return i < 10;
+        }, 1));
+        REQUIRE(calls < 100000);
+    }
+
+    SECTION("parallel_for_each") {
+        std::vector<int> values(1000, 1);
+        REQUIRE(pnq::parallel_for_each(pool, values, [](int& value) { value *= 2; }));
+        REQUIRE(std::count(values.begin(), values.end(), 2) == 1000);
+    }
+
+    SECTION("parallel_reduce keeps index order") {
+        const auto sum = pnq::parallel_reduce(pool, 0, 100000, std::uint64_t{0},
+            [](int i) { return static_cast<std::uint64_t>(i); }, std::plus<>{});
+        REQUIRE(sum == 4999950000ull);
+
+        const auto text = pnq::parallel_reduce(pool, 0, 260, std::string{},
+            [](int i) { return std::string(1, static_cast<char>('a' + i % 26)); },
+            [](std::string a, const std::string& b) { return a + b; });
+        REQUIRE(text.size() == 260);
+        REQUIRE(text.starts_with("abcdefghijklmnopqrstuvwxyzabc"));
+        REQUIRE(text.ends_with("xyz"));
+    }
+
+    SECTION("nested loops don't deadlock") {
+        std::atomic<int> count{0};
+        pnq::parallel_for(pool, 0, 50, [&](int) {
+            pnq::parallel_for(pool, 0, 50, [&](int) { count++; });
+        });
+        REQUIRE(count == 2500);
+    }
+
+    SECTION("TaskGroup rethrows the first exception") {
+        pnq::TaskGroup group{pool};
+        for (int i = 0; i < 100; ++i)
+            group.run([i] {
+                if (i == 42)
+                    throw std::runtime_error("task failed");
+            });
+        REQUIRE_THROWS_AS(group.wait(), std::runtime_error);
+        REQUIRE(group.is_cancelled());
+    }
+
+    SECTION("cancelled TaskGroup skips queued tasks") {
+        pnq::TaskGroup group{pool};
+        group.cancel();
+        std::atomic<int> count{0};
+        for (int i = 0; i < 10; ++i)
+            group.run([&] { count++; });
+        REQUIRE_FALSE(group.wait());
+        REQUIRE(count == 0);
+    }
+}
+
+TEST_CASE("sync primitives", "[sync]") {
+    namespace sync = pnq::sync;
+    using namespace std::chrono_literals;
+
+    const auto run_threads = [](int count, auto&& body) {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < count; ++i)
+            threads.emplace_back([&body, i] { body(i); });
+        for (auto& thread : threads)
+            thread.join();
+    };
+
+    SECTION("Mutex") {
+        sync::Mutex mutex;
+        REQUIRE(mutex.try_acquire());
+        REQUIRE_FALSE(mutex.try_acquire());
+        mutex.release();
+
+        std::uint64_t counter = 0;
+        run_threads(4, [&](int) {
+            for (int i = 0; i < 20000; ++i)
+            {
+                std::lock_guard lock{mutex};
+                ++counter;
+            }
+        });
+        REQUIRE(counter == 80000);
+    }
+
+    SECTION("Event is auto-reset") {
+        sync::Event event;
+        REQUIRE_FALSE(event.wait_with_timeout(10ms));
+        event.set();
+        event.set();
+        REQUIRE(event.wait_with_timeout(0ms));
+        REQUIRE_FALSE(event.wait_with_timeout(10ms));
+
+        sync::Event initially_set{true};
+        REQUIRE(initially_set.wait());
+        initially_set.set();
+        initially_set.reset();
+        REQUIRE_FALSE(initially_set.wait_with_timeout(0ms));
+
+        // Ping-pong between two threads
+        sync::Event ping, pong;
+        std::thread partner{[&] {
+            for (int i = 0; i < 1000; ++i)
+            {
+                ping.wait();
+                pong.set();
+            }
+        }};
+        for (int i = 0; i < 1000; ++i)
+        {
+            ping.set();
+            REQUIRE(pong.wait_with_timeout(10s));
+        }
+        partner.join();
+    }
+
+    SECTION("Semaphore") {
+        sync::Semaphore semaphore{2};
+        REQUIRE(semaphore.try_acquire());
+        REQUIRE(semaphore.try_acquire());
+        REQUIRE_FALSE(semaphore.try_acquire());
+        REQUIRE_FALSE(semaphore.try_acquire_for(10ms));
+
+        // At most three threads inside at once
+        sync::Semaphore slots{3};
+        std::atomic<int> inside{0}, most{0};
+        run_threads(8, [&](int) {
+            for (int i = 0; i < 2000; ++i)
+            {
+                slots.acquire();
+                const int now = ++inside;
+                int seen = most.load();
+                while (now > seen && !most.compare_exchange_weak(seen, now))
+                {
+                }
+                --inside;
+                slots.release();
+            }
+        });
+        REQUIRE(most <= 3);
+        REQUIRE(most >= 1);
+
+        semaphore.release(2);
+        REQUIRE(semaphore.try_acquire());
+        REQUIRE(semaphore.try_acquire());
+    }
+
+    SECTION("SharedMutex") {
+        sync::SharedMutex mutex;
+        REQUIRE(mutex.try_lock_shared());
+        REQUIRE(mutex.try_lock_shared());
+        REQUIRE_FALSE(mutex.try_lock());
+        mutex.unlock_shared();
+        mutex.unlock_shared();
+        REQUIRE(mutex.try_lock());
+        REQUIRE_FALSE(mutex.try_lock_shared());
+        mutex.unlock();
+
+        // Writers keep both halves equal; readers must never see them differ
+        std::uint64_t a = 0, b = 0;
+        std::atomic<int> torn{0};
+        run_threads(6, [&](int index) {
+            for (int i = 0; i < 5000; ++i)
+            {
+                if (index < 2)
+                {
+                    std::unique_lock lock{mutex};
+                    ++a;
+                    ++b;
+                }
+                else
+                {
+                    std::shared_lock lock{mutex};
+                    if (a != b)
+                        ++torn;
+                }
+            }
+        });
+        REQUIRE(torn == 0);
+        REQUIRE(a == 10000);
+    }
+}
+
+TEST_CASE("bounded queues", "[queue]") {
+    using pnq::wait_strategy;
+
+    SECTION("SpscQueue basics") {
+        pnq::SpscQueue<std::unique_ptr<int>> queue{3};
+        REQUIRE(queue.capacity() == 4);
+
+        for (int i = 0; i < 4; ++i)
+            REQUIRE(queue.try_push(std::make_unique<int>(i)));
+        auto rejected = std::make_unique<int>(4);
+        REQUIRE_FALSE(queue.try_push(std::move(rejected)));
+        REQUIRE(rejected != nullptr);
+        REQUIRE(queue.size() == 4);
+
+        std::unique_ptr<int> item;
+        REQUIRE(queue.try_pop(item));
+        REQUIRE(*item == 0);
+
+        // Items left in the queue are destroyed with it
+    }
+
+    SECTION("bulk push and pop") {
+        pnq::SpscQueue<int> spsc{8};
+        pnq::MpmcQueue<int> mpmc{8};
+        std::vector<int> input{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+        REQUIRE(spsc.try_push_bulk(input.begin(), input.size()) == 8);
+        REQUIRE(mpmc.try_push_bulk(input.begin(), input.size()) == 8);
+
+        std::vector<int> output;
+        REQUIRE(spsc.try_pop_bulk(std::back_inserter(output), 5) == 5);
+        REQUIRE(spsc.try_pop_bulk(std::back_inserter(output), 5) == 3);
+        REQUIRE(mpmc.try_pop_bulk(std::back_inserter(output), 100) == 8);
+        REQUIRE(output == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7});
+    }
+
+    SECTION("bulk pop needs no default constructor") {
+        struct Item
+        {
+            explicit Item(int v) : value{v} {}
+            int value;
+        };
+        pnq::SpscQueue<Item> spsc{4};
+        pnq::MpmcQueue<Item> mpmc{4};
+        for (int i = 0; i < 3; ++i)
+        {
+            REQUIRE(spsc.try_push(Item{i}));
+            REQUIRE(mpmc.try_push(Item{i}));
+        }
+
+        std::vector<Item> output;
+        REQUIRE(spsc.try_pop_bulk(std::back_inserter(output), 10) == 3);
+        REQUIRE(mpmc.try_pop_bulk(std::back_inserter(output), 2) == 2);
+        REQUIRE(output.size() == 5);
+        REQUIRE(output[2].value == 2);
+        REQUIRE(output[4].value == 1);
+        REQUIRE(mpmc.size() == 1);
+        REQUIRE(spsc.size() == 0);
+    }
+
+    SECTION("close drains, then fails") {
+        pnq::MpmcQueue<std::string> queue{4};
+        REQUIRE(queue.push(std::string{"last"}));
+        queue.close();
+        REQUIRE_FALSE(queue.push(std::string{"too late"}));
+
+        std::string item;
+        REQUIRE(queue.pop(item));
+        REQUIRE(item == "last");
+        REQUIRE_FALSE(queue.pop(item));
+    }
+
+    for (const auto strategy : {wait_strategy::spin, wait_strategy::yield, wait_strategy::park})
+    {
+        // Spinning threads only make progress when they have a core each: keep those runs short
+        const std::uint64_t scale = strategy == wait_strategy::spin ? 20 : 1;
+
+        DYNAMIC_SECTION("SpscQueue keeps order, strategy " << static_cast<int>(strategy)) {
+            const std::uint64_t count = 100000 / scale;
+            pnq::SpscQueue<std::uint64_t> queue{64, strategy};
+
+            std::thread producer{[&] {
+                std::vector<std::uint64_t> batch;
+                for (std::uint64_t i = 0; i < count;)
+                {
+                    if (i % 3)
+                    {
+                        queue.push(i++);
+                        continue;
+                    }
+                    batch.clear();
+                    for (std::uint64_t j = 0; j < 10 && i + j < count; ++j)
+                        batch.push_back(i + j);
+                    const auto pushed = queue.try_push_bulk(batch.begin(), batch.size());
+                    i += pushed;
+                    if (!pushed)
+                        queue.push(i++);
+                }
+                queue.close();
+            }};
+
+            std::uint64_t expected = 0;
+            bool in_order = true;
+            std::uint64_t item;
+            while (queue.pop(item))
+            {
+                in_order = in_order && item == expected;
+                ++expected;
+            }
+            producer.join();
+            REQUIRE(in_order);
+            REQUIRE(expected == count);
+        }
+
+        DYNAMIC_SECTION("MpmcQueue under contention, strategy " << static_cast<int>(strategy)) {
+            constexpr int producers = 4;
+            constexpr int consumers = 4;
+            const std::uint64_t per_producer = 20000 / scale;
+            pnq::MpmcQueue<std::uint64_t> queue{128, strategy};
+
+            // Items encode (producer, sequence); each consumer must see every producer's items in order
+            std::atomic<std::uint64_t> sum{0}, received{0};
+            std::atomic<int> out_of_order{0};
+            std::vector<std::thread> threads;
+            for (int c = 0; c < consumers; ++c)
+            {
+                threads.emplace_back([&] {
+                    std::uint64_t last[producers];
+                    std::fill(std::begin(last), std::end(last), ~std::uint64_t{0});
+                    std::uint64_t item, local_sum = 0, local_count = 0;
+                    while (queue.pop(item))
+                    {
+                        const auto producer = item >> 32;
+                        const auto sequence = item & 0xFFFFFFFFu;
+                        if (last[producer] != ~std::uint64_t{0} && sequence <= last[producer])
+                            ++out_of_order;
+                        last[producer] = sequence;
+                        local_sum += sequence;
+                        ++local_count;
+                    }
+                    sum += local_sum;
+                    received += local_count;
+                });
+            }
+
+            std::vector<std::thread> producer_threads;
+            for (std::uint64_t p = 0; p < producers; ++p)
+            {
+                producer_threads.emplace_back([&, p] {
+                    for (std::uint64_t i = 0; i < per_producer; ++i)
+                        queue.push((p << 32) | i);
+                });
+            }
+            for (auto& thread : producer_threads)
+                thread.join();
+            queue.close();
+            for (auto& thread : threads)
+                thread.join();
+
+            REQUIRE(out_of_order == 0);
+            REQUIRE(received == producers * per_producer);
+            REQUIRE(sum == producers * (per_producer * (per_producer - 1) / 2));
+        }
+    }
+}
@@ -1,8 +1,16 @@
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <pnq/pnq.h>
 #include <pnq/regis3.h>
 #include <pnq/win32/service.h>
 #include <pnq/hosts_file.h>
+#include <pnq/async_io.h>
+#include <pnq/binary_log_decoder.h>
+#include <pnq/memory_tracking_hooks.h>
+
+#ifndef PNQ_USE_QUILL
+#include <spdlog/sinks/ostream_sink.h>
+#endif
 
 TEST_CASE("Version is defined", "[version]") {
     REQUIRE(pnq::version_major == 0);
@@ -81,12 +89,236 @@ TEST_CASE("text_file read/write", "[text_file]") {
         DeleteFileW((temp_dir + L"pnq_test_utf16.txt").c_str());
     }
 
+    SECTION("read_auto maps large files and reads small ones alike") {
+        std::string filename = pnq::string::encode_as_utf8(temp_dir + L"pnq_test_large.txt");
+        std::string content;
+        while (content.size() < tf::map_threshold)
+            content += "a line of text\n";
+
+        REQUIRE(tf::write_utf8(filename, content, true));
+        REQUIRE(tf::read_auto(filename) == content);
+        REQUIRE(tf::read_auto(filename, false) == tf::to_platform_line_endings(content));
+
+        DeleteFileW((temp_dir + L"pnq_test_large.txt").c_str());
+    }
+
     SECTION("read_auto on non-existent file returns empty") {
         auto result = tf::read_auto("C:\\this_file_does_not_exist_12345.txt");
         REQUIRE(result.empty());
     }
 }
 
+TEST_CASE("BinaryFile positional I/O", "[binary_file]") {
+    using pnq::BinaryFile;
+
+    wchar_t temp_path[MAX_PATH];
+    GetTempPathW(MAX_PATH, temp_path);
+    std::string filename = pnq::string::encode_as_utf8(std::wstring{temp_path} + L"pnq_test_binary_file.bin");
+
+    REQUIRE(BinaryFile::write(filename, std::string_view{"hello world"}));
+
+    SECTION("read_at does not depend on file position") {
+        BinaryFile bf;
+        REQUIRE(bf.open_for_reading(filename, pnq::file_options::random_access));
+
+        std::uint8_t buffer[5];
+        size_t bytes_read = 0;
+        REQUIRE(bf.read_at(6, buffer, sizeof(buffer), bytes_read));
+        REQUIRE(bytes_read == 5);
+        REQUIRE(std::memcmp(buffer, "world", 5) == 0);
+
+        REQUIRE(bf.read_at(9, buffer, sizeof(buffer), bytes_read));
+        REQUIRE(bytes_read == 2);
+    }
+
+    SECTION("write_at and preallocate") {
+        {
+            BinaryFile bf;
+            REQUIRE(bf.create_or_open_for_write_append(filename));
+            REQUIRE(bf.preallocate(1024 * 1024));
+            REQUIRE(bf.write_at(0, std::string_view{"J"}));
+        }
+
+        pnq::bytes data;
+        REQUIRE(BinaryFile::read(filename, data));
+        REQUIRE(data.size() == 11);
+        REQUIRE(data[0] == 'J');
+    }
+
+    SECTION("write-behind buffers keep write order") {
+        std::string expected;
+        {
+            BinaryFile bf;
+            REQUIRE(bf.create_for_writing(filename));
+            REQUIRE(bf.set_write_buffers(64, 3));
+            REQUIRE(bf.has_cache());
+
+            for (int i = 0; i < 1000; ++i) {
+                const auto line = std::format("line {}\n", i);
+                expected += line;
+                REQUIRE(bf.write(line.c_str()));
+            }
+            REQUIRE(bf.write(pnq::memory_view{std::string_view{expected}}));
+            expected += expected;
+            REQUIRE(bf.sync());
+            REQUIRE(bf.get_file_size() == expected.size());
+
+            REQUIRE(bf.write("tail"));
+            expected += "tail";
+        }
+
+        pnq::bytes data;
+        REQUIRE(BinaryFile::read(filename, data));
+        REQUIRE(std::string_view{reinterpret_cast<const char*>(data.data()), data.size()} == expected);
+    }
+
+    SECTION("gather writes") {
+        std::vector<std::string> lines;
+        std::vector<pnq::memory_view> fragments;
+        std::string expected;
+        for (int i = 0; i < 200; ++i) {
+            lines.push_back(std::format("\"value{}\"=dword:{:08x}\r\n", i, i));
+        }
+        for (const auto& line : lines) {
+            fragments.emplace_back(std::string_view{line});
+            fragments.emplace_back(std::string_view{});
+            expected += line;
+        }
+
+        {
+            BinaryFile bf;
+            REQUIRE(bf.create_for_writing(filename));
+            REQUIRE(bf.write(fragments));
+            REQUIRE(bf.write_at(0, std::span<const pnq::memory_view>{fragments}.first(1)));
+        }
+
+        pnq::bytes data;
+        REQUIRE(BinaryFile::read(filename, data));
+        REQUIRE(std::string_view{reinterpret_cast<const char*>(data.data()), data.size()} == expected);
+    }
+
+    SECTION("AlignedBuffer is aligned for direct I/O") {
+        pnq::AlignedBuffer buffer{2 * pnq::direct_io_alignment};
+        REQUIRE(reinterpret_cast<std::uintptr_t>(buffer.data()) % pnq::direct_io_alignment == 0);
+        REQUIRE(buffer.size() == 2 * pnq::direct_io_alignment);
+    }
+
+    pnq::file::remove(filename);
+}
+
+TEST_CASE("MappedFile", "[mapped_file]") {
+    using pnq::MappedFile;
+
+    wchar_t temp_path[MAX_PATH];
+    GetTempPathW(MAX_PATH, temp_path);
+    std::string filename = pnq::string::encode_as_utf8(std::wstring{temp_path} + L"pnq_test_mapped_file.txt");
+
+    REQUIRE(pnq::BinaryFile::write(filename, std::string_view{"mapped content"}));
+
+    SECTION("read-only mapping exposes file contents") {
+        MappedFile file;
+        REQUIRE(file.open(filename));
+        REQUIRE(file.is_mapped());
+        REQUIRE(file.view() == pnq::memory_view{std::string_view{"mapped content"}});
+        REQUIRE(file.mutable_data() == nullptr);
+        REQUIRE(file.advise(pnq::map_advice::sequential));
+    }
+
+    SECTION("temp directory is local") {
+        REQUIRE(MappedFile::is_local(filename));
+    }
+
+    SECTION("copy-on-write changes do not reach the file") {
+        {
+            MappedFile file;
+            REQUIRE(file.open(filename, pnq::map_mode::copy_on_write));
+            file.mutable_data()[0] = 'M';
+            REQUIRE(file.text() == "Mapped content");
+        }
+        REQUIRE(pnq::text_file::read_auto(filename) == "mapped content");
+    }
+
+    SECTION("empty file maps to empty view") {
+        REQUIRE(pnq::BinaryFile::write(filename, std::string_view{}));
+
+        MappedFile file;
+        REQUIRE(file.open(filename));
+        REQUIRE_FALSE(file.is_mapped());
+        REQUIRE(file.view().empty());
+    }
+
+    SECTION("missing file fails") {
+        MappedFile file;
+        REQUIRE_FALSE(file.open("C:\\this_file_does_not_exist_12345.txt"));
+    }
+
+    pnq::file::remove(filename);
+}
+
+TEST_CASE("AsyncIO", "[async_io]") {
+    using pnq::AsyncIO;
+    using pnq::BinaryFile;
+
+    wchar_t temp_path[MAX_PATH];
+    GetTempPathW(MAX_PATH, temp_path);
+    const std::wstring temp_dir{temp_path};
+
+    constexpr int file_count = 16;
+    std::vector<std::string> filenames;
+    std::vector<std::string> contents;
+    for (int i = 0; i < file_count; ++i)
+    {
+        filenames.push_back(pnq::string::encode_as_utf8(temp_dir + std::format(L"pnq_test_async_{}.bin", i)));
+        contents.push_back(std::string(1000 + i, static_cast<char>('a' + i)));
+    }
+
+    SECTION("batched writes then reads round-trip") {
+        {
+            std::vector<std::unique_ptr<BinaryFile>> files;
+            std::atomic<int> written{0};
+
+            AsyncIO io{4};
+            for (int i = 0; i < file_count; ++i)
+            {
+                files.push_back(std::make_unique<BinaryFile>());
+                REQUIRE(files.back()->create_for_writing(filenames[i]));
+                io.write(*files.back(), 0, std::string_view{contents[i]}, [&written](const AsyncIO::Result& result) {
+                    if (result.success)
+                        ++written;
+                });
+            }
+            REQUIRE(io.pending() == file_count);
+            REQUIRE(io.submit() == file_count);
+            io.wait_all();
+            REQUIRE(written == file_count);
+        }
+
+        std::vector<std::unique_ptr<BinaryFile>> files;
+        std::vector<pnq::bytes> buffers(file_count, pnq::bytes(2000));
+        std::vector<std::future<AsyncIO::Result>> results;
+
+        AsyncIO io;
+        for (int i = 0; i < file_count; ++i)
+        {
+            files.push_back(std::make_unique<BinaryFile>());
+            REQUIRE(files.back()->open_for_reading(filenames[i]));
+            results.push_back(io.read(*files.back(), 0, buffers[i].data(), buffers[i].size()));
+        }
+        io.submit();
+
+        for (int i = 0; i < file_count; ++i)
+        {
+            auto result = results[i].get();
+            REQUIRE(result.success);
+            REQUIRE(result.bytes == contents[i].size());
+            REQUIRE(std::memcmp(buffers[i].data(), contents[i].data(), result.bytes) == 0);
+        }
+    }
+
+    for (const auto& filename : filenames)
+        pnq::file::remove(filename);
+}
+
 TEST_CASE("string::is_empty", "[string]") {
     using pnq::string::is_empty;
 
@@ -867,6 +1099,63 @@ TEST_CASE("path::find_executable", "[path]") {
     }
 }
 
+TEST_CASE("path::PathResolver", "[path]") {
+    namespace p = pnq::path;
+    p::PathResolver resolver;
+    REQUIRE(resolver.size() > 0);
+
+    SECTION("matches find_executable") {
+        for (const char* name : {"cmd", "notepad", "CMD.EXE", "where"}) {
+            std::string expected, result;
+            REQUIRE(p::find_executable(name, expected));
+            REQUIRE(resolver.find_executable(name, result));
+            REQUIRE(pnq::string::equals_nocase(result, expected));
+        }
+    }
+
+    SECTION("unknown names are not found") {
+        std::string result;
+        REQUIRE_FALSE(resolver.find_executable("pnq_no_such_tool_12345", result));
+    }
+
+    SECTION("refresh picks up new files") {
+        const std::string name{"pnq_resolver_test.txt"};
+        const auto filename = p::combine(pnq::directory::current(), name);
+        std::string result;
+        REQUIRE_FALSE(resolver.find_filename(name, result, false));
+
+        REQUIRE(pnq::text_file::write_utf8(filename, "x"));
+        resolver.refresh();
+        REQUIRE(resolver.find_filename(name, result, false));
+        REQUIRE(result == filename);
+
+        pnq::file::remove(filename);
+        resolver.refresh();
+        REQUIRE_FALSE(resolver.find_filename(name, result, false));
+    }
+
+    SECTION("application directory wins over the current directory") {
+        const auto application = pnq::directory::application();
+        const auto current = pnq::directory::current();
+        if (pnq::string::equals_nocase(p::combine(application), p::combine(current)))
+            SKIP("test runs in the application directory");
+
+        const std::string name{"pnq_resolver_order.txt"};
+        const auto in_application = p::combine(application, name);
+        const auto in_current = p::combine(current, name);
+        REQUIRE(pnq::text_file::write_utf8(in_application, "a"));
+        REQUIRE(pnq::text_file::write_utf8(in_current, "c"));
+        resolver.refresh();
+
+        std::string result;
+        REQUIRE(resolver.find_filename(name, result, false));
+        REQUIRE(pnq::string::equals_nocase(result, in_application));
+
+        pnq::file::remove(in_application);
+        pnq::file::remove(in_current);
+    }
+}
+
 TEST_CASE("path::normalize", "[path]") {
     namespace p = pnq::path;
 
@@ -922,6 +1211,111 @@ TEST_CASE("path::normalize", "[path]") {
         auto result = p::normalize("100%% complete");
         REQUIRE(result == "100% complete");
     }
+
+    SECTION("resolves . and .. and duplicate separators") {
+        REQUIRE(p::normalize("C:\\a\\\\b\\.\\c\\..\\d\\") == "C:\\a\\b\\d");
+        REQUIRE(p::normalize("C:\\..\\..\\x") == "C:\\x");
+        REQUIRE(p::normalize("..\\a\\..\\..\\b") == "..\\..\\b");
+        REQUIRE(p::normalize("a\\..") == ".");
+        REQUIRE(p::combine("a", "..") == ".");
+    }
+
+    SECTION("keeps the separator after a drive root") {
+        REQUIRE(p::normalize("C:\\") == "C:\\");
+        REQUIRE(p::normalize("C:/") == "C:\\");
+        REQUIRE(p::normalize("%SYSTEMDRIVE%\\").ends_with(":\\"));
+        REQUIRE(p::normalize("C:\\a\\..") == "C:\\");
+        REQUIRE(p::normalize("C:\\.") == "C:\\");
+        REQUIRE(p::combine("C:\\", "x") == "C:\\x");
+    }
+
+    SECTION("drive-relative paths stay relative") {
+        REQUIRE(p::normalize("C:") == "C:");
+        REQUIRE(p::normalize("C:a\\..") == "C:");
+        REQUIRE(p::normalize("C:..\\a") == "C:..\\a");
+        REQUIRE(p::normalize("C:a\\..\\b") == "C:b");
+        REQUIRE(p::normalize("C:a\\b\\..\\..\\c") == "C:c");
+        REQUIRE(p::normalize("C:a\\..\\..") == "C:..");
+        REQUIRE(p::normalize("C:.\\\\x") == "C:x");
+        REQUIRE(p::combine("C:", "x") == "C:\\x");
+    }
+
+    SECTION("drops trailing separators below the root") {
+        REQUIRE(p::normalize("C:\\a\\") == "C:\\a");
+        REQUIRE(p::normalize("a/b//") == "a\\b");
+        REQUIRE(p::normalize("\\\\server\\share\\") == "\\\\server\\share");
+    }
+
+    SECTION("keeps UNC server and share") {
+        REQUIRE(p::normalize("\\\\server\\share\\..\\x") == "\\\\server\\share\\x");
+        REQUIRE(p::normalize("\\\\server\\..\\x") == "\\\\server\\x");
+        REQUIRE(p::normalize("//server/share/../..") == "\\\\server\\share");
+        REQUIRE(p::combine("\\\\server", "..", "x") == "\\\\server\\x");
+    }
+
+    SECTION("leaves \\\\?\\ and \\\\.\\ paths untouched") {
+        REQUIRE(p::normalize("\\\\?\\C:\\a\\..") == "\\\\?\\C:\\a\\..");
+        REQUIRE(p::normalize("\\\\.\\pipe\\a/b") == "\\\\.\\pipe\\a/b");
+        REQUIRE(p::combine("\\\\?\\C:\\dir", "x") == "\\\\?\\C:\\dir\\x");
+    }
+
+    SECTION("expanded values are normalized too") {
+        std::unordered_map<std::string, std::string> vars{{"BASE", "C:/base/sub/"}};
+        REQUIRE(p::normalize("%BASE%..\\file.txt", vars) == "C:\\base\\file.txt");
+    }
+
+    SECTION("Normalizer writes into a caller buffer") {
+        char buffer[8];
+        p::Normalizer normalizer{std::span<char>{buffer}};
+        normalizer.append("C:").append("dir");
+        REQUIRE(normalizer.view() == "C:\\dir");
+        REQUIRE(normalizer.view().data() == buffer);
+
+        normalizer.append("a_longer_file_name.txt");
+        REQUIRE(normalizer.view() == "C:\\dir\\a_longer_file_name.txt");
+    }
+}
+
+TEST_CASE("path::normalize benchmark", "[path][.benchmark]") {
+    namespace p = pnq::path;
+    namespace fs = std::filesystem;
+
+    // Real paths below the Windows directory, rewritten relative to %WINDIR% with some noise
+    const auto windows = pnq::directory::windows();
+    std::vector<std::string> corpus;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it{windows, fs::directory_options::skip_permission_denied, ec}, end; it != end && corpus.size() < 50000; it.increment(ec)) {
+        if (ec)
+            continue;
+        auto relative = pnq::string::encode_as_utf8(it->path().wstring()).substr(windows.size());
+        corpus.push_back("%WINDIR%" + relative);
+        corpus.push_back("%WINDIR%/.//sub/.." + relative);
+    }
+    REQUIRE(!corpus.empty());
+
+    BENCHMARK("normalize") {
+        size_t total = 0;
+        for (const auto& path : corpus)
+            total += p::normalize(path).size();
+        return total;
+    };
+
+    BENCHMARK("Normalizer reused") {
+        size_t total = 0;
+        p::Normalizer normalizer;
+        for (const auto& path : corpus) {
+            normalizer.clear();
+            total += normalizer.append(path).view().size();
+        }
+        return total;
+    };
+
+    BENCHMARK("combine") {
+        size_t total = 0;
+        for (const auto& path : corpus)
+            total += p::combine(windows, "..", path.substr(8)).size();
+        return total;
+    };
 }
 
 TEST_CASE("memory_view", "[memory_view]") {
@@ -1227,6 +1621,31 @@ TEST_CASE("RefCountImpl", "[ref_counted]") {
         obj->release();  // should delete
         REQUIRE(TestRefCounted::instance_count == 0);
     }
+
+    SECTION("single thread policy") {
+        struct Local : pnq::SingleThreadRefCountImpl {
+            explicit Local(int& count) : m_count{count} { ++m_count; }
+            ~Local() { --m_count; }
+            int& m_count;
+        };
+
+        int count = 0;
+        auto p = pnq::make_ref<Local>(count);
+        auto q = p;
+        REQUIRE(count == 1);
+        p.reset();
+        REQUIRE(count == 1);
+        q.reset();
+        REQUIRE(count == 0);
+    }
+
+    SECTION("RefCounted mixin with policy") {
+        struct Plain : pnq::IRefCounted {};
+        auto* obj = new pnq::RefCounted<Plain, pnq::refcount::single_thread>();
+        obj->retain();
+        obj->release();
+        obj->release();
+    }
 }
 
 TEST_CASE("RefCountedVector", "[ref_counted]") {
@@ -1388,6 +1807,687 @@ TEST_CASE("RefCountedVector", "[ref_counted]") {
     }
 }
 
+TEST_CASE("ref_ptr", "[ref_counted]") {
+    using pnq::ref_ptr;
+    TestRefCounted::instance_count = 0;
+
+    SECTION("adopt and release") {
+        {
+            ref_ptr<TestRefCounted> p{new TestRefCounted(), pnq::adopt_ref};
+            REQUIRE(p);
+            REQUIRE(TestRefCounted::instance_count == 1);
+        }
+        REQUIRE(TestRefCounted::instance_count == 0);
+    }
+
+    SECTION("copy retains, move transfers") {
+        auto a = pnq::make_ref<TestRefCounted>();
+        {
+            ref_ptr<TestRefCounted> b{a};
+            REQUIRE(b == a);
+
+            ref_ptr<TestRefCounted> c{std::move(b)};
+            REQUIRE_FALSE(b);
+            REQUIRE(c == a);
+        }
+        REQUIRE(TestRefCounted::instance_count == 1);
+
+        ref_ptr<pnq::IRefCounted> base{std::move(a)};
+        REQUIRE_FALSE(a);
+        base = nullptr;
+        REQUIRE(TestRefCounted::instance_count == 0);
+    }
+
+    SECTION("retain, share and detach") {
+        auto* raw = new TestRefCounted();
+        {
+            ref_ptr<TestRefCounted> p{raw, pnq::retain_ref};
+            raw->release();
+            REQUIRE(TestRefCounted::instance_count == 1);
+
+            auto* shared = p.share();
+            p.reset();
+            REQUIRE(TestRefCounted::instance_count == 1);
+
+            ref_ptr<TestRefCounted> q{shared, pnq::adopt_ref};
+            auto* detached = q.detach();
+            REQUIRE_FALSE(q);
+            detached->release();
+        }
+        REQUIRE(TestRefCounted::instance_count == 0);
+    }
+
+    SECTION("self assignment") {
+        auto p = pnq::make_ref<TestRefCounted>();
+        auto& alias = p;
+        p = alias;
+        REQUIRE(p);
+        p = std::move(alias);
+        REQUIRE(p);
+        p.reset();
+        REQUIRE(TestRefCounted::instance_count == 0);
+    }
+}
+
+TEST_CASE("ref_ptr benchmark", "[ref_counted][.benchmark]") {
+    using pnq::regis3::key_entry;
+
+    // 10 x 100 x 100 keys with a few values each
+    pnq::ref_ptr<key_entry> root{PNQ_NEW key_entry(), pnq::adopt_ref};
+    for (int i = 0; i < 10; ++i) {
+        for (int j = 0; j < 100; ++j) {
+            for (int k = 0; k < 100; ++k) {
+                auto* key = root->find_or_create_key(std::format("HKEY_CURRENT_USER\\Software\\k{}\\k{}\\k{}", i, j, k));
+                key->find_or_create_value("name")->set_string("value");
+                key->find_or_create_value("count")->set_dword(k);
+            }
+        }
+    }
+
+    BENCHMARK("clone") {
+        return pnq::ref_ptr<key_entry>{root->clone(nullptr), pnq::adopt_ref};
+    };
+
+    BENCHMARK("diff") {
+        pnq::ref_ptr<key_entry> diff{PNQ_NEW key_entry(), pnq::adopt_ref};
+        for (const auto& [name, child] : root->find_or_create_key("HKEY_CURRENT_USER\\Software")->keys())
+            diff->ask_to_add_key(child);
+        return diff;
+    };
+
+    auto atomic_obj = pnq::make_ref<pnq::RefCounted<pnq::IRefCounted, pnq::refcount::atomic>>();
+    BENCHMARK("atomic retain/release") {
+        for (int i = 0; i < 100000; ++i) {
+            atomic_obj->retain();
+            atomic_obj->release();
+        }
+    };
+
+    auto plain_obj = pnq::make_ref<pnq::RefCounted<pnq::IRefCounted, pnq::refcount::single_thread>>();
+    BENCHMARK("single_thread retain/release") {
+        for (int i = 0; i < 100000; ++i) {
+            plain_obj->retain();
+            plain_obj->release();
+        }
+    };
+
+    std::vector<pnq::ref_ptr<key_entry>> refs(100000, root);
+    BENCHMARK("ref_ptr copy") {
+        auto copy = refs;
+        return copy.size();
+    };
+
+    BENCHMARK("ref_ptr move") {
+        std::vector<pnq::ref_ptr<key_entry>> moved;
+        moved.reserve(refs.size());
+        for (auto& ref : refs)
+            moved.push_back(std::move(ref));
+        refs = std::move(moved);
+        return refs.size();
+    };
+}
+
+TEST_CASE("logging async mode", "[logging]") {
+    namespace logging = pnq::logging;
+
+    wchar_t temp_path[MAX_PATH];
+    GetTempPathW(MAX_PATH, temp_path);
+    std::string filename = pnq::string::encode_as_utf8(std::wstring{temp_path} + L"pnq_test_async_logging.log");
+
+    logging::initialize_async_logging("pnq_tests", false, {1024, logging::overflow_policy::block});
+    logging::reconfigure_logging_for_file(filename);
+
+    // More messages than the queue holds: blocking must not lose any of them
+    for (int i = 0; i < 10000; ++i)
+        PNQ_LOG_INFO("async message {}", i);
+    logging::stop_async_logging();
+
+    std::ifstream log{filename};
+    size_t lines = 0;
+    for (std::string line; std::getline(log, line);)
+        if (line.find("async message") != std::string::npos)
+            ++lines;
+    log.close();
+    REQUIRE(lines == 10000);
+
+    // Threads still inside PNQ_LOG_* while logging stops keep a valid logger
+    logging::initialize_async_logging("pnq_tests", false, {1024, logging::overflow_policy::block});
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&done] { while (!done) PNQ_LOG_DEBUG("racing message"); });
+    logging::stop_async_logging();
+    done = true;
+    for (auto& thread : threads)
+        thread.join();
+
+    logging::initialize_logging("pnq_tests");
+    pnq::file::remove(filename);
+    pnq::file::remove(filename.substr(0, filename.size() - 4) + ".1.log");
+}
+
+TEST_CASE("logging level guard", "[logging]") {
+    namespace logging = pnq::logging;
+
+    int evaluated = 0;
+    const auto argument = [&] { return ++evaluated; };
+
+    logging::initialize_logging("pnq_tests");
+    logging::set_level(logging::level::warn);
+
+    PNQ_LOG_DEBUG("debug {}", argument());
+    PNQ_LOG_INFO("info {}", argument());
+    REQUIRE(evaluated == 0);
+
+    PNQ_LOG_WARN("warn {}", argument());
+    REQUIRE(evaluated == 1);
+
+    logging::set_level(logging::level::debug);
+}
+
+TEST_CASE("logging rate limits", "[logging]") {
+    SECTION("RateLimiter lets a budget per second through") {
+        pnq::logging::RateLimiter limiter;
+        std::uint32_t suppressed = 0;
+        int allowed = 0;
+        for (int i = 0; i < 100; ++i)
+            allowed += limiter.allow(1000000, suppressed) ? 1 : 0;
+        REQUIRE(allowed == 100);
+        REQUIRE(suppressed == 0);
+
+        // Seconds come from the caller instead of the steady clock
+        pnq::logging::RateLimiter strict;
+        REQUIRE(strict.allow(1, suppressed, 100));
+        REQUIRE_FALSE(strict.allow(1, suppressed, 100));
+        REQUIRE_FALSE(strict.allow(1, suppressed, 100));
+
+        REQUIRE(strict.allow(1, suppressed, 101));
+        REQUIRE(suppressed == 2);
+        REQUIRE_FALSE(strict.allow(1, suppressed, 101));
+
+        // A burst that ends leaves its count for flush_suppressed()
+        REQUIRE(strict.take_suppressed() == 1);
+        REQUIRE(strict.take_suppressed() == 0);
+    }
+
+#ifndef PNQ_USE_QUILL
+    SECTION("rate-limited statements at every level report what they suppressed") {
+        pnq::logging::flush_suppressed();
+
+        std::ostringstream output;
+        auto sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(output);
+        sink->set_formatter(std::make_unique<spdlog::pattern_formatter>("%v", spdlog::pattern_time_type::local, "\n"));
+        auto logger = std::make_shared<spdlog::logger>("pnq_tests", sink);
+        logger->set_level(spdlog::level::trace);
+        spdlog::set_default_logger(logger);
+
+        for (int i = 0; i < 10; ++i) {
+            PNQ_LOG_TRACE_RATELIMITED(1, "trace {}", i);
+            PNQ_LOG_DEBUG_RATELIMITED(1, "debug {}", i);
+            PNQ_LOG_INFO_RATELIMITED(1, "info {}", i);
+        }
+        pnq::logging::flush_suppressed();
+
+        // Each statement was either logged or counted, whether or not a second boundary fell in the loop
+        unsigned logged = 0;
+        unsigned reported = 0;
+        std::istringstream lines{output.str()};
+        for (std::string line; std::getline(lines, line);) {
+            if (const auto pos = line.find(" similar messages were suppressed ("); pos != std::string::npos)
+                reported += static_cast<unsigned>(std::stoul(line.substr(0, pos)));
+            else if (line.starts_with("trace ") || line.starts_with("debug ") || line.starts_with("info "))
+                ++logged;
+        }
+        REQUIRE(logged >= 3);
+        REQUIRE(logged + reported == 30);
+
+        pnq::logging::initialize_logging("pnq_tests");
+    }
+#endif
+
+    SECTION("Deduplicator counts repeats of the last message") {
+        pnq::logging::Deduplicator dedup;
+        std::uint32_t repeated = 0;
+        REQUIRE(dedup.allow(1, repeated, 100));
+        REQUIRE(repeated == 0);
+        REQUIRE_FALSE(dedup.allow(1, repeated, 100));
+        REQUIRE_FALSE(dedup.allow(1, repeated, 101));
+
+        REQUIRE(dedup.allow(2, repeated, 102));
+        REQUIRE(repeated == 2);
+
+        // A long run is still reported now and then
+        REQUIRE_FALSE(dedup.allow(2, repeated, 103));
+        REQUIRE(dedup.allow(2, repeated, 102 + pnq::logging::dedup_report_interval));
+        REQUIRE(repeated == 1);
+
+        // A run that ends leaves its count for flush_suppressed()
+        REQUIRE_FALSE(dedup.allow(2, repeated, 110));
+        REQUIRE(dedup.take_suppressed() == 1);
+    }
+
+#ifndef PNQ_USE_QUILL
+    SECTION("deduplicated statements collapse identical messages") {
+        std::ostringstream output;
+        auto sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(output);
+        sink->set_formatter(std::make_unique<spdlog::pattern_formatter>("%v", spdlog::pattern_time_type::local, "\n"));
+        spdlog::set_default_logger(std::make_shared<spdlog::logger>("pnq_tests", sink));
+
+        for (const int value : {1, 1, 1, 1, 1, 2, 3})
+            PNQ_LOG_INFO_DEDUPLICATED("message {}", value);
+
+        const std::string text{output.str()};
+        REQUIRE(text.starts_with("message 1\nlast message repeated 4 times ("));
+        REQUIRE(text.ends_with(")\nmessage 2\nmessage 3\n"));
+        pnq::logging::initialize_logging("pnq_tests");
+    }
+#endif
+}
+
+TEST_CASE("logging binary mode", "[logging]") {
+    namespace binary = pnq::logging::binary;
+
+    wchar_t temp_path[MAX_PATH];
+    GetTempPathW(MAX_PATH, temp_path);
+    std::string filename = pnq::string::encode_as_utf8(std::wstring{temp_path} + L"pnq_test_binary.blog");
+
+    REQUIRE(binary::start(filename, 4096));
+    const auto dropped_before = binary::dropped();
+
+    const std::string name{"regis3"};
+    PNQ_LOG_BINARY(PNQ_LOG_LEVEL_INFO, PNQ_LOG_AT_INFO, "{} parsed {} keys in {:.2f} ms ({:#x})", name, 42, 1.5, 255u);
+    PNQ_LOG_BINARY(PNQ_LOG_LEVEL_WARN, PNQ_LOG_AT_WARN, "{1} before {0}, {{braces}}", 'a', true);
+    PNQ_LOG_BINARY(PNQ_LOG_LEVEL_TRACE, PNQ_LOG_AT_TRACE, "below the level {}", 1);
+    // Durations are recorded as text, which their spec does not fit
+    PNQ_LOG_BINARY(PNQ_LOG_LEVEL_INFO, PNQ_LOG_AT_INFO, "duration {:%Q}", std::chrono::seconds{5});
+
+    // More than half of the ring never fits
+    PNQ_LOG_BINARY(PNQ_LOG_LEVEL_INFO, PNQ_LOG_AT_INFO, "too large {}", std::string(3000, 'x'));
+    REQUIRE(binary::dropped() == dropped_before + 1);
+
+    // Several threads, more records than a ring holds
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < 1000; ++i)
+                PNQ_LOG_BINARY(PNQ_LOG_LEVEL_INFO, PNQ_LOG_AT_INFO, "thread {} message {}", t, i);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    binary::stop();
+    REQUIRE_FALSE(binary::is_active());
+
+    std::vector<std::string> texts;
+    REQUIRE(binary::decode(filename, [&](const binary::Message& message) { texts.push_back(message.text); }));
+
+    REQUIRE(texts.size() == 4 + 4 * 1000);
+    REQUIRE(texts[0] == "regis3 parsed 42 keys in 1.50 ms (0xff)");
+    REQUIRE(texts[1] == "true before a, {braces}");
+    REQUIRE(texts[2].starts_with("duration {!{:%Q}: "));
+    REQUIRE(texts[2].ends_with(": 5s}"));
+    REQUIRE(std::count(texts.begin(), texts.end(), "1 statements dropped") == 1);
+    REQUIRE(std::count(texts.begin(), texts.end(), "thread 3 message 999") == 1);
+
+    // A statement that passed is_active() before stop() is dropped instead of waiting for room forever
+    static binary::CallSite site{__FILE__, __LINE__};
+    for (int i = 0; i < 100; ++i)
+        binary::log(site, PNQ_LOG_LEVEL_INFO, "after stop {}", std::string(100, 'x'));
+    REQUIRE(binary::dropped() > dropped_before + 1);
+
+    pnq::file::remove(filename);
+}
+
+TEST_CASE("logging latency benchmark", "[logging][.benchmark]") {
+    namespace logging = pnq::logging;
+    using clock = std::chrono::steady_clock;
+
+    wchar_t temp_path[MAX_PATH];
+    GetTempPathW(MAX_PATH, temp_path);
+    std::string filename = pnq::string::encode_as_utf8(std::wstring{temp_path} + L"pnq_bench_logging.log");
+
+    // Percentiles of single PNQ_LOG_INFO calls, which BENCHMARK's mean would hide.
+    // Build with PNQ_USE_QUILL to get the same numbers for the Quill backend.
+    const auto measure = [&](const char* mode) {
+        logging::reconfigure_logging_for_file(filename);
+
+        constexpr int count = 200000;
+        std::vector<clock::duration> latencies;
+        latencies.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            const auto start = clock::now();
+            PNQ_LOG_INFO("benchmark message {} with a payload of {:.3f}", i, i * 0.5);
+            latencies.push_back(clock::now() - start);
+        }
+        logging::stop_async_logging();
+
+        std::sort(latencies.begin(), latencies.end());
+        const auto percentile = [&](double p) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(latencies[static_cast<size_t>(p * (count - 1))]).count();
+        };
+        std::cout << std::format("{:<16} p50 {:>6} ns  p90 {:>6} ns  p99 {:>7} ns  p99.9 {:>8} ns  max {:>9} ns\n",
+            mode, percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999), percentile(1.0));
+    };
+
+#ifdef PNQ_USE_QUILL
+    logging::initialize_logging("pnq_bench");
+    measure("quill");
+#else
+    logging::initialize_logging("pnq_bench");
+    measure("sync");
+
+    logging::initialize_async_logging("pnq_bench", false, {8192, logging::overflow_policy::block});
+    measure("async block");
+
+    logging::initialize_async_logging("pnq_bench", false, {8192, logging::overflow_policy::drop});
+    measure("async drop");
+
+    logging::initialize_async_logging("pnq_bench", false, {8192, logging::overflow_policy::overrun});
+    measure("async overrun");
+#endif
+
+#ifdef PNQ_USE_BINARY_LOG
+    const auto binary_filename = filename.substr(0, filename.size() - 4) + ".blog";
+    REQUIRE(logging::binary::start(binary_filename));
+    measure("binary");
+    logging::binary::stop();
+    pnq::file::remove(binary_filename);
+#endif
+
+    logging::initialize_logging("pnq_tests");
+    pnq::file::remove(filename);
+    for (int i = 1; i <= 10; ++i)
+        pnq::file::remove(filename.substr(0, filename.size() - 4) + std::format(".{}.log", i));
+}
+
+TEST_CASE("console color translation", "[console]") {
+    namespace console = pnq::console;
+    using console::color_mode;
+
+    SECTION("attribute bytes map to SGR colors") {
+        REQUIRE(console::detail::translate(CONSOLE_FOREGROUND_RED "x", color_mode::ansi) == "\x1b[31mx");
+        REQUIRE(console::detail::translate(CONSOLE_FOREGROUND_BLUE "x", color_mode::ansi) == "\x1b[34mx");
+        REQUIRE(console::detail::translate(CONSOLE_FOREGROUND_YELLOW "x", color_mode::ansi) == "\x1b[33mx");
+        REQUIRE(console::detail::translate(CONSOLE_FOREGROUND_BRIGHT_CYAN "x", color_mode::ansi) == "\x1b[96mx");
+        REQUIRE(console::detail::translate(CONSOLE_FOREGROUND_BRIGHT_WHITE "x", color_mode::ansi) == "\x1b[97mx");
+        REQUIRE(console::detail::translate("a" CONSOLE_STANDARD "b", color_mode::ansi) == "a\x1b[0mb");
+    }
+
+    SECTION("black survives the embedded NUL") {
+        const std::string_view text{CONSOLE_FOREGROUND_BRIGHT_BLACK "x", 3};
+        REQUIRE(console::detail::translate(text, color_mode::ansi) == "\x1b[30mx");
+    }
+
+    SECTION("plain mode strips colors") {
+        REQUIRE(console::detail::translate(CONSOLE_FOREGROUND_GREEN "ok" CONSOLE_STANDARD " done", color_mode::plain) == "ok done");
+    }
+
+    SECTION("truncated escape is dropped") {
+        REQUIRE(console::detail::translate("abc\x1b", color_mode::ansi) == "abc");
+    }
+}
+
+TEST_CASE("console::BufferedWriter", "[console]") {
+    namespace console = pnq::console;
+
+    const auto previous = console::get_color_mode();
+    console::set_color_mode(console::color_mode::plain);
+
+    {
+        console::BufferedWriter writer{64};
+        REQUIRE(writer.write("buffered "));
+        REQUIRE(writer.format("{} ", 42));
+        REQUIRE(writer.size() == 12);
+        REQUIRE(writer.write_line(CONSOLE_FOREGROUND_GREEN "line" CONSOLE_STANDARD));
+        REQUIRE(writer.size() == 12 + 8 + console::newline.size());
+
+        // Filling past capacity flushes what was collected first
+        REQUIRE(writer.write(std::string(60, '.')));
+        REQUIRE(writer.size() == 60);
+
+        REQUIRE(writer.flush());
+        REQUIRE(writer.size() == 0);
+        REQUIRE(writer.write_line(""));
+    }
+
+    console::set_color_mode(previous);
+}
+
+TEST_CASE("console::LineQueue", "[console]") {
+    namespace console = pnq::console;
+
+    std::string output;
+    {
+        console::LineQueue queue{[&](std::string_view batch) { output.append(batch); }};
+
+        SECTION("lines from many threads stay whole and in order") {
+            constexpr int thread_count = 4;
+            constexpr int line_count = 2000;
+
+            std::vector<std::thread> threads;
+            for (int t = 0; t < thread_count; ++t) {
+                threads.emplace_back([&queue, t] {
+                    console::LineWriter writer{queue};
+                    for (int i = 0; i < line_count; ++i) {
+                        // Pieces of a line are only published together
+                        writer.write("thread ");
+                        writer.format("{} ", t);
+                        writer.format_line("line {}", i);
+                    }
+                });
+            }
+            for (auto& thread : threads)
+                thread.join();
+            queue.flush();
+
+            int next[thread_count]{};
+            size_t lines = 0;
+            std::string_view rest{output};
+            while (!rest.empty()) {
+                const auto end = rest.find(console::newline);
+                REQUIRE(end != std::string_view::npos);
+                const auto line = rest.substr(0, end);
+                const auto separator = line.find(" line ");
+                REQUIRE(line.starts_with("thread "));
+                REQUIRE(separator != std::string_view::npos);
+                int t = -1, i = -1;
+                REQUIRE(std::from_chars(line.data() + 7, line.data() + separator, t).ec == std::errc{});
+                REQUIRE(std::from_chars(line.data() + separator + 6, line.data() + line.size(), i).ec == std::errc{});
+                REQUIRE((t >= 0 && t < thread_count));
+                REQUIRE(i == next[t]++);
+                rest.remove_prefix(end + console::newline.size());
+                ++lines;
+            }
+            REQUIRE(lines == thread_count * line_count);
+        }
+
+        SECTION("incomplete lines wait for flush") {
+            console::LineWriter writer{queue};
+            writer.write("first\nsec");
+            queue.flush();
+            REQUIRE(output == "first\n");
+
+            writer.write("ond");
+            writer.flush();
+            REQUIRE(output == "first\nsecond");
+        }
+    }
+}
+
+TEST_CASE("console output benchmark", "[console][.benchmark]") {
+    namespace console = pnq::console;
+
+    // Redirect stdout to a file to measure the write path rather than the terminal
+    BENCHMARK("console::format_line") {
+        for (int i = 0; i < 1000; ++i)
+            console::format_line(CONSOLE_FOREGROUND_GREEN "{:>6}" CONSOLE_STANDARD " benchmark line", i);
+        return 0;
+    };
+
+    BENCHMARK("console::BufferedWriter") {
+        console::BufferedWriter writer;
+        for (int i = 0; i < 1000; ++i)
+            writer.format_line(CONSOLE_FOREGROUND_GREEN "{:>6}" CONSOLE_STANDARD " benchmark line", i);
+        return writer.size();
+    };
+
+    BENCHMARK("console::LineWriter") {
+        auto& writer = console::thread_line_writer();
+        for (int i = 0; i < 1000; ++i)
+            writer.format_line(CONSOLE_FOREGROUND_GREEN "{:>6}" CONSOLE_STANDARD " benchmark line", i);
+        writer.flush();
+        return 0;
+    };
+}
+
+TEST_CASE("profile zones", "[profile]") {
+    namespace profile = pnq::profile;
+
+    wchar_t temp_path[MAX_PATH];
+    GetTempPathW(MAX_PATH, temp_path);
+    std::string filename = pnq::string::encode_as_utf8(std::wstring{temp_path} + L"pnq_test_profile.json");
+
+    // Events recorded by other tests are not part of this one
+    profile::clear();
+    {
+        profile::Zone ignored{"test::before_start"};
+    }
+
+    profile::start();
+    REQUIRE(profile::is_enabled());
+    profile::set_thread_name("test \"main\"");
+    {
+        profile::Zone outer{"test::outer"};
+        profile::Zone inner{"test::inner"};
+    }
+
+    // More events than one chunk holds, from another thread
+    std::thread worker{[] {
+        for (int i = 0; i < 3000; ++i)
+            profile::Zone zone{"test::worker"};
+    }};
+    worker.join();
+    profile::stop();
+
+    {
+        profile::Zone ignored{"test::after_stop"};
+    }
+    REQUIRE(profile::ticks_per_microsecond() > 0);
+    REQUIRE(profile::write_chrome_trace(filename));
+
+    const auto trace = pnq::text_file::read_auto(filename);
+    const auto count = [&](std::string_view text) {
+        size_t result = 0;
+        for (auto pos = trace.find(text); pos != std::string::npos; pos = trace.find(text, pos + 1))
+            ++result;
+        return result;
+    };
+    REQUIRE(trace.starts_with("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    REQUIRE(trace.ends_with("]}\n"));
+    REQUIRE(count("\"test::outer\"") == 1);
+    REQUIRE(count("\"test::inner\"") == 1);
+    REQUIRE(count("\"test::worker\"") == 3000);
+    REQUIRE(count("test::before_start") == 0);
+    REQUIRE(count("test::after_stop") == 0);
+    REQUIRE(count("\"args\":{\"name\":\"test \\\"main\\\"\"}") == 1);
+
+    // Cleared events are gone, new ones are recorded under the same thread name
+    profile::clear();
+    profile::start();
+    {
+        profile::Zone zone{"test::after_clear"};
+    }
+    profile::stop();
+    REQUIRE(profile::write_chrome_trace(filename));
+
+    const auto cleared = pnq::text_file::read_auto(filename);
+    REQUIRE(cleared.find("test::outer") == std::string::npos);
+    REQUIRE(cleared.find("test::worker") == std::string::npos);
+    REQUIRE(cleared.find("\"test::after_clear\"") != std::string::npos);
+    REQUIRE(cleared.find("test \\\"main\\\"") != std::string::npos);
+
+    profile::clear();
+    pnq::file::remove(filename);
+}
+
+TEST_CASE("memory allocation tracking", "[memory]") {
+#ifndef PNQ_TRACK_ALLOCATIONS
+    SKIP("built without PNQ_TRACK_ALLOCATIONS");
+#else
+    namespace memory = pnq::memory;
+    using namespace pnq::regis3;
+
+    SECTION("scope counts allocations per type") {
+        memory::AllocationScope scope;
+        auto* v = new value{"name"};
+        REQUIRE(scope.stats(memory::category::value).allocations == 1);
+        REQUIRE(scope.stats(memory::category::value).bytes_allocated == sizeof(value));
+        REQUIRE(scope.stats(memory::category::key_entry).allocations == 0);
+        delete v;
+
+        const auto stats = scope.stats(memory::category::value);
+        REQUIRE(stats.deallocations == 1);
+        REQUIRE(stats.live_bytes() == 0);
+        REQUIRE(stats.peak_live_bytes >= sizeof(value));
+    }
+
+    SECTION("nested scopes report their own peak") {
+        memory::AllocationScope outer;
+        void* big = memory::allocate(4096, memory::category::other);
+        memory::deallocate(big, 4096, memory::category::other);
+        {
+            memory::AllocationScope inner;
+            void* small = memory::allocate(16, memory::category::other);
+            memory::deallocate(small, 16, memory::category::other);
+            REQUIRE(inner.stats().peak_live_bytes >= 16);
+            REQUIRE(inner.stats().peak_live_bytes < 4096);
+        }
+        REQUIRE(outer.stats().peak_live_bytes >= 4096);
+    }
+
+    SECTION("string::Writer buffers") {
+        memory::AllocationScope scope;
+        {
+            pnq::string::Writer writer;
+            for (int i = 0; i < 1000; ++i)
+                writer.append("0123456789");
+        }
+        const auto stats = scope.stats(memory::category::writer);
+        REQUIRE(stats.allocations > 0);
+        REQUIRE(stats.live_bytes() == 0);
+    }
+
+    SECTION("parsing allocates one object per key and value") {
+        const char* content =
+            "Windows Registry Editor Version 5.00\r\n"
+            "\r\n"
+            "[HKEY_CURRENT_USER\\Software\\pnq_test\\a]\r\n"
+            "\"One\"=\"1\"\r\n"
+            "\"Two\"=dword:00000002\r\n"
+            "\r\n"
+            "[HKEY_CURRENT_USER\\Software\\pnq_test\\b]\r\n"
+            "@=\"default\"\r\n"
+            "\"Three\"=hex:03,03,03\r\n"
+            "\r\n";
+
+        memory::AllocationScope scope;
+        {
+            regfile_parser parser(HEADER_FORMAT5, import_options::none);
+            REQUIRE(parser.parse_text(content));
+
+            // Root, HKEY_CURRENT_USER, Software, pnq_test, a and b
+            REQUIRE(scope.stats(memory::category::key_entry).allocations == 6);
+            REQUIRE(scope.stats(memory::category::value).allocations == 4);
+
+            // Generous budget: catches per-character allocations, not small regressions
+            REQUIRE(scope.stats().allocations < 200);
+        }
+        REQUIRE(scope.stats(memory::category::key_entry).live_bytes() == 0);
+        REQUIRE(scope.stats(memory::category::value).live_bytes() == 0);
+    }
+#endif
+}
+
 TEST_CASE("environment_variables::get", "[environment_variables]") {
     namespace ev = pnq::environment_variables;
 
@@ -1717,6 +2817,77 @@ TEST_CASE("registry::key_entry basics", "[registry]") {
         diff->release();
         source->release();
     }
+
+    SECTION("a retained subkey keeps its tree alive") {
+        key_entry* root = PNQ_NEW key_entry();
+        key_entry* child = PNQ_NEW key_entry(root, "Software");
+        child->find_or_create_value("Val")->set_dword(7);
+
+        root->release();
+
+        // The path walks up through the parent, which must still exist
+        REQUIRE(child->get_path() == "Software");
+        REQUIRE(child->values().at("val")->get_dword() == 7);
+        child->release();
+    }
+
+    SECTION("adding a subkey of the same name keeps retained subkeys valid") {
+        key_entry* root = PNQ_NEW key_entry();
+        pnq::ref_ptr<key_entry> retained{PNQ_NEW key_entry(root, "Software"), pnq::adopt_ref};
+        retained->find_or_create_value("Old")->set_dword(1);
+        key_entry* borrowed = retained->find_or_create_key("Sub");
+
+        // The constructor detaches the old subkey without destroying it
+        key_entry* replacement = PNQ_NEW key_entry(root, "software");
+        REQUIRE(root->keys().at("software") == replacement);
+        REQUIRE(retained->get_path() == "Software");
+        REQUIRE(retained->values().at("old")->get_dword() == 1);
+        REQUIRE(borrowed->parent() == retained.get());
+
+        // clone and ask_to_add_key merge into the existing subkey
+        key_entry* source = PNQ_NEW key_entry();
+        source->find_or_create_key("Software\\Sub")->find_or_create_value("New")->set_dword(2);
+        key_entry* merged = source->find_or_create_key("Software")->clone(root);
+        REQUIRE(merged == replacement);
+        key_entry* sub = replacement->find_or_create_key("Sub");
+        root->ask_to_add_key(source->find_or_create_key("Software"));
+        REQUIRE(replacement->find_or_create_key("Sub") == sub);
+        REQUIRE(sub->values().at("new")->get_dword() == 2);
+
+        merged->release();
+        source->release();
+        replacement->release();
+        root->release();
+
+        REQUIRE(retained->values().at("old")->get_dword() == 1);
+        REQUIRE(borrowed->get_path() == "Software\\Sub");
+    }
+
+    SECTION("deep trees are destroyed without recursion") {
+        key_entry* root = PNQ_NEW key_entry();
+        key_entry* k = root;
+        for (int i = 0; i < 100000; ++i)
+            k = k->find_or_create_key("Level");
+        k->find_or_create_value("Leaf");
+
+        key_entry* copy = root->clone(nullptr);
+        REQUIRE(copy->has_keys());
+
+        copy->release();
+        root->release();
+    }
+
+    SECTION("trees can be destroyed by a Reclaimer") {
+        pnq::Reclaimer reclaimer;
+
+        key_entry* root = PNQ_NEW key_entry();
+        for (int i = 0; i < 1000; ++i)
+            root->find_or_create_key(std::format("Key{}\\Subkey", i))->find_or_create_value("Val");
+        root->set_reclaimer(&reclaimer);
+
+        root->release();
+        reclaimer.drain();
+    }
 }
 
 TEST_CASE("registry::key live access", "[registry]") {
@@ -2678,6 +3849,29 @@ TEST_CASE("HostsFile parsing", "[hosts]") {
         auto entries = hosts.entries();
         REQUIRE(entries.size() == 1);
     }
+
+    SECTION("load_from_buffer adopts content") {
+        HostsFile hosts;
+        hosts.load_from_buffer(std::string{"10.0.0.1 alpha\n10.0.0.2 beta # two\n"});
+
+        REQUIRE(hosts.line_count() == 2);
+        REQUIRE(hosts.find("beta")->comment == "two");
+    }
+
+    SECTION("load strips CRLF line endings") {
+        wchar_t temp_path[MAX_PATH];
+        GetTempPathW(MAX_PATH, temp_path);
+        std::string filename = pnq::string::encode_as_utf8(std::wstring{temp_path} + L"pnq_test_hosts_crlf");
+        REQUIRE(pnq::text_file::write_utf8(filename, "# header\r\n10.0.0.1 alpha # one\r\n\r\n10.0.0.2 beta", false, false));
+
+        HostsFile hosts;
+        REQUIRE(hosts.load(filename));
+        REQUIRE(hosts.line_count() == 4);
+        REQUIRE(hosts.find("alpha")->comment == "one");
+        REQUIRE(hosts.to_string() == "# header\n10.0.0.1 alpha # one\n\n10.0.0.2 beta");
+
+        pnq::file::remove(filename);
+    }
 }
 
 TEST_CASE("HostsFile modification", "[hosts]") {
@@ -2741,6 +3935,135 @@ TEST_CASE("HostsFile modification", "[hosts]") {
         std::string output = hosts.to_string();
         REQUIRE(output == original);
     }
+
+    SECTION("remove drops every line mentioning hostname") {
+        HostsFile hosts;
+        hosts.load_from_string(
+            "10.0.0.1 alpha beta\n"
+            "10.0.0.2 beta\n"
+            "10.0.0.3 alpha\n"
+        );
+
+        REQUIRE(hosts.remove("ALPHA"));
+        REQUIRE(hosts.line_count() == 1);
+        REQUIRE_FALSE(hosts.contains("alpha"));
+        REQUIRE(hosts.find("beta")->ip == "10.0.0.2");
+        REQUIRE(hosts.to_string() == "10.0.0.2 beta");
+    }
+
+    SECTION("index survives many removals") {
+        std::string content;
+        for (int i = 0; i < 5000; ++i)
+            content += std::format("0.0.0.0 host{}.example\n", i);
+
+        HostsFile hosts;
+        hosts.load_from_string(content);
+        for (int i = 0; i < 4000; ++i)
+            REQUIRE(hosts.remove(std::format("HOST{}.example", i)));
+
+        REQUIRE(hosts.line_count() == 1000);
+        REQUIRE(hosts.entries().size() == 1000);
+        REQUIRE_FALSE(hosts.contains("host3999.example"));
+        REQUIRE(hosts.find("host4500.example")->ip == "0.0.0.0");
+
+        hosts.set("host4500.example", "127.0.0.1");
+        REQUIRE(hosts.find("host4500.example")->ip == "127.0.0.1");
+        REQUIRE(hosts.line_count() == 1000);
+    }
+
+    SECTION("repeated set reclaims overwritten edits") {
+        HostsFile hosts;
+        hosts.load_from_string("1.1.1.1 a\n# comment\n2.2.2.2 b");
+        for (int i = 0; i < 5000; ++i) {
+            hosts.set("a", std::to_string(i));
+            hosts.set("b", std::to_string(i), "edited");
+        }
+
+        REQUIRE(hosts.line_count() == 3);
+        REQUIRE(hosts.find("B")->comment == "edited");
+        REQUIRE(hosts.to_string() == "4999\ta\n# comment\n4999\tb # edited");
+    }
+
+    SECTION("copies and moves outlive the original") {
+        // Short enough for the buffer to be stored inline in the string
+        auto original = std::make_unique<HostsFile>();
+        original->load_from_string("1.1.1.1 a\n2.2.2.2 b");
+        original->set("c", "3.3.3.3");
+        original->remove("b");
+
+        HostsFile copy{*original};
+        HostsFile moved{std::move(*original)};
+        original.reset();
+
+        for (const HostsFile* hosts : {&copy, &moved}) {
+            REQUIRE(hosts->find("A")->ip == "1.1.1.1");
+            REQUIRE(hosts->find("c")->ip == "3.3.3.3");
+            REQUIRE_FALSE(hosts->contains("b"));
+            REQUIRE(hosts->to_string() == "1.1.1.1 a\n3.3.3.3\tc");
+        }
+
+        copy = moved;
+        moved = HostsFile{};
+        REQUIRE(copy.find("a")->ip == "1.1.1.1");
+        REQUIRE(moved.line_count() == 0);
+    }
+}
+
+TEST_CASE("HostsFile bulk modification", "[hosts]") {
+    using pnq::HostsFile;
+
+    SECTION("apply behaves like repeated set") {
+        HostsFile hosts;
+        hosts.load_from_string(
+            "10.0.0.1 alpha\n"
+            "# comment\n"
+        );
+
+        std::vector<HostsFile::Entry> changes{
+            {"10.0.0.9", "alpha", ""},
+            {"10.0.0.2", "beta", "new"},
+            {"10.0.0.3", "beta", ""},
+        };
+        hosts.apply(changes);
+
+        REQUIRE(hosts.find("alpha")->ip == "10.0.0.9");
+        REQUIRE(hosts.find("beta")->ip == "10.0.0.3");
+        REQUIRE(hosts.to_string() == "10.0.0.9\talpha\n# comment\n10.0.0.3\tbeta");
+    }
+
+    SECTION("merge_from imports a blocklist") {
+        std::string content;
+        for (int i = 0; i < 10000; ++i)
+            content += std::format("0.0.0.0 ads{}.example\n", i);
+
+        HostsFile blocklist;
+        blocklist.load_from_string(content);
+
+        HostsFile hosts;
+        hosts.load_from_string("127.0.0.1 localhost\n0.0.0.0 ads5.example # old");
+        hosts.merge_from(blocklist);
+
+        REQUIRE(hosts.line_count() == 10001);
+        REQUIRE(hosts.contains("localhost"));
+        REQUIRE(hosts.find("ADS9999.example")->ip == "0.0.0.0");
+        REQUIRE(hosts.find("ads5.example")->comment.empty());
+    }
+
+    SECTION("remove_if drops matching lines") {
+        HostsFile hosts;
+        hosts.load_from_string(
+            "127.0.0.1 localhost\n"
+            "0.0.0.0 ads.example tracker.example\n"
+            "# keep me\n"
+            "0.0.0.0 more-ads.example\n"
+        );
+
+        auto removed = hosts.remove_if([](const HostsFile::EntryView& entry) { return entry.ip == "0.0.0.0"; });
+
+        REQUIRE(removed == 2);
+        REQUIRE_FALSE(hosts.contains("tracker.example"));
+        REQUIRE(hosts.to_string() == "127.0.0.1 localhost\n# keep me");
+    }
 }
 
 TEST_CASE("HostsFile system_path", "[hosts]") {
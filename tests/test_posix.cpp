@@ -0,0 +1,283 @@
+// Tests for the POSIX backends; test_main.cpp covers Windows.
+#include <catch2/catch_test_macros.hpp>
+#include <pnq/binary_file.h>
+#include <pnq/async_io.h>
+#include <pnq/console.h>
+#include <pnq/mapped_file.h>
+#include <pnq/string.h>
+#include <pnq/text_file.h>
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+
+#ifdef PNQ_PLATFORM_WINDOWS
+#error "test_posix.cpp is for non-Windows builds"
+#endif
+
+namespace
+{
+    std::string temp_filename(std::string_view name)
+    {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+}
+
+TEST_CASE("BinaryFile on POSIX", "[binary_file]") {
+    using pnq::BinaryFile;
+
+    const auto filename = temp_filename("pnq_test_binary_file.bin");
+    REQUIRE(BinaryFile::write(filename, std::string_view{"hello world"}));
+
+    SECTION("whole-file read") {
+        pnq::bytes data;
+        REQUIRE(BinaryFile::read(filename, data));
+        REQUIRE(std::string_view{reinterpret_cast<const char*>(data.data()), data.size()} == "hello world");
+    }
+
+    SECTION("read_at does not depend on file position") {
+        BinaryFile bf;
+        REQUIRE(bf.open_for_reading(filename, pnq::file_options::random_access));
+
+        std::uint8_t buffer[5];
+        size_t bytes_read = 0;
+        REQUIRE(bf.read_at(6, buffer, sizeof(buffer), bytes_read));
+        REQUIRE(bytes_read == 5);
+        REQUIRE(std::memcmp(buffer, "world", 5) == 0);
+
+        REQUIRE(bf.read_at(9, buffer, sizeof(buffer), bytes_read));
+        REQUIRE(bytes_read == 2);
+    }
+
+    SECTION("write_at and preallocate") {
+        {
+            BinaryFile bf;
+            REQUIRE(bf.create_or_open_for_write_append(filename));
+            REQUIRE(bf.preallocate(1024 * 1024));
+            REQUIRE(bf.write_at(0, std::string_view{"J"}));
+        }
+
+        pnq::bytes data;
+        REQUIRE(BinaryFile::read(filename, data));
+        REQUIRE(data.size() == 11);
+        REQUIRE(data[0] == 'J');
+    }
+
+    SECTION("write-behind buffers keep write order") {
+        std::string expected;
+        {
+            BinaryFile bf;
+            REQUIRE(bf.create_for_writing(filename));
+            REQUIRE(bf.set_write_buffers(64, 3));
+
+            for (int i = 0; i < 1000; ++i) {
+                const auto line = std::format("line {}\n", i);
+                expected += line;
+                REQUIRE(bf.write(line.c_str()));
+            }
+            REQUIRE(bf.sync());
+            REQUIRE(bf.get_file_size() == expected.size());
+        }
+
+        pnq::bytes data;
+        REQUIRE(BinaryFile::read(filename, data));
+        REQUIRE(std::string_view{reinterpret_cast<const char*>(data.data()), data.size()} == expected);
+    }
+
+    SECTION("gather writes") {
+        std::vector<std::string> lines;
+        std::vector<pnq::memory_view> fragments;
+        std::string expected;
+        for (int i = 0; i < 2000; ++i) {
+            lines.push_back(std::format("\"value{}\"=dword:{:08x}\n", i, i));
+        }
+        for (const auto& line : lines) {
+            fragments.emplace_back(std::string_view{line});
+            expected += line;
+        }
+
+        {
+            BinaryFile bf;
+            REQUIRE(bf.create_for_writing(filename));
+            REQUIRE(bf.write(fragments));
+        }
+
+        pnq::bytes data;
+        REQUIRE(BinaryFile::read(filename, data));
+        REQUIRE(std::string_view{reinterpret_cast<const char*>(data.data()), data.size()} == expected);
+    }
+
+    SECTION("missing files fail to open") {
+        BinaryFile bf;
+        REQUIRE_FALSE(bf.open_for_reading(temp_filename("pnq_test_does_not_exist.bin")));
+    }
+
+    std::filesystem::remove(filename);
+}
+
+TEST_CASE("MappedFile on POSIX", "[mapped_file]") {
+    using pnq::MappedFile;
+
+    const auto filename = temp_filename("pnq_test_mapped_file.txt");
+    REQUIRE(pnq::BinaryFile::write(filename, std::string_view{"mapped content"}));
+
+    SECTION("read-only mapping exposes file contents") {
+        MappedFile file;
+        REQUIRE(file.open(filename));
+        REQUIRE(file.text() == "mapped content");
+        REQUIRE(file.advise(pnq::map_advice::sequential));
+    }
+
+    SECTION("copy-on-write changes do not reach the file") {
+        {
+            MappedFile file;
+            REQUIRE(file.open(filename, pnq::map_mode::copy_on_write));
+            file.mutable_data()[0] = 'M';
+            REQUIRE(file.text() == "Mapped content");
+        }
+        MappedFile file;
+        REQUIRE(file.open(filename));
+        REQUIRE(file.text() == "mapped content");
+    }
+
+    SECTION("temp directory is local") {
+        REQUIRE(MappedFile::is_local(filename));
+        REQUIRE_FALSE(MappedFile::is_local(temp_filename("pnq_no_such_dir/file.txt")));
+    }
+
+    std::filesystem::remove(filename);
+}
+
+TEST_CASE("AsyncIO on POSIX", "[async_io]") {
+    using pnq::BinaryFile;
+
+    const auto filename = temp_filename("pnq_test_async_io.bin");
+    std::string data(256 * 1024, '\0');
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>('a' + i % 26);
+
+    {
+        BinaryFile file;
+        REQUIRE(file.create_for_writing(filename));
+        pnq::AsyncIO io{4};
+
+        std::vector<std::future<pnq::AsyncIO::Result>> writes;
+        for (size_t offset = 0; offset < data.size(); offset += 16 * 1024)
+            writes.push_back(io.write(file, offset, pnq::memory_view{std::string_view{data}.substr(offset, 16 * 1024)}));
+        REQUIRE(io.submit() == writes.size());
+        for (auto& write : writes) {
+            const auto result = write.get();
+            REQUIRE(result.success);
+            REQUIRE(result.bytes == 16 * 1024);
+        }
+    }
+
+    BinaryFile file;
+    REQUIRE(file.open_for_reading(filename));
+    pnq::AsyncIO io{2};
+
+    std::vector<std::uint8_t> buffer(data.size());
+    std::vector<std::uint8_t> tail(1000);
+    auto whole = io.read(file, 0, buffer.data(), buffer.size());
+    auto past_end = io.read(file, data.size() - 100, tail.data(), tail.size());
+    io.submit();
+
+    const auto whole_result = whole.get();
+    REQUIRE(whole_result.success);
+    REQUIRE(whole_result.bytes == data.size());
+    REQUIRE(std::memcmp(buffer.data(), data.data(), data.size()) == 0);
+
+    // Only reads that reach the end of the file are short
+    const auto past_end_result = past_end.get();
+    REQUIRE(past_end_result.success);
+    REQUIRE(past_end_result.bytes == 100);
+
+    // Callbacks that queue more requests than there are free slots don't wait for them
+    std::atomic<int> completed{0};
+    std::atomic<int> failed{0};
+    std::atomic<size_t> next_slot{0};
+    std::vector<std::uint8_t> slots(10 * 1024);
+    const auto slot = [&] { return slots.data() + 10 * next_slot++; };
+    std::function<void(const pnq::AsyncIO::Result&)> resubmit = [&](const pnq::AsyncIO::Result& result) {
+        if (!result.success)
+            ++failed;
+        if (++completed < 100) {
+            for (int i = 0; i < 4; ++i)
+                io.read(file, 0, slot(), 10, [&completed](const pnq::AsyncIO::Result&) { ++completed; });
+            io.read(file, 0, slot(), 10, resubmit);
+            io.submit();
+        }
+    };
+    io.read(file, 0, slot(), 10, resubmit);
+    while (completed < 100 || io.pending()) {
+        io.submit();
+        io.wait_all();
+    }
+    REQUIRE(failed == 0);
+
+    std::filesystem::remove(filename);
+}
+
+TEST_CASE("string on POSIX", "[string]") {
+    namespace s = pnq::string;
+
+    REQUIRE(s::equals_nocase("Hello", "hELLO"));
+    REQUIRE_FALSE(s::equals_nocase("Hello", "Help!"));
+    REQUIRE(s::starts_with_nocase("HOSTS file", "hosts"));
+    REQUIRE(s::find_nocase("some Text here", "TEXT") == 5);
+    REQUIRE(s::equals_nocase(std::wstring_view{L"Straße"}, std::wstring_view{L"STRAßE"}));
+
+    const std::string text{"gr\xC3\xBC\xC3\x9F \xF0\x9F\x98\x80"};
+    REQUIRE(s::encode_as_utf8(s::encode_as_utf16(text)) == text);
+    REQUIRE(s::encode_as_utf8(std::u16string_view{u"gr\u00FC\u00DF \U0001F600"}) == text);
+}
+
+TEST_CASE("text_file on POSIX", "[text_file]") {
+    namespace tf = pnq::text_file;
+    const auto filename = temp_filename("pnq_test_text_file.txt");
+
+    SECTION("UTF-8 with BOM, small and mapped") {
+        REQUIRE(tf::write_utf8(filename, "line 1\nline 2\n"));
+        REQUIRE(tf::read_auto(filename) == "line 1\nline 2\n");
+
+        std::string large;
+        while (large.size() < 2 * tf::map_threshold)
+            large += "a line of text that repeats\n";
+        REQUIRE(tf::write_utf8(filename, large));
+        REQUIRE(tf::read_auto(filename) == large);
+    }
+
+    SECTION("UTF-16LE with BOM") {
+        const std::uint8_t data[] = {0xFF, 0xFE, 'h', 0, 0xFC, 0, '\r', 0, '\n', 0, 0x3D, 0xD8, 0x00, 0xDE};
+        REQUIRE(pnq::BinaryFile::write(filename, pnq::memory_view{data, sizeof(data)}));
+        REQUIRE(tf::read_auto(filename) == "h\xC3\xBC\n\xF0\x9F\x98\x80");
+    }
+
+    std::filesystem::remove(filename);
+}
+
+TEST_CASE("console on POSIX", "[console]") {
+    namespace console = pnq::console;
+
+    const auto previous = console::get_color_mode();
+    console::set_color_mode(console::color_mode::plain);
+
+    {
+        console::BufferedWriter writer{64};
+        REQUIRE(writer.write_line("line"));
+        REQUIRE(writer.format_line("{}", 42));
+        REQUIRE(writer.size() == 4 + 2 + 2 * console::newline.size());
+        REQUIRE(console::newline == "\n");
+    }
+
+    console::set_color_mode(previous);
+
+    // The address column is as wide as a pointer and the byte columns line up after it
+    pnq::string::Writer dump;
+    const unsigned char bytes[] = {'p', 'n', 'q', 0x00, 0xFF};
+    dump.hexdump(bytes, sizeof(bytes));
+    const std::string text{dump.as_string()};
+    const std::string_view line = std::string_view{text}.substr(text.find("\r\n") + 2);
+    REQUIRE(line.find(':') == 2 * sizeof(void*));
+    REQUIRE(line.find("706E7100") != std::string_view::npos);
+}
@@ -0,0 +1,30 @@
+/// @file pnq_logdecode.cpp
+/// @brief Render binary log files written by pnq::logging::binary as text.
+///
+/// Usage: pnq_logdecode <file.blog> [...]
+
+#include <iostream>
+
+#include <pnq/binary_log_decoder.h>
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: pnq_logdecode <file> [...]\n";
+        return 2;
+    }
+
+    pnq::logging::initialize_logging("pnq_logdecode", true);
+
+    int result = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool ok = pnq::logging::binary::decode(argv[i], [](const pnq::logging::binary::Message& message) {
+            std::cout << pnq::logging::binary::to_string(message) << '\n';
+        });
+        if (!ok)
+            result = 1;
+    }
+    return result;
+}